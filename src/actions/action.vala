@@ -24,6 +24,10 @@ namespace Fm {
 private string? desktop_env; // current desktop environment
 private bool actions_loaded = false; // all actions are loaded?
 private HashTable<string, FileActionObject> all_actions = null; // cache all loaded actions
+private HashTable<string, GenericArray<FileActionObject>> actions_index = null; // see build_actions_index()
+private GenericArray<FileActionObject> unindexed_actions = null; // may match any selection
+private GenericArray<FileActionMenu> all_menus = null;
+private uint match_serial = 0; // to skip actions already listed as candidates
 
 
 public enum FileActionType {
@@ -61,6 +65,7 @@ public class FileActionObject : Object {
 
 	// values cached during menu generation
 	public bool has_parent;
+	internal uint match_serial;
 }
 
 
@@ -109,15 +114,19 @@ public class FileAction : FileActionObject {
 	}
 
 	public bool match(List<FileInfo> files, out unowned FileActionProfile matched_profile) {
+		return match_selection(new FileActionSelection(files), out matched_profile);
+	}
+
+	internal bool match_selection(FileActionSelection sel, out unowned FileActionProfile matched_profile) {
 		matched_profile = null;
 		// stdout.printf("FileAction.match: %s\n", id);
 		if(hidden || !enabled)
 			return false;
 
-		if(!condition.match(files))
+		if(!condition.match_selection(sel))
 			return false;
 		foreach(unowned FileActionProfile profile in profiles) {
-			if(profile.match(files)) {
+			if(profile.match_selection(sel)) {
 				matched_profile = profile;
 				// stdout.printf("  profile matched!\n\n");
 				return true;
@@ -157,10 +166,14 @@ public class FileActionMenu : FileActionObject {
 	}
 
 	public bool match(List<FileInfo> files) {
+		return match_selection(new FileActionSelection(files));
+	}
+
+	internal bool match_selection(FileActionSelection sel) {
 		// stdout.printf("FileActionMenu.match: %s\n", id);
 		if(hidden || !enabled)
 			return false;
-		if(!condition.match(files))
+		if(!condition.match_selection(sel))
 			return false;
 		// stdout.printf("menu matched!: %s\n\n", id);
 		return true;
@@ -205,11 +218,16 @@ public class FileActionMenu : FileActionObject {
 public class FileActionItem {
 
 	public static FileActionItem? new_for_action_object(FileActionObject action_obj, List<FileInfo> files) {
+		return new_for_selection(action_obj, new FileActionSelection(files));
+	}
+
+	internal static FileActionItem? new_for_selection(FileActionObject action_obj, FileActionSelection sel) {
+		unowned List<FileInfo> files = sel.files;
 		FileActionItem item = null;
 		if(action_obj.type == FileActionType.MENU) {
 			var menu = (FileActionMenu)action_obj;
-			if(menu.match(files)) {
-				item = new FileActionItem.from_menu(menu, files);
+			if(menu.match_selection(sel)) {
+				item = new FileActionItem.for_menu(menu, sel);
 				// eliminate empty menus
 				if(item.children == null)
 					item = null;
@@ -219,7 +237,7 @@ public class FileActionItem {
 			// handle profiles here
 			var action = (FileAction)action_obj;
 			unowned FileActionProfile profile;
-			if(action.match(files, out profile)) {
+			if(action.match_selection(sel, out profile)) {
 				item = new FileActionItem.from_action(action, profile, files);
 			}
 		}
@@ -232,13 +250,17 @@ public class FileActionItem {
 	}
 	
 	public FileActionItem.from_menu(FileActionMenu menu, List<FileInfo> files) {
-		this(menu, files);
+		this.for_menu(menu, new FileActionSelection(files));
+	}
+
+	internal FileActionItem.for_menu(FileActionMenu menu, FileActionSelection sel) {
+		this(menu, sel.files);
 		foreach(FileActionObject action_obj in menu.cached_children) {
 			if(action_obj == null) { // separator
 				children.append(null);
 			}
 			else { // action item or menu
-				FileActionItem subitem = new_for_action_object(action_obj, files);
+				FileActionItem subitem = new_for_selection(action_obj, sel);
 				if(subitem != null)
 					children.append(subitem);
 			}
@@ -362,48 +384,130 @@ private void load_actions_from_dir(string dirname, string? id_prefix) {
 }
 
 
-public List<FileActionItem>? get_actions_for_files(List<Fm.FileInfo> files) {
-	if(!actions_loaded)
-		load_all_actions();
+// Adds keys of MIME types or schemes which a selection should have for
+// the action to match, see FileActionCondition.add_mime_keys().
+// Returns false if the action may match any selection.
+private bool add_index_keys(FileActionObject action_obj, HashTable<string, string> keys) {
+	unowned FileActionCondition condition = action_obj.condition;
+	if(condition.add_mime_keys(keys) || condition.add_scheme_keys(keys))
+		return true;
+	if(action_obj.type == FileActionType.MENU)
+		return false;
+	// the action matches only if some of its profiles does
+	foreach(unowned FileActionProfile profile in ((FileAction)action_obj).profiles) {
+		if(!profile.condition.add_mime_keys(keys) &&
+		   !profile.condition.add_scheme_keys(keys))
+			return false;
+	}
+	return true;
+}
+
+// Actions are indexed by MIME types and schemes which a selection should
+// have to match them, so only actions which may match are tested.
+private void build_actions_index() {
+	actions_index = new HashTable<string, GenericArray<FileActionObject>>(str_hash, str_equal);
+	unindexed_actions = new GenericArray<FileActionObject>();
+	all_menus = new GenericArray<FileActionMenu>();
 
-	// Iterate over all actions to establish association between parent menu
-	// and children actions, and to find out toplevel ones which are not 
-	// attached to any parent menu
 	var action_it = HashTableIter<string, FileActionObject>(all_actions);
 	FileActionObject action_obj = null;
 	while(action_it.next(null, out action_obj)) {
-		// stdout.printf("id = %s\n", action_obj.id);
-		if(action_obj.type == FileActionType.MENU) { // this is a menu
-			FileActionMenu menu = (FileActionMenu)action_obj;
-			// stdout.printf("menu: %s\n", menu.name);
-			// associate child items with menus
-			menu.cache_children(files, menu.items_list);
+		if(action_obj.type == FileActionType.MENU)
+			all_menus.add((FileActionMenu)action_obj);
+		var keys = new HashTable<string, string>(str_hash, str_equal);
+		if(!add_index_keys(action_obj, keys)) {
+			unindexed_actions.add(action_obj);
+			continue;
+		}
+		foreach(unowned string key in keys.get_keys()) {
+			unowned GenericArray<FileActionObject>? actions = actions_index.lookup(key);
+			if(actions == null) {
+				var new_actions = new GenericArray<FileActionObject>();
+				actions = new_actions;
+				actions_index.insert(key, (owned) new_actions);
+			}
+			actions.add(action_obj);
 		}
 	}
+}
+
+// returns actions which may match the selection
+private List<unowned FileActionObject> get_candidate_actions(FileActionSelection sel) {
+	var candidates = new List<unowned FileActionObject>();
+	FileActionObject action_obj = null;
+
+	// conditions of empty selection are never restricted by MIME types
+	if(sel.n_files == 0) {
+		var action_it = HashTableIter<string, FileActionObject>(all_actions);
+		while(action_it.next(null, out action_obj))
+			candidates.prepend(action_obj);
+		return candidates;
+	}
+
+	GenericArray<FileActionObject>?[] lists = { unindexed_actions };
+	if(sel.mime_types.length == 1)
+		lists += actions_index.lookup(@"m:$(sel.mime_types[0])");
+	var media = sel.get_common_media();
+	if(media != null)
+		lists += actions_index.lookup(@"m:$media*");
+	if(sel.n_dirs == 0)
+		lists += actions_index.lookup("m:all/allfiles");
+	if(sel.schemes.length == 1)
+		lists += actions_index.lookup(@"s:$(sel.schemes[0])");
+
+	// an action may be found by several keys
+	++match_serial;
+	foreach(unowned GenericArray<FileActionObject>? actions in lists) {
+		if(actions == null)
+			continue;
+		for(uint i = 0; i < actions.length; ++i) {
+			unowned FileActionObject action = actions[i];
+			if(action.match_serial != match_serial) {
+				action.match_serial = match_serial;
+				candidates.prepend(action);
+			}
+		}
+	}
+	candidates.reverse();
+	return candidates;
+}
+
+public List<FileActionItem>? get_actions_for_files(List<Fm.FileInfo> files) {
+	if(!actions_loaded)
+		load_all_actions();
+
+	// facts about the files are gathered once and used by all conditions
+	var sel = new FileActionSelection(files);
+
+	// Establish association between parent menus and children actions
+	// to find out toplevel ones which are not attached to any parent menu
+	for(uint i = 0; i < all_menus.length; ++i) {
+		unowned FileActionMenu menu = all_menus[i];
+		// stdout.printf("menu: %s\n", menu.name);
+		// associate child items with menus
+		menu.cache_children(files, menu.items_list);
+	}
 
 	// Output the menus
 	var items = new List<FileActionItem>();
 
-	action_it = HashTableIter<string, FileActionObject>(all_actions);
-	action_obj = null;
-	while(action_it.next(null, out action_obj)) {
+	foreach(unowned FileActionObject action_obj in get_candidate_actions(sel)) {
 		// only output toplevel items here
 		if(action_obj.has_parent == false) { // this is a toplevel item
-			FileActionItem item = FileActionItem.new_for_action_object(action_obj, files);
+			FileActionItem item = FileActionItem.new_for_selection(action_obj, sel);
 			if(item != null)
 				items.append(item);
 		}
 	}
 
 	// cleanup temporary data cached during menu generation
-	action_it = HashTableIter<string, FileActionObject>(all_actions);
-	action_obj = null;
-	while(action_it.next(null, out action_obj)) {
-		action_obj.has_parent = false;
-		if(action_obj.type == FileActionType.MENU) {
-			FileActionMenu menu = (FileActionMenu)action_obj;
-			menu.cached_children = null;
+	for(uint i = 0; i < all_menus.length; ++i) {
+		unowned FileActionMenu menu = all_menus[i];
+		foreach(unowned FileActionObject child in menu.cached_children) {
+			if(child != null)
+				child.has_parent = false;
 		}
+		menu.cached_children = null;
 	}
 	return items;
 }
@@ -416,6 +520,7 @@ private void load_all_actions() {
 	}
 	load_actions_from_dir(GLib.Path.build_filename(Environment.get_user_data_dir(),
 				  "file-manager/actions"), null);
+	build_actions_index();
 	actions_loaded = true;
 }
 
@@ -432,7 +537,15 @@ public void file_actions_init() {
 }
 
 public void file_actions_finalize() {
+	Fm.actions_index = null;
+	Fm.unindexed_actions = null;
+	Fm.all_menus = null;
 	Fm.all_actions = null;
+	Fm.test_results = null;
+	if(Fm.test_notify_id != 0)
+		Source.remove(Fm.test_notify_id);
+	Fm.test_notify_id = 0;
+	Fm.test_monitor = null;
 }
 
 }
@@ -33,6 +33,324 @@ public enum FileActionCapability {
 	LOCAL = 1 << 4
 }
 
+internal enum FileActionRuleList {
+	MIME_TYPES,
+	BASE_NAMES,
+	SCHEMES,
+	FOLDERS
+}
+
+internal enum FileActionMimeRuleKind {
+	EXACT,
+	PREFIX,
+	ALL,
+	ALL_FILES
+}
+
+// A rule of MimeTypes, Basenames, Schemes or Folders list compiled once
+// when the action is loaded.
+[Compact]
+internal class FileActionRule {
+	public FileActionRule(string rule) {
+		if(rule[0] == '!') {
+			value = rule.substring(1);
+			negated = true;
+		}
+		else {
+			value = rule;
+			negated = false;
+		}
+	}
+
+	public string value;
+	public bool negated;
+	public FileActionMimeRuleKind kind; // only for MimeTypes
+	public PatternSpec? pattern; // only for Basenames and Folders
+}
+
+// Results of ShowIfTrue, ShowIfRunning and ShowIfRegistered tests are
+// kept for a short time since the same tests are repeated for every
+// action and menu popup. Commands of ShowIfTrue and D-Bus queries of
+// ShowIfRegistered are run asynchronously: the last known result is
+// used (or the test fails if there is none) while the test is running,
+// and the test monitor emits "changed" when the new result differs, so
+// menus may be updated then.
+private const int64 TEST_RESULT_TTL = 3000000; // microseconds
+private const uint SHOW_IF_TRUE_TIMEOUT = 10; // seconds, then command is killed
+private const int SHOW_IF_REGISTERED_TIMEOUT = 5000; // milliseconds
+
+[Compact]
+internal class FileActionTestResult {
+	public bool value;
+	public bool pending; // test is still running
+	public int64 time;
+}
+
+internal HashTable<string, FileActionTestResult> test_results = null;
+
+public class FileActionTestMonitor : Object {
+	// emitted when results of asynchronous tests have changed
+	public signal void changed();
+}
+
+internal FileActionTestMonitor test_monitor = null;
+internal uint test_notify_id = 0;
+
+// returns the object which notifies when conditions should be tested again
+public unowned FileActionTestMonitor file_actions_get_test_monitor() {
+	if(test_monitor == null)
+		test_monitor = new FileActionTestMonitor();
+	return test_monitor;
+}
+
+private unowned FileActionTestResult? lookup_test_result(string key) {
+	if(test_results == null)
+		test_results = new HashTable<string, FileActionTestResult>(str_hash, str_equal);
+	unowned FileActionTestResult? result = test_results.lookup(key);
+	if(result != null && !result.pending &&
+	   get_monotonic_time() - result.time > TEST_RESULT_TTL)
+		return null;
+	return result;
+}
+
+private void set_test_result(string key, bool value, bool pending = false) {
+	var result = new FileActionTestResult();
+	result.value = value;
+	result.pending = pending;
+	result.time = get_monotonic_time();
+	test_results.insert(key, (owned) result);
+}
+
+// returns last known result of asynchronous test, even expired one, and
+// marks the test as running if it should be started
+private bool start_async_test(string key, out bool start) {
+	if(test_results == null)
+		test_results = new HashTable<string, FileActionTestResult>(str_hash, str_equal);
+	unowned FileActionTestResult? result = test_results.lookup(key);
+	bool value = result != null ? result.value : false;
+	start = (result == null || (!result.pending &&
+								get_monotonic_time() - result.time > TEST_RESULT_TTL));
+	if(start)
+		set_test_result(key, value, true);
+	return value;
+}
+
+// saves result of asynchronous test and notifies if it was changed
+private void finish_async_test(string key, bool value) {
+	if(test_results == null) // file actions were finalized
+		return;
+	unowned FileActionTestResult? result = test_results.lookup(key);
+	bool changed = (result == null || result.value != value);
+	set_test_result(key, value);
+	if(changed && test_monitor != null && test_notify_id == 0) {
+		// several tests usually finish together so notify once
+		test_notify_id = Idle.add(() => {
+			test_notify_id = 0;
+			if(test_monitor != null)
+				test_monitor.changed();
+			return false;
+		});
+	}
+}
+
+private bool is_exit_success(int status) {
+	return Process.if_exited(status) && Process.exit_status(status) == 0;
+}
+
+// returns true if shell command exited with 0 last time it was run
+private bool run_test_command(string cmd) {
+	var key = @"true:$cmd";
+	bool start;
+	bool value = start_async_test(key, out start);
+	if(!start)
+		return value;
+
+	string[] argv = { "/bin/sh", "-c", cmd };
+	Pid pid;
+	try {
+		Process.spawn_async(null, argv, null, SpawnFlags.DO_NOT_REAP_CHILD, null, out pid);
+	}
+	catch(SpawnError err) {
+		finish_async_test(key, false);
+		return false;
+	}
+
+	uint timeout_id = 0;
+	timeout_id = Timeout.add_seconds(SHOW_IF_TRUE_TIMEOUT, () => {
+		Posix.kill((Posix.pid_t)pid, Posix.SIGKILL);
+		timeout_id = 0;
+		return false;
+	});
+	ChildWatch.add(pid, (child, child_status) => {
+		if(timeout_id != 0)
+			Source.remove(timeout_id);
+		finish_async_test(key, is_exit_success(child_status));
+		Process.close_pid(child);
+	});
+	return value;
+}
+
+// returns true if D-Bus name had an owner last time it was tested
+private bool is_service_registered(string service) {
+	var key = @"registered:$service";
+	bool start;
+	bool value = start_async_test(key, out start);
+	if(!start)
+		return value;
+
+	// References:
+	// http://people.freedesktop.org/~david/eggdbus-20091014/eggdbus-interface-org.freedesktop.DBus.html#eggdbus-method-org.freedesktop.DBus.NameHasOwner
+	// glib source code: gio/tests/gdbus-names.c
+	Bus.get.begin(BusType.SESSION, null, (obj, res) => {
+		DBusConnection con;
+		try {
+			con = Bus.get.end(res);
+		}
+		catch(Error err) {
+			finish_async_test(key, false);
+			return;
+		}
+		con.call.begin("org.freedesktop.DBus",
+					   "/org/freedesktop/DBus",
+					   "org.freedesktop.DBus",
+					   "NameHasOwner",
+					   new Variant("(s)", service),
+					   new VariantType("(b)"),
+					   DBusCallFlags.NONE,
+					   SHOW_IF_REGISTERED_TIMEOUT,
+					   null,
+					   (con_obj, call_res) => {
+			bool name_has_owner = false;
+			try {
+				var reply = con.call.end(call_res);
+				reply.get("(b)", out name_has_owner);
+				// stdout.printf("check if service: %s is in use: %d\n", service, (int)name_has_owner);
+			}
+			catch(Error err) {
+			}
+			finish_async_test(key, name_has_owner);
+		});
+	});
+	return value;
+}
+
+// the same test as `pgrep -x name` but without spawning it
+private bool is_process_running(string name) {
+	Dir dir;
+	try {
+		dir = Dir.open("/proc");
+	}
+	catch(FileError err) {
+		// no procfs, pgrep is not fully portable, but we have no better options here
+		var pgrep = Environment.find_program_in_path("pgrep");
+		int exit_status;
+		if(pgrep == null)
+			return false;
+		try {
+			return Process.spawn_command_line_sync(@"$pgrep -x '$name'",
+												   null, null, out exit_status)
+				   && exit_status == 0;
+		}
+		catch(SpawnError spawn_err) {
+			return false;
+		}
+	}
+
+	unowned string? entry;
+	while((entry = dir.read_name()) != null) {
+		if(!entry[0].isdigit())
+			continue;
+		string comm;
+		try {
+			FileUtils.get_contents(@"/proc/$entry/comm", out comm);
+		}
+		catch(FileError err) {
+			continue; // the process is gone
+		}
+		string proc_name = comm.chomp();
+		// the kernel truncates process names to 15 characters
+		if(proc_name == name || (proc_name.length == 15 && name.has_prefix(proc_name)))
+			return true;
+	}
+	return false;
+}
+
+// Facts about selected files which conditions test. They are gathered
+// once per selection and shared by all actions and profiles, and the
+// lists of MIME types, schemes and folders contain each value once.
+[Compact]
+internal class FileActionSelection {
+	public FileActionSelection(List<FileInfo> files) {
+		var seen = new HashTable<string, string>(str_hash, str_equal);
+		this.files = files;
+		n_files = files.length();
+		names = new string?[(int)n_files];
+		int i = 0;
+		foreach(unowned FileInfo fi in files) {
+			names[i++] = fi.get_name();
+			if(fi.is_dir())
+				n_dirs++;
+
+			unowned string type = fi.get_mime_type().get_type();
+			var key = @"m:$type";
+			if(seen.lookup(key) == null) {
+				seen.insert(key, key);
+				mime_types += type;
+			}
+
+			var scheme = Uri.parse_scheme(fi.get_path().to_uri()) ?? "";
+			key = @"s:$scheme";
+			if(seen.lookup(key) == null) {
+				seen.insert(key, key);
+				schemes += scheme;
+			}
+
+			unowned Path? parent = fi.get_path().get_parent();
+			var dirname = parent != null ? parent.to_str() : "/";
+			key = @"d:$dirname";
+			if(seen.lookup(key) == null) {
+				seen.insert(key, key);
+				folders += dirname;
+			}
+		}
+	}
+
+	// names are casefolded only if some condition needs them so
+	public unowned string?[] get_casefolded_names() {
+		if(casefolded_names == null) {
+			casefolded_names = new string?[(int)n_files];
+			for(int i = 0; i < n_files; ++i)
+				casefolded_names[i] = names[i] != null ? names[i].casefold() : null;
+		}
+		return casefolded_names;
+	}
+
+	// major MIME type with trailing slash if all files have the same one
+	public string? get_common_media() {
+		string? media = null;
+		foreach(unowned string type in mime_types) {
+			int slash = type.index_of_char('/');
+			if(slash < 0)
+				return null;
+			var prefix = type.substring(0, slash + 1);
+			if(media == null)
+				media = prefix;
+			else if(media != prefix)
+				return null;
+		}
+		return media;
+	}
+
+	public unowned List<FileInfo> files;
+	public uint n_files;
+	public uint n_dirs;
+	public string?[] names;
+	private string?[]? casefolded_names;
+	public string[] mime_types;
+	public string[] schemes;
+	public string[] folders;
+}
+
 [Compact]
 public class FileActionCondition {
 	
@@ -75,6 +393,90 @@ public class FileActionCondition {
 		foreach(unowned string cap in caps) {
 			stdin.printf("%s\n", cap);
 		}
+
+		compile();
+	}
+
+	// compiles rule lists so evaluation doesn't parse them again
+	private void compile() {
+		if(mime_types != null) {
+			foreach(unowned string str in mime_types) {
+				var rule = new FileActionRule(str);
+				if(rule.value == "all/all" || rule.value == "*")
+					rule.kind = FileActionMimeRuleKind.ALL;
+				else if(rule.value == "all/allfiles")
+					rule.kind = FileActionMimeRuleKind.ALL_FILES;
+				else if(rule.value.has_suffix("/*")) {
+					rule.kind = FileActionMimeRuleKind.PREFIX;
+					rule.value = rule.value[0:-1];
+				}
+				else
+					rule.kind = FileActionMimeRuleKind.EXACT;
+				mime_rules += (owned) rule;
+			}
+		}
+		if(base_names != null) {
+			foreach(unowned string str in base_names) {
+				var rule = new FileActionRule(str);
+				// FIXME: is casefolding of pattern correct?
+				rule.pattern = new PatternSpec(match_case ? rule.value : rule.value.casefold());
+				base_name_rules += (owned) rule;
+			}
+		}
+		if(schemes != null) {
+			foreach(unowned string str in schemes) {
+				scheme_rules += new FileActionRule(str);
+			}
+		}
+		if(folders != null) {
+			foreach(unowned string str in folders) {
+				var rule = new FileActionRule(str);
+				// trailing /* should always be implied.
+				if(rule.value.has_suffix("/*"))
+					rule.pattern = new PatternSpec(rule.value);
+				else
+					rule.pattern = new PatternSpec(@"$(rule.value)/*");
+				folder_rules += (owned) rule;
+			}
+		}
+	}
+
+	// Adds keys of MIME types selection should have to match the condition
+	// in form of "m:type", "m:media/*" or "m:all/allfiles".
+	// Returns false if the condition doesn't restrict MIME types that way.
+	internal bool add_mime_keys(HashTable<string, string> keys) {
+		if(mime_types == null)
+			return false;
+		// only positive rules are ORed, and without them nothing matches
+		foreach(unowned FileActionRule rule in mime_rules) {
+			if(rule.negated)
+				continue;
+			switch(rule.kind) {
+			case FileActionMimeRuleKind.ALL:
+				return false;
+			case FileActionMimeRuleKind.PREFIX:
+				// media is compared, so "a/b/*" cannot be indexed
+				if(rule.value.index_of_char('/') != rule.value.length - 1)
+					return false;
+				keys.insert(@"m:$(rule.value)*", "");
+				break;
+			default:
+				keys.insert(@"m:$(rule.value)", "");
+				break;
+			}
+		}
+		return true;
+	}
+
+	// The same as add_mime_keys() but for schemes, keys are "s:scheme".
+	internal bool add_scheme_keys(HashTable<string, string> keys) {
+		if(schemes == null)
+			return false;
+		foreach(unowned FileActionRule rule in scheme_rules) {
+			if(!rule.negated)
+				keys.insert(@"s:$(rule.value)", "");
+		}
+		return true;
 	}
 
 #if 0
@@ -141,41 +543,16 @@ public class FileActionCondition {
 		if(show_if_registered != null) {
 			// stdout.printf("    ShowIfRegistered: %s\n", show_if_registered);
 			var service = FileActionParameters.expand(show_if_registered, files);
-			// References:
-			// http://people.freedesktop.org/~david/eggdbus-20091014/eggdbus-interface-org.freedesktop.DBus.html#eggdbus-method-org.freedesktop.DBus.NameHasOwner
-			// glib source code: gio/tests/gdbus-names.c
-			try {
-				var con = Bus.get_sync(BusType.SESSION);
-				var result = con.call_sync("org.freedesktop.DBus",
-											"/org/freedesktop/DBus",
-											"org.freedesktop.DBus",
-											"NameHasOwner",
-											new Variant("(s)", service),
-											new VariantType("(b)"),
-											DBusCallFlags.NONE, -1);
-				bool name_has_owner;
-				result.get("(b)", out name_has_owner);
-				// stdout.printf("check if service: %s is in use: %d\n", service, (int)name_has_owner);
-				if(!name_has_owner)
-					return false;
-			}
-			catch(IOError err) {
+			if(!is_service_registered(service))
 				return false;
-			}
 		}
 		return true;
 	}
-	
+
 	private inline bool match_show_if_true(List<FileInfo> files) {
 		if(show_if_true != null) {
 			var cmd = FileActionParameters.expand(show_if_true, files);
-			int exit_status;
-			// FIXME: Process.spawn cannot handle shell commands. Use Posix.system() instead.
-			//if(!Process.spawn_command_line_sync(cmd, null, null, out exit_status)
-			//	|| exit_status != 0)
-			//	return false;
-			exit_status = Posix.system(cmd);
-			if(exit_status != 0)
+			if(!run_test_command(cmd))
 				return false;
 		}
 		return true;
@@ -184,303 +561,110 @@ public class FileActionCondition {
 	private inline bool match_show_if_running(List<FileInfo> files) {
 		if(show_if_running != null) {
 			var process_name = FileActionParameters.expand(show_if_running, files);
-			var pgrep = Environment.find_program_in_path("pgrep");
-			bool running = false;
-			// pgrep is not fully portable, but we don't have better options here
-			if(pgrep != null) {
-				int exit_status;
-				if(Process.spawn_command_line_sync(@"$pgrep -x '$process_name'", 
-												null, null, out exit_status)) {
-					if(exit_status == 0)
-						running = true;
-				}
-			}
+			var key = @"running:$process_name";
+			unowned FileActionTestResult? result = lookup_test_result(key);
+			if(result != null)
+				return result.value;
+			bool running = is_process_running(process_name);
+			set_test_result(key, running);
 			if(!running)
 				return false;
 		}
 		return true;
 	}
 
-	private inline bool match_mime_type(List<FileInfo> files, string type, bool negated) {
-		// stdout.printf("match_mime_type: %s, neg: %d\n", type, (int)negated);
-
-		if(type == "all/all" || type == "*") {
+	private static bool match_mime_type(FileActionSelection sel, FileActionRule rule) {
+		bool negated = rule.negated;
+		switch(rule.kind) {
+		case FileActionMimeRuleKind.ALL:
 			return negated ? false : true;
-		}
-		else if(type == "all/allfiles") {
-			// see if all fileinfos are files
-			if(negated) { // all fileinfos should not be files
-				foreach(unowned FileInfo fi in files) {
-					if(!fi.is_dir()) { // at least 1 of the fileinfos is a file.
-						return false;
-					}
-				}
-			}
-			else { // all fileinfos should be files
-				foreach(unowned FileInfo fi in files) {
-					if(fi.is_dir()) { // at least 1 of the fileinfos is a file.
-						return false;
-					}
-				}
-			}
-		}
-		else if(type.has_suffix("/*")) {
+		case FileActionMimeRuleKind.ALL_FILES:
+			// see if all fileinfos are files (or not files if negated)
+			return negated ? (sel.n_dirs == sel.n_files) : (sel.n_dirs == 0);
+		case FileActionMimeRuleKind.PREFIX:
 			// check if all are subtypes of allowed_type
-			var prefix = type[0:-1];
-			if(negated) { // all files should not have the prefix
-				foreach(unowned FileInfo fi in files) {
-					if(fi.get_mime_type().get_type().has_prefix(prefix)) {
-						return false;
-					}
-				}
-			}
-			else { // all files should have the prefix
-				foreach(unowned FileInfo fi in files) {
-					if(!fi.get_mime_type().get_type().has_prefix(prefix)) {
-						return false;
-					}
-				}
-			}
-		}
-		else {
-			if(negated) { // all files should not be of the type
-				foreach(unowned FileInfo fi in files) {
-					if(fi.get_mime_type().get_type() == type) {
-					// if(ContentType.is_a(type, fi.get_mime_type().get_type())) {
-						return false;
-					}
-				}
-			}
-			else { // all files should be of the type
-				foreach(unowned FileInfo fi in files) {
-					// stdout.printf("get_type: %s, type: %s\n", fi.get_mime_type().get_type(), type);
-					if(fi.get_mime_type().get_type() != type) {
-					// if(!ContentType.is_a(type, fi.get_mime_type().get_type())) {
-						return false;
-					}
-				}
+			foreach(unowned string type in sel.mime_types) {
+				if(type.has_prefix(rule.value) == negated)
+					return false;
 			}
-		}
-		return true;
-	}
-
-	private inline bool match_mime_types(List<FileInfo> files) {
-		if(mime_types != null) {
-			bool allowed = false;
-			// FIXME: this is inefficient, but easier to implement
-			// check if all of the mime_types are allowed
-			foreach(unowned string allowed_type in mime_types) {
-				unowned string type;
-				bool negated;
-				if(allowed_type[0] == '!') {
-					type = (string)((uint8*)allowed_type + 1);
-					negated = true;
-				}
-				else {
-					type = allowed_type;
-					negated = false;
-				}
-
-				if(negated) { // negated mime_type rules are ANDed
-					bool type_is_allowed = match_mime_type(files, type, negated);
-					if(!type_is_allowed) // so any mismatch is not allowed
-						return false;
-				}
-				else { // other mime_type rules are ORed
-					// matching any one of the mime_type is enough
-					if(!allowed) { // if no rule is matched yet
-						allowed = match_mime_type(files, type, false);
-					}
-				}
+			break;
+		default:
+			// all files should be of the type, or none if negated
+			foreach(unowned string type in sel.mime_types) {
+				if((type == rule.value) == negated)
+					return false;
 			}
-			return allowed;
+			break;
 		}
 		return true;
 	}
 
-	private inline bool match_base_name(List<FileInfo> files, string base_name, bool negated) {
+	private static bool match_base_name(FileActionSelection sel, FileActionRule rule, bool match_case) {
 		// see if all files has the base_name
-		// FIXME: this is inefficient, some optimization is needed later
-		PatternSpec pattern;
+		unowned string?[] names;
 		if(match_case)
-			pattern= new PatternSpec(base_name);
+			names = sel.names;
 		else
-			pattern= new PatternSpec(base_name.casefold()); // FIXME: is this correct?
-		foreach(unowned FileInfo fi in files) {
-			var name = fi.get_name();
-			if(match_case) {
-				if(pattern.match_string(name)) {
-					// at least 1 file has the base_name
-					if(negated)
-						return false;
-				}
-				else {
-					// at least 1 file does not has the scheme
-					if(!negated)
-						return false;
-				}
-			}
-			else {
-				if(pattern.match_string(name.casefold())) {
-					// at least 1 file has the base_name
-					if(negated)
-						return false;
-				}
-				else {
-					// at least 1 file does not has the scheme
-					if(!negated)
-						return false;
-				}
-			}
-		}
-		return true;
-	}
-
-	private inline bool match_base_names(List<FileInfo> files) {
-		if(base_names != null) {
-			bool allowed = false;
-			// FIXME: this is inefficient, but easier to implement
-			// check if all of the base_names are allowed
-			foreach(unowned string allowed_name in base_names) {
-				unowned string name;
-				bool negated;
-				if(allowed_name[0] == '!') {
-					name = (string)((uint8*)allowed_name + 1);
-					negated = true;
-				}
-				else {
-					name = allowed_name;
-					negated = false;
-				}
-
-				if(negated) { // negated base_name rules are ANDed
-					bool name_is_allowed = match_base_name(files, name, negated);
-					if(!name_is_allowed) // so any mismatch is not allowed
-						return false;
-				}
-				else { // other base_name rules are ORed
-					// matching any one of the base_name is enough
-					if(!allowed) { // if no rule is matched yet
-						allowed = match_base_name(files, name, false);
-					}
-				}
-			}
-			return allowed;
+			names = sel.get_casefolded_names();
+		foreach(unowned string? name in names) {
+			if(rule.pattern.match_string(name ?? "") == rule.negated)
+				return false;
 		}
 		return true;
 	}
 
-	private static bool match_scheme(List<FileInfo> files, string scheme, bool negated) {
-		// FIXME: this is inefficient, some optimization is needed later
+	private static bool match_scheme(FileActionSelection sel, FileActionRule rule) {
 		// see if all files has the scheme
-		foreach(unowned FileInfo fi in files) {
-			var uri = fi.get_path().to_uri();
-			if(Uri.parse_scheme(uri) == scheme) {
-				// at least 1 file has the scheme
-				if(negated)
-					return false;
-			}
-			else {
-				// at least 1 file does not has the scheme
-				if(!negated)
-					return false;
-			}
-		}
-		return true;
-	}
-
-	private inline bool match_schemes(List<FileInfo> files) {
-		if(schemes != null) {
-			bool allowed = false;
-			// FIXME: this is inefficient, but easier to implement
-			// check if all of the schemes are allowed
-			foreach(unowned string allowed_scheme in schemes) {
-				unowned string scheme;
-				bool negated;
-				if(allowed_scheme[0] == '!') {
-					scheme = (string)((uint8*)allowed_scheme + 1);
-					negated = true;
-				}
-				else {
-					scheme = allowed_scheme;
-					negated = false;
-				}
-
-				if(negated) { // negated scheme rules are ANDed
-					bool scheme_is_allowed = match_scheme(files, scheme, negated);
-					if(!scheme_is_allowed) // so any mismatch is not allowed
-						return false;
-				}
-				else { // other scheme rules are ORed
-					// matching any one of the scheme is enough
-					if(!allowed) { // if no rule is matched yet
-						allowed = match_scheme(files, scheme, false);
-					}
-				}
-			}
-			return allowed;
+		foreach(unowned string scheme in sel.schemes) {
+			if((scheme == rule.value) == rule.negated)
+				return false;
 		}
 		return true;
 	}
 
-	private static bool match_folder(List<FileInfo> files, string folder, bool negated) {
-		// trailing /* should always be implied.
-		// FIXME: this is inefficient, some optimization is needed later
-		PatternSpec pattern;
-		if(folder.has_suffix("/*"))
-			pattern = new PatternSpec(folder);
-		else
-			pattern = new PatternSpec(@"$folder/*");
-		foreach(unowned FileInfo fi in files) {
-			var dirname = fi.get_path().get_parent().to_str();
-			if(pattern.match_string(dirname)) { // at least 1 file is in the folder
-				if(negated)
-					return false;
-			}
-			else {
-				if(!negated)
-					return false;
-			}
+	private static bool match_folder(FileActionSelection sel, FileActionRule rule) {
+		// see if all files are in the folder
+		foreach(unowned string dirname in sel.folders) {
+			if(rule.pattern.match_string(dirname) == rule.negated)
+				return false;
 		}
 		return true;
 	}
 
-	private inline bool match_folders(List<FileInfo> files) {
-		if(folders != null) {
-			bool allowed = false;
-			// FIXME: this is inefficient, but easier to implement
-			// check if all of the schemes are allowed
-			foreach(unowned string allowed_folder in folders) {
-				unowned string folder;
-				bool negated;
-				if(allowed_folder[0] == '!') {
-					folder = (string)((uint8*)allowed_folder + 1);
-					negated = true;
-				}
-				else {
-					folder = allowed_folder;
-					negated = false;
+	// negated rules are ANDed so any mismatch is not allowed, other
+	// rules are ORed so matching any one of them is enough
+	private inline bool match_rules(FileActionSelection sel, FileActionRule[] rules, FileActionRuleList list) {
+		bool allowed = false;
+		foreach(unowned FileActionRule rule in rules) {
+			if(rule.negated || !allowed) {
+				bool matched;
+				switch(list) {
+				case FileActionRuleList.MIME_TYPES:
+					matched = match_mime_type(sel, rule);
+					break;
+				case FileActionRuleList.BASE_NAMES:
+					matched = match_base_name(sel, rule, match_case);
+					break;
+				case FileActionRuleList.SCHEMES:
+					matched = match_scheme(sel, rule);
+					break;
+				default:
+					matched = match_folder(sel, rule);
+					break;
 				}
-
-				if(negated) { // negated folder rules are ANDed
-					bool folder_is_allowed = match_folder(files, folder, negated);
-					if(!folder_is_allowed) // so any mismatch is not allowed
+				if(rule.negated) {
+					if(!matched)
 						return false;
 				}
-				else { // other folder rules are ORed
-					// matching any one of the folder is enough
-					if(!allowed) { // if no rule is matched yet
-						allowed = match_folder(files, folder, false);
-					}
-				}
+				else
+					allowed = matched;
 			}
-			return allowed;
 		}
-		return true;
+		return allowed;
 	}
 
-	private inline bool match_selection_count(List<FileInfo> files) {
-		uint n_files = files.length();
+	private inline bool match_selection_count(FileActionSelection sel) {
+		uint n_files = sel.n_files;
 		switch(selection_count_cmp) {
 		case '<':
 			if(n_files >= selection_count)
@@ -504,22 +688,28 @@ public class FileActionCondition {
 	}
 
 	public bool match(List<FileInfo> files) {
+		return match_selection(new FileActionSelection(files));
+	}
+
+	internal bool match_selection(FileActionSelection sel) {
+		unowned List<FileInfo> files = sel.files;
 		// all of the condition are combined with AND
 		// So, if any one of the conditions is not matched, we quit.
+		// Cheap tests on the selection facts go first.
 
-		// TODO: OnlyShowIn, NotShowIn
-		if(!match_try_exec(files))
+		if(!match_selection_count(sel))
 			return false;
-
-		if(!match_mime_types(files))
+		if(mime_types != null && !match_rules(sel, mime_rules, FileActionRuleList.MIME_TYPES))
 			return false;
-		if(!match_base_names(files))
+		if(schemes != null && !match_rules(sel, scheme_rules, FileActionRuleList.SCHEMES))
 			return false;
-		if(!match_selection_count(files))
+		if(folders != null && !match_rules(sel, folder_rules, FileActionRuleList.FOLDERS))
 			return false;
-		if(!match_schemes(files))
+		if(base_names != null && !match_rules(sel, base_name_rules, FileActionRuleList.BASE_NAMES))
 			return false;
-		if(!match_folders(files))
+
+		// TODO: OnlyShowIn, NotShowIn
+		if(!match_try_exec(files))
 			return false;
 		// TODO: Capabilities
 		// currently, due to limitations of Fm.FileInfo, this cannot
@@ -551,6 +741,11 @@ public class FileActionCondition {
 	public string[]? schemes;
 	public string[]? folders;
 	public FileActionCapability capabilities;
+
+	internal FileActionRule[] mime_rules;
+	internal FileActionRule[] base_name_rules;
+	internal FileActionRule[] scheme_rules;
+	internal FileActionRule[] folder_rules;
 }
 
 }
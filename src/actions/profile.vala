@@ -132,8 +132,12 @@ public class FileActionProfile {
 	}
 
 	public bool match(List<FileInfo> files) {
-		stdout.printf("  match profile: %s\n", id);
-		return condition.match(files);
+		return match_selection(new FileActionSelection(files));
+	}
+
+	internal bool match_selection(FileActionSelection sel) {
+		// stdout.printf("  match profile: %s\n", id);
+		return condition.match_selection(sel);
 	}
 
 	public string id;
@@ -552,3 +552,167 @@ GAppInfo* fm_app_info_create_from_commandline(const char *commandline,
     g_object_set_data(G_OBJECT(app), "flags", GUINT_TO_POINTER(flags));
     return app;
 }
+
+/* cache of default applications: content type (or "x-scheme-handler/"
+   followed by scheme) -> GAppInfo, NULL values are cached too. The cache
+   is dropped when any mimeapps.list or applications folder is changed.
+   It is enabled only when first used from the main thread because file
+   monitors deliver events into the main loop. */
+G_LOCK_DEFINE_STATIC(default_apps);
+static GHashTable *default_apps = NULL;
+static guint default_apps_serial = 0;
+static GSList *default_apps_monitors = NULL;
+
+static void _default_app_free(gpointer app)
+{
+    if (app)
+        g_object_unref(app);
+}
+
+static void on_default_apps_changed(GFileMonitor *mon, GFile *gf, GFile *other,
+                                    GFileMonitorEvent evt, gpointer user_data)
+{
+    /* config dirs contain much more than mimeapps.list so filter them */
+    if (user_data)
+    {
+        char *name = g_file_get_basename(gf);
+        gboolean skip = !g_str_has_suffix(name, "mimeapps.list");
+
+        g_free(name);
+        if (skip)
+            return;
+    }
+    G_LOCK(default_apps);
+    if (default_apps)
+        g_hash_table_remove_all(default_apps);
+    default_apps_serial++;
+    G_UNLOCK(default_apps);
+}
+
+static void _add_default_apps_monitor(const char *dir, const char *subdir,
+                                      gboolean is_config)
+{
+    char *path = g_build_filename(dir, subdir, NULL);
+    GFile *gf = g_file_new_for_path(path);
+    GFileMonitor *mon = g_file_monitor_directory(gf, G_FILE_MONITOR_NONE, NULL, NULL);
+
+    g_object_unref(gf);
+    g_free(path);
+    if (mon == NULL)
+        return;
+    g_signal_connect(mon, "changed", G_CALLBACK(on_default_apps_changed),
+                     GINT_TO_POINTER(is_config));
+    default_apps_monitors = g_slist_prepend(default_apps_monitors, mon);
+}
+
+/* should be called with default_apps locked */
+static void _default_apps_init(void)
+{
+    const gchar * const *dirs;
+
+    default_apps = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                         _default_app_free);
+    _add_default_apps_monitor(g_get_user_config_dir(), NULL, TRUE);
+    for (dirs = g_get_system_config_dirs(); *dirs; dirs++)
+        _add_default_apps_monitor(*dirs, NULL, TRUE);
+    /* desktop entries are watched as well: installed or removed application
+       changes defaults the same way as mimeapps.list or mimeinfo.cache */
+    _add_default_apps_monitor(g_get_user_data_dir(), "applications", FALSE);
+    for (dirs = g_get_system_data_dirs(); *dirs; dirs++)
+        _add_default_apps_monitor(*dirs, "applications", FALSE);
+}
+
+void _fm_app_info_finalize(void)
+{
+    GSList *l;
+
+    for (l = default_apps_monitors; l; l = l->next)
+    {
+        g_file_monitor_cancel(l->data);
+        g_object_unref(l->data);
+    }
+    g_slist_free(default_apps_monitors);
+    default_apps_monitors = NULL;
+    G_LOCK(default_apps);
+    if (default_apps)
+        g_hash_table_destroy(default_apps);
+    default_apps = NULL;
+    G_UNLOCK(default_apps);
+}
+
+static GAppInfo *_get_default_app(const char *key, const char *type,
+                                  const char *scheme)
+{
+    gpointer cached;
+    GAppInfo *app;
+    guint serial;
+
+    G_LOCK(default_apps);
+    if (default_apps == NULL && g_main_context_is_owner(g_main_context_default()))
+        _default_apps_init();
+    if (default_apps && g_hash_table_lookup_extended(default_apps, key, NULL, &cached))
+    {
+        app = cached ? g_object_ref(cached) : NULL;
+        G_UNLOCK(default_apps);
+        return app;
+    }
+    serial = default_apps_serial;
+    G_UNLOCK(default_apps);
+    /* GIO reads the mimeapps.list files and desktop entries here */
+    if (type)
+        app = g_app_info_get_default_for_type(type, FALSE);
+    else
+        app = g_app_info_get_default_for_uri_scheme(scheme);
+    G_LOCK(default_apps);
+    /* don't cache result if database was changed meanwhile */
+    if (default_apps && serial == default_apps_serial)
+        g_hash_table_insert(default_apps, g_strdup(key),
+                            app ? g_object_ref(app) : NULL);
+    G_UNLOCK(default_apps);
+    return app;
+}
+
+/**
+ * fm_app_info_get_default_for_type
+ * @content_type: the content type to find a #GAppInfo for
+ *
+ * Retrieves the default application to open files of given type. This
+ * is the same as g_app_info_get_default_for_type() but the result is
+ * cached until user changes default applications or set of installed
+ * applications is changed.
+ *
+ * Returns: (transfer full): the default #GAppInfo for @content_type or
+ * %NULL if there is no default application set for it.
+ *
+ * Since: 1.3.0
+ */
+GAppInfo *fm_app_info_get_default_for_type(const char *content_type)
+{
+    g_return_val_if_fail(content_type != NULL, NULL);
+    return _get_default_app(content_type, content_type, NULL);
+}
+
+/**
+ * fm_app_info_get_default_for_uri_scheme
+ * @uri_scheme: a string containing a URI scheme
+ *
+ * Retrieves the default application to handle URIs with given scheme.
+ * This is the same as g_app_info_get_default_for_uri_scheme() but the
+ * result is cached the same way as for fm_app_info_get_default_for_type().
+ *
+ * Returns: (transfer full): the default #GAppInfo for @uri_scheme or
+ * %NULL if there is no default application set for it.
+ *
+ * Since: 1.3.0
+ */
+GAppInfo *fm_app_info_get_default_for_uri_scheme(const char *uri_scheme)
+{
+    char *key;
+    GAppInfo *app;
+
+    g_return_val_if_fail(uri_scheme != NULL, NULL);
+    key = g_strconcat("x-scheme-handler/", uri_scheme, NULL);
+    app = _get_default_app(key, NULL, uri_scheme);
+    g_free(key);
+    return app;
+}
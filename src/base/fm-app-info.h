@@ -42,6 +42,11 @@ GAppInfo* fm_app_info_create_from_commandline(const char *commandline,
                                               GAppInfoCreateFlags flags,
                                               GError **error);
 
+GAppInfo *fm_app_info_get_default_for_type(const char *content_type);
+GAppInfo *fm_app_info_get_default_for_uri_scheme(const char *uri_scheme);
+
+void _fm_app_info_finalize(void);
+
 G_END_DECLS
 
 #endif /* __FM_APP_INFO_H__ */
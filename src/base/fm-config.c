@@ -58,6 +58,15 @@ static void fm_config_finalize              (GObject *object);
 
 G_DEFINE_TYPE(FmConfig, fm_config, G_TYPE_OBJECT);
 
+/* new fields should fit into space of 1.2.x reserved pointers: six int
+   sized fields take 24 bytes, which is less than seven pointers even on
+   32-bit systems, and _reserved[] fills the rest of that space, so the
+   offset of _cfg_mon and the size of FmConfig are the same as in 1.2.x.
+   Adding a field requires taking one int from _reserved[] and on 32-bit
+   there is only one left. */
+G_STATIC_ASSERT(G_STRUCT_OFFSET(FmConfig, _cfg_mon) ==
+                G_STRUCT_OFFSET(FmConfig, saved_search) + 8 * sizeof(gpointer));
+
 
 static void fm_config_class_init(FmConfigClass *klass)
 {
@@ -174,6 +183,12 @@ static void fm_config_init(FmConfig *self)
     self->places_network = FM_CONFIG_DEFAULT_PLACES_NETWORK;
     self->places_unmounted = FM_CONFIG_DEFAULT_PLACES_UNMOUNTED;
     self->smart_desktop_autodrop = FM_CONFIG_DEFAULT_SMART_DESKTOP_AUTODROP;
+    self->folder_cache_size = FM_CONFIG_DEFAULT_FOLDER_CACHE_SIZE;
+    self->folder_cache_memory = FM_CONFIG_DEFAULT_FOLDER_CACHE_MEMORY;
+    self->listing_snapshots = FM_CONFIG_DEFAULT_LISTING_SNAPSHOTS;
+    self->defer_conflicts = FM_CONFIG_DEFAULT_DEFER_CONFLICTS;
+    self->places_probe_timeout = FM_CONFIG_DEFAULT_PLACES_PROBE_TIMEOUT;
+    self->desktop_entry_cache = FM_CONFIG_DEFAULT_DESKTOP_ENTRY_CACHE;
 }
 
 /**
@@ -284,6 +299,11 @@ void fm_config_load_from_key_file(FmConfig* cfg, GKeyFile* kf)
     fm_key_file_get_bool(kf, "config", "defer_content_test", &cfg->defer_content_test);
     fm_key_file_get_bool(kf, "config", "quick_exec", &cfg->quick_exec);
     fm_key_file_get_bool(kf, "config", "smart_desktop_autodrop", &cfg->smart_desktop_autodrop);
+    fm_key_file_get_int(kf, "config", "folder_cache_size", &cfg->folder_cache_size);
+    fm_key_file_get_int(kf, "config", "folder_cache_memory", &cfg->folder_cache_memory);
+    fm_key_file_get_bool(kf, "config", "listing_snapshots", &cfg->listing_snapshots);
+    fm_key_file_get_bool(kf, "config", "defer_conflicts", &cfg->defer_conflicts);
+    fm_key_file_get_bool(kf, "config", "desktop_entry_cache", &cfg->desktop_entry_cache);
     g_free(cfg->format_cmd);
     cfg->format_cmd = g_key_file_get_string(kf, "config", "format_cmd", NULL);
     /* append blacklist */
@@ -317,6 +337,7 @@ void fm_config_load_from_key_file(FmConfig* cfg, GKeyFile* kf)
     fm_key_file_get_bool(kf, "places", "places_applications", &cfg->places_applications);
     fm_key_file_get_bool(kf, "places", "places_network", &cfg->places_network);
     fm_key_file_get_bool(kf, "places", "places_unmounted", &cfg->places_unmounted);
+    fm_key_file_get_int(kf, "places", "places_probe_timeout", &cfg->places_probe_timeout);
 }
 
 /**
@@ -504,6 +525,11 @@ void fm_config_save(FmConfig* cfg, const char* name)
                 _save_config_strv(str, cfg, modules_blacklist);
                 _save_config_strv(str, cfg, modules_whitelist);
                 _save_config_bool(str, cfg, smart_desktop_autodrop);
+                _save_config_int(str, cfg, folder_cache_size);
+                _save_config_int(str, cfg, folder_cache_memory);
+                _save_config_bool(str, cfg, listing_snapshots);
+                _save_config_bool(str, cfg, defer_conflicts);
+                _save_config_bool(str, cfg, desktop_entry_cache);
             g_string_append(str, "\n[ui]\n");
                 _save_config_int(str, cfg, big_icon_size);
                 _save_config_int(str, cfg, small_icon_size);
@@ -524,6 +550,7 @@ void fm_config_save(FmConfig* cfg, const char* name)
                 _save_config_bool(str, cfg, places_applications);
                 _save_config_bool(str, cfg, places_network);
                 _save_config_bool(str, cfg, places_unmounted);
+                _save_config_int(str, cfg, places_probe_timeout);
             fwrite(str->str, 1, str->len, f);
             fclose(f);
             g_string_free(str, TRUE);
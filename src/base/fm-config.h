@@ -82,6 +82,13 @@ typedef struct _FmConfigClass       FmConfigClass;
 
 #define     FM_CONFIG_DEFAULT_AUTO_SELECTION_DELAY 600
 
+#define     FM_CONFIG_DEFAULT_FOLDER_CACHE_SIZE 8
+#define     FM_CONFIG_DEFAULT_FOLDER_CACHE_MEMORY 16384
+#define     FM_CONFIG_DEFAULT_LISTING_SNAPSHOTS FALSE
+#define     FM_CONFIG_DEFAULT_DEFER_CONFLICTS FALSE
+#define     FM_CONFIG_DEFAULT_PLACES_PROBE_TIMEOUT 3
+#define     FM_CONFIG_DEFAULT_DESKTOP_ENTRY_CACHE FALSE
+
 /* this enum is used by FmDndDest but we save it nicely in config so have it here */
 
 /**
@@ -146,6 +153,12 @@ typedef enum
  * @format_cmd: (since 1.2.0) command to format the volume (device will be added)
  * @smart_desktop_autodrop: (since 1.2.0) enable "smart shortcut" auto-action for ~/Desktop
  * @saved_search: (since 1.2.0) internal saved data of fm_launch_search_simple()
+ * @folder_cache_size: (since 1.3.0) max number of released folders kept loaded
+ * @folder_cache_memory: (since 1.3.0) max memory used by released folders, in KB
+ * @listing_snapshots: (since 1.3.0) keep listings of remote folders on disk
+ * @defer_conflicts: (since 1.3.0) ask about existing files at end of copy or move
+ * @places_probe_timeout: (since 1.3.0) seconds to wait for Places item info before showing it as unavailable, 0 to wait forever
+ * @desktop_entry_cache: (since 1.3.0) keep parsed desktop entries on disk between sessions
  */
 struct _FmConfig
 {
@@ -207,14 +220,16 @@ struct _FmConfig
 
     gboolean smart_desktop_autodrop;
     gchar *saved_search;
+    gint folder_cache_size;
+    gint folder_cache_memory;
+    gint places_probe_timeout;
+    gboolean listing_snapshots;
+    gboolean defer_conflicts;
+    gboolean desktop_entry_cache;
     /*< private >*/
-    gpointer _reserved1; /* reserved space for updates until next ABI */
-    gpointer _reserved2;
-    gpointer _reserved3;
-    gpointer _reserved4;
-    gpointer _reserved5;
-    gpointer _reserved6;
-    gpointer _reserved7;
+    /* fields above took place of gpointer _reserved1..7 of 1.2.x, the
+       rest of that space is still reserved for updates until next ABI */
+    gint _reserved[7 * sizeof(gpointer) / sizeof(gint) - 6];
     GFileMonitor *_cfg_mon;
 };
 
@@ -0,0 +1,335 @@
+/*
+ *      fm-desktop-entry-cache.c
+ *
+ *      This file is a part of the Libfm library.
+ *
+ *      This library is free software; you can redistribute it and/or
+ *      modify it under the terms of the GNU Lesser General Public
+ *      License as published by the Free Software Foundation; either
+ *      version 2.1 of the License, or (at your option) any later version.
+ *
+ *      This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Cache of fields parsed from desktop entry files, so folders such as
+ * /usr/share/applications or crowded ~/Desktop aren't parsed again on each
+ * visit. Entries are keyed by device and inode and are valid while file
+ * mtime (with nanoseconds where available) and size are the same. The
+ * cache is shared by all folders and may be used from any thread. If
+ * desktop_entry_cache config option is set, the cache is loaded from
+ * $XDG_CACHE_HOME/libfm/desktop-entries on init and saved there on
+ * finalize. The file format uses the primitives of the listing snapshots
+ * (see fm-folder-snapshot.c):
+ *   "FMDENT2\n" magic
+ *   string: locale of messages (file is ignored if it doesn't match)
+ *   uint:   number of entries
+ *   entries: uint dev, ino, mtime, mtime_nsec, size, flags;
+ *            string url, icon, name
+ * where flags bit 0 means the file is not a valid desktop entry and bit 1
+ * is the Hidden key. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "fm-desktop-entry-cache.h"
+#include "fm-folder-snapshot.h"
+#include "fm-config.h"
+
+#include <glib/gstdio.h>
+#include <locale.h>
+#include <string.h>
+
+#define DENT_MAGIC              "FMDENT2\n"
+#define DENT_MAGIC_LEN          8
+/* the cache is simply dropped when it grows over this */
+#define DENT_CACHE_MAX_ENTRIES  20000
+
+/* files saved within the same second should not be taken for unchanged */
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+#define STAT_MTIME_NSEC(st)     ((guint32)(st)->st_mtim.tv_nsec)
+#else
+#define STAT_MTIME_NSEC(st)     0
+#endif
+
+enum
+{
+    DENT_INVALID = 1 << 0,
+    DENT_HIDDEN = 1 << 1
+};
+
+typedef struct
+{
+    guint64 dev;
+    guint64 ino;
+    gint64 mtime;
+    guint32 mtime_nsec;
+    guint64 size;
+    gboolean invalid;
+    FmDesktopEntryData data;
+} DentEntry;
+
+G_LOCK_DEFINE_STATIC(dent_cache);
+static GHashTable *dent_cache = NULL; /* DentEntry -> itself */
+static gboolean dent_cache_dirty = FALSE;
+
+static guint dent_entry_hash(gconstpointer key)
+{
+    const DentEntry *entry = key;
+
+    return (guint)(entry->ino ^ (entry->ino >> 32) ^ (entry->dev * 31));
+}
+
+static gboolean dent_entry_equal(gconstpointer a, gconstpointer b)
+{
+    const DentEntry *ea = a, *eb = b;
+
+    return ea->ino == eb->ino && ea->dev == eb->dev;
+}
+
+static void dent_entry_free(gpointer user_data)
+{
+    DentEntry *entry = user_data;
+
+    g_free(entry->data.url);
+    g_free(entry->data.icon);
+    g_free(entry->data.name);
+    g_slice_free(DentEntry, entry);
+}
+
+static char *_dent_cache_file(void)
+{
+    return g_build_filename(g_get_user_cache_dir(), "libfm", "desktop-entries", NULL);
+}
+
+static const char *_dent_locale(void)
+{
+    const char *locale = setlocale(LC_MESSAGES, NULL);
+
+    return locale ? locale : "C";
+}
+
+static void _dent_cache_load(void)
+{
+    char *file = _dent_cache_file();
+    char *contents = NULL;
+    const char *p, *end, *str;
+    gsize len;
+    guint64 n, dev, ino, mtime, mtime_nsec, size, flags;
+    const char *url, *icon, *name;
+    DentEntry *entry;
+
+    if (!g_file_get_contents(file, &contents, &len, NULL))
+        goto _done;
+    p = contents;
+    end = contents + len;
+    if (len < DENT_MAGIC_LEN || memcmp(p, DENT_MAGIC, DENT_MAGIC_LEN) != 0)
+        goto _broken;
+    p += DENT_MAGIC_LEN;
+    if (!_fm_snapshot_get_string(&p, end, &str))
+        goto _broken;
+    if (g_strcmp0(str, _dent_locale()) != 0) /* names are for other locale */
+        goto _done;
+    if (!_fm_snapshot_get_uint(&p, end, &n) || n > DENT_CACHE_MAX_ENTRIES)
+        goto _broken;
+    while (n-- > 0)
+    {
+        if (!_fm_snapshot_get_uint(&p, end, &dev) ||
+            !_fm_snapshot_get_uint(&p, end, &ino) ||
+            !_fm_snapshot_get_uint(&p, end, &mtime) ||
+            !_fm_snapshot_get_uint(&p, end, &mtime_nsec) ||
+            !_fm_snapshot_get_uint(&p, end, &size) ||
+            !_fm_snapshot_get_uint(&p, end, &flags) ||
+            !_fm_snapshot_get_string(&p, end, &url) ||
+            !_fm_snapshot_get_string(&p, end, &icon) ||
+            !_fm_snapshot_get_string(&p, end, &name))
+            goto _broken;
+        entry = g_slice_new(DentEntry);
+        entry->dev = dev;
+        entry->ino = ino;
+        entry->mtime = (gint64)mtime;
+        entry->mtime_nsec = (guint32)mtime_nsec;
+        entry->size = size;
+        entry->invalid = (flags & DENT_INVALID) != 0;
+        entry->data.hidden = (flags & DENT_HIDDEN) != 0;
+        entry->data.url = g_strdup(url);
+        entry->data.icon = g_strdup(icon);
+        entry->data.name = g_strdup(name);
+        g_hash_table_replace(dent_cache, entry, entry);
+    }
+    goto _done;
+
+_broken:
+    g_debug("ignoring broken desktop entry cache %s", file);
+    g_hash_table_remove_all(dent_cache);
+    g_unlink(file);
+_done:
+    g_free(contents);
+    g_free(file);
+}
+
+static void _dent_cache_save(void)
+{
+    char *file = _dent_cache_file();
+    char *dir = g_path_get_dirname(file);
+    GString *buf;
+    GHashTableIter it;
+    DentEntry *entry;
+
+    buf = g_string_sized_new(DENT_MAGIC_LEN + g_hash_table_size(dent_cache) * 96);
+    g_string_append_len(buf, DENT_MAGIC, DENT_MAGIC_LEN);
+    _fm_snapshot_put_string(buf, _dent_locale());
+    _fm_snapshot_put_uint(buf, g_hash_table_size(dent_cache));
+    g_hash_table_iter_init(&it, dent_cache);
+    while (g_hash_table_iter_next(&it, (gpointer*)&entry, NULL))
+    {
+        _fm_snapshot_put_uint(buf, entry->dev);
+        _fm_snapshot_put_uint(buf, entry->ino);
+        _fm_snapshot_put_uint(buf, (guint64)entry->mtime);
+        _fm_snapshot_put_uint(buf, entry->mtime_nsec);
+        _fm_snapshot_put_uint(buf, entry->size);
+        _fm_snapshot_put_uint(buf, (entry->invalid ? DENT_INVALID : 0) |
+                                   (entry->data.hidden ? DENT_HIDDEN : 0));
+        _fm_snapshot_put_string(buf, entry->data.url);
+        _fm_snapshot_put_string(buf, entry->data.icon);
+        _fm_snapshot_put_string(buf, entry->data.name);
+    }
+    if (g_mkdir_with_parents(dir, 0700) == 0)
+        g_file_set_contents(file, buf->str, buf->len, NULL);
+    g_string_free(buf, TRUE);
+    g_free(dir);
+    g_free(file);
+}
+
+void _fm_desktop_entry_cache_init(void)
+{
+    dent_cache = g_hash_table_new_full(dent_entry_hash, dent_entry_equal,
+                                       NULL, dent_entry_free);
+    if (fm_config->desktop_entry_cache)
+        _dent_cache_load();
+    dent_cache_dirty = FALSE;
+}
+
+void _fm_desktop_entry_cache_finalize(void)
+{
+    G_LOCK(dent_cache);
+    if (dent_cache_dirty && fm_config->desktop_entry_cache)
+        _dent_cache_save();
+    g_hash_table_destroy(dent_cache);
+    dent_cache = NULL;
+    G_UNLOCK(dent_cache);
+}
+
+/* returns FALSE if file isn't a valid desktop entry, sets cacheable to
+   FALSE if it could not be read so the result may be different later */
+static gboolean _parse_desktop_entry(const char *path, FmDesktopEntryData *data,
+                                     gboolean *cacheable)
+{
+    GKeyFile *kf = g_key_file_new();
+    GError *err = NULL;
+    char *type;
+    gboolean ok = FALSE;
+
+    memset(data, 0, sizeof(*data));
+    *cacheable = TRUE;
+    if (!g_key_file_load_from_file(kf, path, 0, &err))
+    {
+        /* access rights may be changed without changing mtime */
+        *cacheable = (err->domain != G_FILE_ERROR);
+        g_error_free(err);
+        goto _out;
+    }
+    /* check if type is correct and supported */
+    type = g_key_file_get_string(kf, G_KEY_FILE_DESKTOP_GROUP,
+                                 G_KEY_FILE_DESKTOP_KEY_TYPE, NULL);
+    if (type == NULL)
+        goto _out;
+    /* FIXME: fail if Type isn't Application or Directory */
+    if (strcmp(type, G_KEY_FILE_DESKTOP_TYPE_LINK) == 0)
+    {
+        data->url = g_key_file_get_string(kf, G_KEY_FILE_DESKTOP_GROUP,
+                                          G_KEY_FILE_DESKTOP_KEY_URL, NULL);
+        /* Link should have URL */
+        if (data->url == NULL)
+        {
+            g_free(type);
+            goto _out;
+        }
+    }
+    g_free(type);
+    data->icon = g_key_file_get_string(kf, G_KEY_FILE_DESKTOP_GROUP,
+                                       G_KEY_FILE_DESKTOP_KEY_ICON, NULL);
+    data->name = g_key_file_get_locale_string(kf, G_KEY_FILE_DESKTOP_GROUP,
+                                              G_KEY_FILE_DESKTOP_KEY_NAME,
+                                              NULL, NULL);
+    data->hidden = g_key_file_get_boolean(kf, G_KEY_FILE_DESKTOP_GROUP,
+                                          G_KEY_FILE_DESKTOP_KEY_HIDDEN, NULL);
+    ok = TRUE;
+_out:
+    g_key_file_free(kf);
+    return ok;
+}
+
+static void _copy_data(FmDesktopEntryData *dest, const FmDesktopEntryData *src)
+{
+    dest->url = g_strdup(src->url);
+    dest->icon = g_strdup(src->icon);
+    dest->name = g_strdup(src->name);
+    dest->hidden = src->hidden;
+}
+
+gboolean _fm_desktop_entry_cache_get(const char *path, const struct stat *st,
+                                     FmDesktopEntryData *data)
+{
+    DentEntry key, *entry;
+    gboolean ok, cacheable;
+
+    key.dev = st->st_dev;
+    key.ino = st->st_ino;
+    G_LOCK(dent_cache);
+    entry = dent_cache ? g_hash_table_lookup(dent_cache, &key) : NULL;
+    if (entry && entry->mtime == (gint64)st->st_mtime &&
+        entry->mtime_nsec == STAT_MTIME_NSEC(st) &&
+        entry->size == (guint64)st->st_size)
+    {
+        ok = !entry->invalid;
+        if (ok)
+            _copy_data(data, &entry->data);
+        G_UNLOCK(dent_cache);
+        return ok;
+    }
+    G_UNLOCK(dent_cache);
+
+    /* parse it outside of the lock, files may be slow to read */
+    ok = _parse_desktop_entry(path, data, &cacheable);
+    if (!cacheable)
+        return ok;
+    entry = g_slice_new(DentEntry);
+    entry->dev = st->st_dev;
+    entry->ino = st->st_ino;
+    entry->mtime = st->st_mtime;
+    entry->mtime_nsec = STAT_MTIME_NSEC(st);
+    entry->size = st->st_size;
+    entry->invalid = !ok;
+    _copy_data(&entry->data, data);
+    G_LOCK(dent_cache);
+    if (dent_cache)
+    {
+        if (g_hash_table_size(dent_cache) >= DENT_CACHE_MAX_ENTRIES)
+            g_hash_table_remove_all(dent_cache);
+        g_hash_table_replace(dent_cache, entry, entry);
+        dent_cache_dirty = TRUE;
+        entry = NULL;
+    }
+    G_UNLOCK(dent_cache);
+    if (entry)
+        dent_entry_free(entry);
+    return ok;
+}
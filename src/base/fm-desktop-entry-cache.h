@@ -0,0 +1,51 @@
+/*
+ *      fm-desktop-entry-cache.h
+ *
+ *      This file is a part of the Libfm library.
+ *
+ *      This library is free software; you can redistribute it and/or
+ *      modify it under the terms of the GNU Lesser General Public
+ *      License as published by the Free Software Foundation; either
+ *      version 2.1 of the License, or (at your option) any later version.
+ *
+ *      This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* This header is internal for libfm and is not installed. */
+
+#ifndef __FM_DESKTOP_ENTRY_CACHE_H__
+#define __FM_DESKTOP_ENTRY_CACHE_H__
+
+#include <glib.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+G_BEGIN_DECLS
+
+/* fields of desktop entry which are used by FmFileInfo */
+typedef struct
+{
+    char *url; /* for Type=Link only */
+    char *icon;
+    char *name; /* localized */
+    gboolean hidden;
+} FmDesktopEntryData;
+
+void _fm_desktop_entry_cache_init(void);
+void _fm_desktop_entry_cache_finalize(void);
+
+/* returns FALSE if path isn't a valid desktop entry, otherwise fills data
+   with newly allocated strings; st is data of path, symlinks followed */
+gboolean _fm_desktop_entry_cache_get(const char *path, const struct stat *st,
+                                     FmDesktopEntryData *data);
+
+G_END_DECLS
+
+#endif /* __FM_DESKTOP_ENTRY_CACHE_H__ */
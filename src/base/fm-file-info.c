@@ -48,9 +48,15 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <fcntl.h>
+#ifdef HAVE_SYS_XATTR_H
+#include <sys/xattr.h>
+#endif
 
 #include "fm-config.h"
 #include "fm-utils.h"
+#include "fm-folder-snapshot.h"
+#include "fm-fs-cache.h"
+#include "fm-desktop-entry-cache.h"
 
 /* support for libmenu-cache 0.4.x */
 #ifndef MENU_CACHE_CHECK_VERSION
@@ -65,6 +71,15 @@
 
 static FmIcon* icon_locked_folder = NULL;
 
+/* statistics for fm_get_memory_stats() */
+static volatile gint n_file_infos = 0;
+
+/* credentials to evaluate access from stat data, captured once */
+static gboolean access_by_mode = FALSE;
+static uid_t access_uid;
+static gid_t *access_groups = NULL; /* primary and supplementary groups */
+static int n_access_groups = 0;
+
 /* all of the user special dirs are direct child of home directory */
 static gboolean special_dirs_all_in_home = TRUE;
 
@@ -139,6 +154,89 @@ struct _FmFileInfoList
     FmList list;
 };
 
+/* returns TRUE if process has any effective capability, i.e. it may
+   bypass permission checks; assumes there are none if it's unknown */
+static gboolean _has_capabilities(void)
+{
+    char *status, *cap;
+    gboolean res = FALSE;
+
+    if (!g_file_get_contents("/proc/self/status", &status, NULL, NULL))
+        return FALSE;
+    cap = strstr(status, "\nCapEff:");
+    if (cap)
+        res = (g_ascii_strtoull(cap + 8, NULL, 16) != 0);
+    g_free(status);
+    return res;
+}
+
+static void _init_access_creds(void)
+{
+    int n;
+
+    /* access() checks real IDs so setuid processes go the slow way, root
+       and processes with capabilities bypass mode bits so are left too */
+    access_uid = getuid();
+    if (access_uid == 0 || access_uid != geteuid() || getgid() != getegid() ||
+        _has_capabilities())
+        return;
+    n = getgroups(0, NULL);
+    if (n < 0)
+        return;
+    access_groups = g_new(gid_t, n + 1);
+    n = getgroups(n, access_groups + 1);
+    if (n < 0)
+    {
+        g_free(access_groups);
+        access_groups = NULL;
+        return;
+    }
+    access_groups[0] = getgid();
+    n_access_groups = n + 1;
+    access_by_mode = TRUE;
+}
+
+/* returns FALSE if file has no ACL entries besides ones for mode bits */
+static gboolean _native_file_has_acl(const char *path, const struct stat *st)
+{
+#if defined(HAVE_SYS_XATTR_H) && defined(ENODATA)
+    /* the attribute exists only for extended ACL, follows symlinks */
+    if (getxattr(path, "system.posix_acl_access", NULL, 0) >= 0)
+        return TRUE;
+    if (errno == ENODATA)
+        return FALSE;
+    if (errno == ENOTSUP)
+    {
+        /* no need to ask it again for files on the same filesystem */
+        _fm_fs_cache_set_no_acl(st->st_dev);
+        return FALSE;
+    }
+#endif
+    return TRUE;
+}
+
+/* evaluates read access for native file without syscall where possible,
+   st should be the data of symlink target */
+static gboolean _native_file_is_readable(const char *path, const struct stat *st)
+{
+    FmFsProps props;
+    int i;
+
+    if (!access_by_mode || !_fm_fs_cache_get_for_dev(st->st_dev, path, &props) ||
+        props.remote)
+        return (g_access(path, R_OK) == 0);
+    /* ACL entry of the owner always matches the user mode bits */
+    if (st->st_uid == access_uid)
+        return (st->st_mode & S_IRUSR) != 0;
+    /* ACL may grant or deny access to others on top of mode bits */
+    if (!props.no_acl && _native_file_has_acl(path, st))
+        return (g_access(path, R_OK) == 0);
+    for (i = 0; i < n_access_groups; i++)
+        if (access_groups[i] == st->st_gid)
+            return (st->st_mode & S_IRGRP) != 0;
+    return (st->st_mode & S_IROTH) != 0;
+}
+
 /* intialize the file info system */
 void _fm_file_info_init(void)
 {
@@ -168,13 +266,27 @@ void _fm_file_info_init(void)
             special_dir_info[i].path_str = path_str;
         }
     }
+    _fm_fs_cache_init();
+    _fm_desktop_entry_cache_init();
+    _init_access_creds();
 }
 
 void _fm_file_info_finalize()
 {
+    _fm_fs_cache_finalize();
+    _fm_desktop_entry_cache_finalize();
+    g_free(access_groups);
+    access_groups = NULL;
+    n_access_groups = 0;
+    access_by_mode = FALSE;
     g_object_unref(icon_locked_folder);
 }
 
+guint _fm_file_info_get_count(void)
+{
+    return g_atomic_int_get(&n_file_infos);
+}
+
 /**
  * fm_file_info_new:
  *
@@ -185,6 +297,7 @@ FmFileInfo* fm_file_info_new ()
 {
     FmFileInfo * fi = g_slice_new0(FmFileInfo);
     fi->n_ref = 1;
+    g_atomic_int_inc(&n_file_infos);
     return fi;
 }
 
@@ -261,82 +374,57 @@ gboolean _fm_file_info_set_from_native_file(FmFileInfo* fi, const char* path,
         if (get_fast) /* do rough estimation */
             fi->accessible = ((st.st_mode & S_IRUSR) == S_IRUSR);
         else
-            fi->accessible = (g_access(path, R_OK) == 0);
+            fi->accessible = _native_file_is_readable(path, &st);
 
         /* special handling for desktop entry files */
         if(G_UNLIKELY(!get_fast && fm_file_info_is_desktop_entry(fi)))
         {
-            GKeyFile* kf = g_key_file_new();
+            FmDesktopEntryData de;
             FmIcon* icon = NULL;
-            char* icon_name;
-            char* type;
 
-            if(g_key_file_load_from_file(kf, path, 0, NULL))
+            if (_fm_desktop_entry_cache_get(path, &st, &de))
             {
-                /* check if type is correct and supported */
-                type = g_key_file_get_string(kf, "Desktop Entry", "Type", NULL);
-                if(type)
+                /* handle Type=Link, those are shortcuts
+                   therefore set ->shortcut, ->target, ->mime_type */
+                if (de.url)
                 {
-                    /* g_debug("got desktop entry with type %s", type); */
-                    if(strcmp(type, G_KEY_FILE_DESKTOP_TYPE_LINK) == 0)
+                    FmMimeType *new_mime_type = fm_mime_type_from_file_name(de.url);
+
+                    /* g_debug("got type %s for URL %s", fm_mime_type_get_type(new_mime_type), de.url); */
+                    if (strcmp(fm_mime_type_get_type(new_mime_type),
+                               "application/octet-stream") == 0 ||
+                        /* actually remote links should never be
+                           directories so let treat them as unknown */
+                        (new_mime_type == _fm_mime_type_get_inode_directory()
+                         && !g_str_has_prefix(de.url, "file:/")))
                     {
-                        char *uri = g_key_file_get_string(kf, G_KEY_FILE_DESKTOP_GROUP,
-                                                          G_KEY_FILE_DESKTOP_KEY_URL, NULL);
-                        /* handle Type=Link, those are shortcuts
-                           therefore set ->shortcut, ->target, ->mime_type */
-                        if (uri)
-                        {
-                            FmMimeType *new_mime_type = fm_mime_type_from_file_name(uri);
-
-                            /* g_debug("got type %s for URL %s", fm_mime_type_get_type(new_mime_type), uri); */
-                            if (strcmp(fm_mime_type_get_type(new_mime_type),
-                                       "application/octet-stream") == 0 ||
-                                /* actually remote links should never be
-                                   directories so let treat them as unknown */
-                                (new_mime_type == _fm_mime_type_get_inode_directory()
-                                 && !g_str_has_prefix(uri, "file:/")))
-                            {
-                                /* NOTE: earlier we classified all links to
-                                   desktop entry as inode/x-shortcut too but
-                                   that would require a lot of special support
-                                   therefore we set to inode/x-shortcut only
-                                   those shortcuts that we fail to determine */
-                                fm_mime_type_unref(new_mime_type);
-                                new_mime_type = fm_mime_type_ref(_fm_mime_type_get_inode_x_shortcut());
-                            }
-                            fm_mime_type_unref(fi->mime_type);
-                            fi->mime_type = new_mime_type;
-                            fi->shortcut = TRUE;
-                            fi->target = uri;
-                        }
-                        else
-                        {
-                            /* otherwise it's error, Link should have URL */
-                            g_free(type);
-                            goto _not_desktop_entry;
-                        }
+                        /* NOTE: earlier we classified all links to
+                           desktop entry as inode/x-shortcut too but
+                           that would require a lot of special support
+                           therefore we set to inode/x-shortcut only
+                           those shortcuts that we fail to determine */
+                        fm_mime_type_unref(new_mime_type);
+                        new_mime_type = fm_mime_type_ref(_fm_mime_type_get_inode_x_shortcut());
                     }
-                    /* FIXME: fail if Type isn't Application or Directory */
-                    g_free(type);
+                    fm_mime_type_unref(fi->mime_type);
+                    fi->mime_type = new_mime_type;
+                    fi->shortcut = TRUE;
+                    fi->target = de.url;
                 }
-                else
-                    goto _not_desktop_entry;
-                icon_name = g_key_file_get_string(kf, "Desktop Entry", "Icon", NULL);
-                if(icon_name)
+                if (de.icon)
                 {
-                    icon = fm_icon_from_name(icon_name);
-                    g_free(icon_name);
+                    icon = fm_icon_from_name(de.icon);
+                    g_free(de.icon);
                 }
                 /* Use title of the desktop entry for display */
-                dname = g_key_file_get_locale_string(kf, "Desktop Entry", "Name", NULL, NULL);
+                dname = de.name;
                 /* handle 'Hidden' key to set hidden attribute */
                 if (!fi->hidden)
-                    fi->hidden = g_key_file_get_boolean(kf, "Desktop Entry", "Hidden", NULL);
+                    fi->hidden = de.hidden;
             }
             else
             {
                 /* otherwise it's error so treat the file as simple text */
-_not_desktop_entry:
                 fm_mime_type_unref(fi->mime_type);
                 fi->mime_type = fm_mime_type_from_name("text/plain");
             }
@@ -344,7 +432,6 @@ _not_desktop_entry:
                 fi->icon = icon;
             else
                 fi->icon = g_object_ref(fm_mime_type_get_icon(fi->mime_type));
-            g_key_file_free(kf);
         }
         else if(!S_ISDIR(st.st_mode))
             ;
@@ -419,16 +506,9 @@ _not_desktop_entry:
         fi->fs_is_ro = FALSE;
         if (S_ISDIR(st.st_mode))
         {
-            GFile *gf = g_file_new_for_path(path);
-            GFileInfo *inf;
-            inf = g_file_query_filesystem_info(gf, G_FILE_ATTRIBUTE_FILESYSTEM_READONLY,
-                                               NULL, NULL);
-            if (inf)
-            {
-                fi->fs_is_ro = g_file_info_get_attribute_boolean(inf, G_FILE_ATTRIBUTE_FILESYSTEM_READONLY);
-                g_object_unref(inf);
-            }
-            g_object_unref(gf);
+            FmFsProps props;
+            if (_fm_fs_cache_get_for_dev(st.st_dev, path, &props))
+                fi->fs_is_ro = props.readonly;
         }
     }
     else
@@ -493,6 +573,9 @@ void fm_file_info_set_from_gfileinfo(FmFileInfo* fi, GFileInfo* inf)
     fm_file_info_set_from_g_file_data(fi, NULL, inf);
 }
 
+static void _fm_file_info_set_from_g_file_info(FmFileInfo *fi, GFileInfo *inf,
+                                               GFileAttributeInfoList *settable);
+
 /**
  * fm_file_info_set_from_g_file_data
  * @fi: a #FmFileInfo struct to update
@@ -506,14 +589,30 @@ void fm_file_info_set_from_gfileinfo(FmFileInfo* fi, GFileInfo* inf)
  */
 void fm_file_info_set_from_g_file_data(FmFileInfo *fi, GFile *gf, GFileInfo *inf)
 {
-    const char *tmp, *uri;
-    GIcon* gicon;
     GFile *_gf = NULL;
     GFileAttributeInfoList *list;
-    GFileType type;
 
     g_return_if_fail(fi->path);
 
+    if (G_UNLIKELY(gf == NULL))
+        gf = _gf = fm_path_to_gfile(fi->path);
+    list = g_file_query_settable_attributes(gf, NULL, NULL);
+    _fm_file_info_set_from_g_file_info(fi, inf, list);
+    if (G_LIKELY(list))
+        g_file_attribute_info_list_unref(list);
+    if (G_UNLIKELY(_gf))
+        g_object_unref(_gf);
+}
+
+/* the same as fm_file_info_set_from_g_file_data() but takes the list of
+   settable attributes of the file, which may be %NULL, instead of query */
+static void _fm_file_info_set_from_g_file_info(FmFileInfo *fi, GFileInfo *inf,
+                                               GFileAttributeInfoList *settable)
+{
+    const char *tmp, *uri;
+    GIcon* gicon;
+    GFileType type;
+
     tmp = g_file_info_get_edit_name(inf);
     if (!tmp)
         tmp = g_file_info_get_display_name(inf);
@@ -672,19 +771,13 @@ _file_is_symlink:
     fi->icon_is_changeable = fi->hidden_is_changeable = FALSE;
     if (g_file_info_has_attribute(inf, G_FILE_ATTRIBUTE_ACCESS_CAN_RENAME))
         fi->name_is_changeable = g_file_info_get_attribute_boolean(inf, G_FILE_ATTRIBUTE_ACCESS_CAN_RENAME);
-    if (G_UNLIKELY(gf == NULL))
-        gf = _gf = fm_path_to_gfile(fi->path);
-    list = g_file_query_settable_attributes(gf, NULL, NULL);
-    if (G_LIKELY(list))
+    if (G_LIKELY(settable))
     {
-        if (g_file_attribute_info_list_lookup(list, G_FILE_ATTRIBUTE_STANDARD_ICON))
+        if (g_file_attribute_info_list_lookup(settable, G_FILE_ATTRIBUTE_STANDARD_ICON))
             fi->icon_is_changeable = TRUE;
-        if (g_file_attribute_info_list_lookup(list, G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN))
+        if (g_file_attribute_info_list_lookup(settable, G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN))
             fi->hidden_is_changeable = TRUE;
-        g_file_attribute_info_list_unref(list);
     }
-    if (G_UNLIKELY(_gf))
-        g_object_unref(_gf);
 }
 
 
@@ -735,6 +828,155 @@ FmFileInfo* fm_file_info_new_from_g_file_data(GFile *gf, GFileInfo *inf, FmPath
     return fi;
 }
 
+/* creates new file info for @path the same way as for listing of folder:
+   @settable is the list of settable attributes, see above */
+FmFileInfo *_fm_file_info_new_from_g_file_info(FmPath *path, GFileInfo *inf,
+                                               GFileAttributeInfoList *settable)
+{
+    FmFileInfo* fi = fm_file_info_new();
+    fi->path = fm_path_ref(path);
+    _fm_file_info_set_from_g_file_info(fi, inf, settable);
+    return fi;
+}
+
+enum
+{
+    SNAPSHOT_SHORTCUT = 1 << 0,
+    SNAPSHOT_ACCESSIBLE = 1 << 1,
+    SNAPSHOT_HIDDEN = 1 << 2,
+    SNAPSHOT_BACKUP = 1 << 3,
+    SNAPSHOT_NAME_CHANGEABLE = 1 << 4,
+    SNAPSHOT_ICON_CHANGEABLE = 1 << 5,
+    SNAPSHOT_HIDDEN_CHANGEABLE = 1 << 6,
+    SNAPSHOT_FS_IS_RO = 1 << 7
+};
+
+/* appends record of @fi to listing snapshot, see fm-folder-snapshot.c */
+void _fm_file_info_write_snapshot(FmFileInfo *fi, GString *buf)
+{
+    char *icon = fi->icon ? g_icon_to_string(G_ICON(fi->icon)) : NULL;
+    guint flags = 0;
+
+    _fm_snapshot_put_string(buf, fm_path_get_basename(fi->path));
+    _fm_snapshot_put_string(buf, _fm_path_get_display_name(fi->path));
+    _fm_snapshot_put_uint(buf, fi->mode);
+    _fm_snapshot_put_uint(buf, fi->uid);
+    _fm_snapshot_put_uint(buf, fi->gid);
+    _fm_snapshot_put_uint(buf, fi->size);
+    _fm_snapshot_put_uint(buf, fi->mtime);
+    _fm_snapshot_put_uint(buf, fi->atime);
+    _fm_snapshot_put_uint(buf, fi->ctime);
+    _fm_snapshot_put_uint(buf, fi->blksize);
+    _fm_snapshot_put_uint(buf, fi->blocks);
+    _fm_snapshot_put_string(buf, fi->mime_type ? fm_mime_type_get_type(fi->mime_type) : NULL);
+    _fm_snapshot_put_string(buf, icon);
+    _fm_snapshot_put_string(buf, fi->target);
+    if (fm_path_is_native(fi->path))
+        _fm_snapshot_put_uint(buf, fi->dev);
+    else
+        _fm_snapshot_put_string(buf, fi->fs_id);
+    if (fi->shortcut)
+        flags |= SNAPSHOT_SHORTCUT;
+    if (fi->accessible)
+        flags |= SNAPSHOT_ACCESSIBLE;
+    if (fi->hidden)
+        flags |= SNAPSHOT_HIDDEN;
+    if (fi->backup)
+        flags |= SNAPSHOT_BACKUP;
+    if (fi->name_is_changeable)
+        flags |= SNAPSHOT_NAME_CHANGEABLE;
+    if (fi->icon_is_changeable)
+        flags |= SNAPSHOT_ICON_CHANGEABLE;
+    if (fi->hidden_is_changeable)
+        flags |= SNAPSHOT_HIDDEN_CHANGEABLE;
+    if (fi->fs_is_ro)
+        flags |= SNAPSHOT_FS_IS_RO;
+    _fm_snapshot_put_uint(buf, flags);
+    g_free(icon);
+}
+
+/* reads a record written by _fm_file_info_write_snapshot(); if @path is
+   NULL then path is made as child of @parent; returns NULL if data are
+   malformed */
+FmFileInfo *_fm_file_info_new_from_snapshot(FmPath *path, FmPath *parent,
+                                            const char **data, const char *end)
+{
+    const char *name, *disp_name, *mime_type, *icon, *target, *fs_id = NULL;
+    guint64 mode, uid, gid, size, mtime, atime, ctime, blksize, blocks;
+    guint64 dev = 0, flags;
+    FmFileInfo *fi;
+
+    if (!_fm_snapshot_get_string(data, end, &name) || name == NULL ||
+        !_fm_snapshot_get_string(data, end, &disp_name) ||
+        !_fm_snapshot_get_uint(data, end, &mode) ||
+        !_fm_snapshot_get_uint(data, end, &uid) ||
+        !_fm_snapshot_get_uint(data, end, &gid) ||
+        !_fm_snapshot_get_uint(data, end, &size) ||
+        !_fm_snapshot_get_uint(data, end, &mtime) ||
+        !_fm_snapshot_get_uint(data, end, &atime) ||
+        !_fm_snapshot_get_uint(data, end, &ctime) ||
+        !_fm_snapshot_get_uint(data, end, &blksize) ||
+        !_fm_snapshot_get_uint(data, end, &blocks) ||
+        !_fm_snapshot_get_string(data, end, &mime_type) ||
+        !_fm_snapshot_get_string(data, end, &icon) ||
+        !_fm_snapshot_get_string(data, end, &target))
+        return NULL;
+    if (path == NULL && (strchr(name, '/') != NULL || strcmp(name, "..") == 0))
+        return NULL;
+    if (path ? fm_path_is_native(path) : fm_path_is_native(parent))
+    {
+        if (!_fm_snapshot_get_uint(data, end, &dev))
+            return NULL;
+    }
+    else if (!_fm_snapshot_get_string(data, end, &fs_id))
+        return NULL;
+    if (!_fm_snapshot_get_uint(data, end, &flags))
+        return NULL;
+
+    fi = fm_file_info_new();
+    if (path)
+        fi->path = fm_path_ref(path);
+    else
+        fi->path = fm_path_new_child(parent, name);
+    if (disp_name)
+        _fm_path_set_display_name(fi->path, disp_name);
+    fi->mode = mode;
+    fi->uid = uid;
+    fi->gid = gid;
+    fi->size = size;
+    fi->mtime = mtime;
+    fi->atime = atime;
+    fi->ctime = ctime;
+    fi->blksize = blksize;
+    fi->blocks = blocks;
+    fi->mime_type = fm_mime_type_from_name(mime_type ? mime_type : "application/octet-stream");
+    if (icon)
+    {
+        GIcon *gicon = g_icon_new_for_string(icon, NULL);
+        if (gicon)
+        {
+            fi->icon = fm_icon_from_gicon(gicon);
+            g_object_unref(gicon);
+        }
+    }
+    if (fi->icon == NULL)
+        fi->icon = g_object_ref(fm_mime_type_get_icon(fi->mime_type));
+    fi->target = g_strdup(target);
+    if (fs_id)
+        fi->fs_id = g_intern_string(fs_id);
+    else
+        fi->dev = dev;
+    fi->shortcut = (flags & SNAPSHOT_SHORTCUT) != 0;
+    fi->accessible = (flags & SNAPSHOT_ACCESSIBLE) != 0;
+    fi->hidden = (flags & SNAPSHOT_HIDDEN) != 0;
+    fi->backup = (flags & SNAPSHOT_BACKUP) != 0;
+    fi->name_is_changeable = (flags & SNAPSHOT_NAME_CHANGEABLE) != 0;
+    fi->icon_is_changeable = (flags & SNAPSHOT_ICON_CHANGEABLE) != 0;
+    fi->hidden_is_changeable = (flags & SNAPSHOT_HIDDEN_CHANGEABLE) != 0;
+    fi->fs_is_ro = (flags & SNAPSHOT_FS_IS_RO) != 0;
+    return fi;
+}
+
 /**
  * fm_file_info_set_from_menu_cache_item
  * @fi: a file info to update
@@ -883,6 +1125,7 @@ void fm_file_info_unref(FmFileInfo* fi)
     {
         fm_file_info_clear(fi);
         g_slice_free(FmFileInfo, fi);
+        g_atomic_int_add(&n_file_infos, -1);
     }
 }
 
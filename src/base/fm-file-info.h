@@ -46,6 +46,9 @@ struct _MenuCacheItem;/* forward declaration for MenuCacheItem */
 /* intialize the file info system */
 void _fm_file_info_init();
 void _fm_file_info_finalize();
+guint _fm_file_info_get_count(void);
+FmFileInfo *_fm_file_info_new_from_g_file_info(FmPath *path, GFileInfo *inf,
+                                               GFileAttributeInfoList *settable);
 
 FmFileInfo* fm_file_info_new();
 #ifndef FM_DISABLE_DEPRECATED
@@ -46,6 +46,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
 /**
@@ -119,19 +120,65 @@ static FmJobErrorAction on_query_target_info_error(FmJob* job, GError* err, FmJo
     return FM_JOB_CONTINUE;
 }
 
+/* schemes which libfm handles itself, other ones are passed to GIO */
+static gboolean _is_internal_scheme(const char *scheme)
+{
+    /* FIXME: this is rough! */
+    return (strcmp(scheme, "file") == 0 ||
+            strcmp(scheme, "trash") == 0 ||
+            strcmp(scheme, "network") == 0 ||
+            strcmp(scheme, "computer") == 0 ||
+            strcmp(scheme, "menu") == 0);
+}
+
+/* returns target of shortcut if _launch_files() needs info about it */
+static const char *_shortcut_target_to_fetch(FmFileInfo *fi, FmFileLauncher *launcher)
+{
+    const char *target;
+    char *scheme;
+    gboolean internal;
+
+    /* symlinks also has fi->target, but we only handle shortcuts here. */
+    if (fm_file_info_is_symlink(fi) || (target = fm_file_info_get_target(fi)) == NULL)
+        return NULL;
+    if (launcher->open_folder &&
+        (fm_file_info_is_dir(fi) || fm_file_info_is_mountable(fi)))
+        return target;
+    if (fm_file_info_is_desktop_entry(fi) ||
+        !fm_path_is_native(fm_file_info_get_path(fi)))
+        return NULL;
+    if (fm_file_info_get_mime_type(fi) != _fm_mime_type_get_inode_x_shortcut())
+        return target;
+    scheme = g_uri_parse_scheme(target);
+    if (scheme == NULL)
+        return target;
+    internal = _is_internal_scheme(scheme);
+    g_free(scheme);
+    return internal ? target : NULL;
+}
+
+/* @prefetched is a map FmPath -> FmFileInfo of already queried targets,
+   if target is missing there then error was already reported */
 static FmFileInfo *_fetch_file_info_for_shortcut(const char *target,
                                                  GAppLaunchContext* ctx,
                                                  FmFileLauncher* launcher,
-                                                 gpointer user_data)
+                                                 gpointer user_data,
+                                                 GHashTable *prefetched)
 {
     FmFileInfoJob *job;
     QueryErrorData data;
     FmFileInfo *fi;
     FmPath *path;
 
-    job = fm_file_info_job_new(NULL, 0);
     /* bug #3614794: the shortcut target is a commandline argument */
     path = fm_path_new_for_commandline_arg(target);
+    if (prefetched)
+    {
+        fi = g_hash_table_lookup(prefetched, path);
+        fm_path_unref(path);
+        return fi ? fm_file_info_ref(fi) : NULL;
+    }
+    job = fm_file_info_job_new(NULL, 0);
     fm_file_info_job_add(job, path);
     fm_path_unref(path);
     data.ctx = ctx;
@@ -149,6 +196,10 @@ static FmFileInfo *_fetch_file_info_for_shortcut(const char *target,
     return fi;
 }
 
+static gboolean _launch_files(GAppLaunchContext* ctx, GList* file_infos,
+                              FmFileLauncher* launcher, gpointer user_data,
+                              GHashTable* prefetched);
+
 /**
  * fm_launch_files
  * @ctx: (allow-none): a launch context
@@ -163,6 +214,13 @@ static FmFileInfo *_fetch_file_info_for_shortcut(const char *target,
  * Since: 0.1.0
  */
 gboolean fm_launch_files(GAppLaunchContext* ctx, GList* file_infos, FmFileLauncher* launcher, gpointer user_data)
+{
+    return _launch_files(ctx, file_infos, launcher, user_data, NULL);
+}
+
+static gboolean _launch_files(GAppLaunchContext* ctx, GList* file_infos,
+                              FmFileLauncher* launcher, gpointer user_data,
+                              GHashTable* prefetched)
 {
     GList* l;
     GHashTable* hash = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, NULL);
@@ -191,7 +249,8 @@ gboolean fm_launch_files(GAppLaunchContext* ctx, GList* file_infos, FmFileLaunch
             if(target)
             {
                 fi = _fetch_file_info_for_shortcut(fm_file_info_get_target(fi),
-                                                   ctx, launcher, user_data);
+                                                   ctx, launcher, user_data,
+                                                   prefetched);
                 if (fi == NULL)
                     /* error was shown by job already */
                     continue;
@@ -225,15 +284,10 @@ _launch_desktop_entry:
                       scheme = g_uri_parse_scheme(target);
                       if (scheme)
                       {
-                        /* FIXME: this is rough! */
-                        if (strcmp(scheme, "file") != 0 &&
-                            strcmp(scheme, "trash") != 0 &&
-                            strcmp(scheme, "network") != 0 &&
-                            strcmp(scheme, "computer") != 0 &&
-                            strcmp(scheme, "menu") != 0)
+                        if (!_is_internal_scheme(scheme))
                         {
                             /* we don't support this URI internally, try GIO */
-                            app = g_app_info_get_default_for_uri_scheme(scheme);
+                            app = fm_app_info_get_default_for_uri_scheme(scheme);
                             if (app)
                             {
                                 fis = g_list_prepend(NULL, (char *)target);
@@ -259,7 +313,8 @@ _launch_desktop_entry:
                     else
                         mime_type = fm_file_info_get_mime_type(fi);
                     /* retrieve file info for target otherwise and handle it */
-                    fi = _fetch_file_info_for_shortcut(target, ctx, launcher, user_data);
+                    fi = _fetch_file_info_for_shortcut(target, ctx, launcher,
+                                                       user_data, prefetched);
                     if (fi == NULL)
                         /* error was shown by job already */
                         continue;
@@ -373,7 +428,7 @@ _launch_desktop_entry:
         g_hash_table_iter_init(&it, hash);
         while(g_hash_table_iter_next(&it, (void**)&type, (void**)&fis))
         {
-            GAppInfo* app = g_app_info_get_default_for_type(type, FALSE);
+            GAppInfo* app = fm_app_info_get_default_for_type(type);
             if(!app)
             {
                 if(launcher->get_app)
@@ -478,3 +533,224 @@ gboolean fm_launch_paths(GAppLaunchContext* ctx, GList* paths, FmFileLauncher* l
     g_object_unref(job);
     return ret;
 }
+
+typedef struct
+{
+    GAppLaunchContext* ctx;
+    FmFileLauncher launcher;
+    gpointer user_data;
+    GDestroyNotify destroy_data;
+    GCancellable* cancellable;
+    QueryErrorData err_data;
+    FmFileInfoList* file_infos; /* files to launch */
+    GHashTable* prefetched; /* FmPath -> FmFileInfo of shortcut targets */
+} LaunchAsyncData;
+
+static LaunchAsyncData* launch_async_data_new(GAppLaunchContext* ctx,
+                                              FmFileLauncher* launcher,
+                                              gpointer user_data,
+                                              GDestroyNotify destroy_data,
+                                              GCancellable* cancellable)
+{
+    LaunchAsyncData* data = g_slice_new0(LaunchAsyncData);
+
+    data->ctx = ctx ? g_object_ref(ctx) : NULL;
+    /* caller may free launcher right after the call */
+    data->launcher = *launcher;
+    data->user_data = user_data;
+    data->destroy_data = destroy_data;
+    data->cancellable = cancellable ? g_object_ref(cancellable) : NULL;
+    data->err_data.ctx = data->ctx;
+    data->err_data.launcher = &data->launcher;
+    data->err_data.user_data = user_data;
+    return data;
+}
+
+static void launch_async_data_free(LaunchAsyncData* data)
+{
+    if (data->destroy_data)
+        data->destroy_data(data->user_data);
+    if (data->ctx)
+        g_object_unref(data->ctx);
+    if (data->cancellable)
+        g_object_unref(data->cancellable);
+    if (data->file_infos)
+        fm_file_info_list_unref(data->file_infos);
+    if (data->prefetched)
+        g_hash_table_destroy(data->prefetched);
+    g_slice_free(LaunchAsyncData, data);
+}
+
+static FmFileInfoJob* launch_async_job_new(LaunchAsyncData* data, GCallback on_finished)
+{
+    FmFileInfoJob* job = fm_file_info_job_new(NULL, 0);
+
+    if (data->cancellable)
+        fm_job_set_cancellable(FM_JOB(job), data->cancellable);
+    g_signal_connect(job, "error", G_CALLBACK(on_query_target_info_error), &data->err_data);
+    g_signal_connect(job, "finished", on_finished, data);
+    return job;
+}
+
+static void launch_async_job_disconnect(FmFileInfoJob* job, LaunchAsyncData* data)
+{
+    g_signal_handlers_disconnect_by_func(job, on_query_target_info_error, &data->err_data);
+    g_signal_handlers_disconnect_matched(job, G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, data);
+}
+
+static void launch_async_finish(LaunchAsyncData* data)
+{
+    GList* file_infos = fm_file_info_list_peek_head_link(data->file_infos);
+
+    if (file_infos && !g_cancellable_is_cancelled(data->cancellable))
+        _launch_files(data->ctx, file_infos, &data->launcher, data->user_data,
+                      data->prefetched);
+    launch_async_data_free(data);
+}
+
+static void on_targets_info_finished(FmFileInfoJob* job, LaunchAsyncData* data)
+{
+    GList* l;
+
+    launch_async_job_disconnect(job, data);
+    if (fm_job_is_cancelled(FM_JOB(job)))
+    {
+        launch_async_data_free(data);
+        return;
+    }
+    data->prefetched = g_hash_table_new_full((GHashFunc)fm_path_hash,
+                                             (GEqualFunc)fm_path_equal,
+                                             (GDestroyNotify)fm_path_unref,
+                                             (GDestroyNotify)fm_file_info_unref);
+    for (l = fm_file_info_list_peek_head_link(job->file_infos); l; l = l->next)
+        g_hash_table_insert(data->prefetched,
+                            fm_path_ref(fm_file_info_get_path(l->data)),
+                            fm_file_info_ref(l->data));
+    launch_async_finish(data);
+}
+
+/* queries shortcut targets in background so _launch_files() never waits */
+static gboolean launch_async_prefetch(LaunchAsyncData* data)
+{
+    FmFileInfoJob* job = NULL;
+    GList* l;
+
+    for (l = fm_file_info_list_peek_head_link(data->file_infos); l; l = l->next)
+    {
+        const char* target = _shortcut_target_to_fetch(l->data, &data->launcher);
+        FmPath* path;
+
+        if (target == NULL)
+            continue;
+        if (job == NULL)
+            job = launch_async_job_new(data, G_CALLBACK(on_targets_info_finished));
+        /* bug #3614794: the shortcut target is a commandline argument */
+        path = fm_path_new_for_commandline_arg(target);
+        fm_file_info_job_add(job, path);
+        fm_path_unref(path);
+    }
+    if (job == NULL)
+    {
+        launch_async_finish(data);
+        return TRUE;
+    }
+    if (!fm_job_run_async(FM_JOB(job)))
+    {
+        launch_async_job_disconnect(job, data);
+        g_object_unref(job);
+        launch_async_data_free(data);
+        return FALSE;
+    }
+    g_object_unref(job);
+    return TRUE;
+}
+
+/**
+ * fm_launch_files_async
+ * @ctx: (allow-none): a launch context
+ * @file_infos: (element-type FmFileInfo): files to launch
+ * @launcher: #FmFileLauncher with callbacks
+ * @user_data: data supplied for callbacks
+ * @destroy_data: (allow-none): function to free @user_data when done
+ * @cancellable: (allow-none): optional cancellable object
+ *
+ * Launches files using callbacks in @launcher, same way as
+ * fm_launch_files() does, but information about shortcut targets is
+ * retrieved in background so caller is never blocked by I/O. Callbacks
+ * are called in main thread, possibly after this function returned.
+ * The @launcher is copied so it may be freed after this call.
+ *
+ * Returns: %TRUE if launching was started.
+ *
+ * Since: 1.3.0
+ */
+gboolean fm_launch_files_async(GAppLaunchContext* ctx, GList* file_infos,
+                               FmFileLauncher* launcher, gpointer user_data,
+                               GDestroyNotify destroy_data,
+                               GCancellable* cancellable)
+{
+    LaunchAsyncData* data = launch_async_data_new(ctx, launcher, user_data,
+                                                  destroy_data, cancellable);
+    GList* l;
+
+    data->file_infos = fm_file_info_list_new();
+    for (l = file_infos; l; l = l->next)
+        fm_file_info_list_push_tail(data->file_infos, l->data);
+    return launch_async_prefetch(data);
+}
+
+static void on_paths_info_finished(FmFileInfoJob* job, LaunchAsyncData* data)
+{
+    launch_async_job_disconnect(job, data);
+    if (fm_job_is_cancelled(FM_JOB(job)) ||
+        fm_file_info_list_is_empty(job->file_infos))
+    {
+        launch_async_data_free(data);
+        return;
+    }
+    data->file_infos = fm_file_info_list_ref(job->file_infos);
+    launch_async_prefetch(data);
+}
+
+/**
+ * fm_launch_paths_async
+ * @ctx: (allow-none): a launch context
+ * @paths: (element-type FmPath): files to launch
+ * @launcher: #FmFileLauncher with callbacks
+ * @user_data: data supplied for callbacks
+ * @destroy_data: (allow-none): function to free @user_data when done
+ * @cancellable: (allow-none): optional cancellable object
+ *
+ * Launches files using callbacks in @launcher, same way as
+ * fm_launch_paths() does, but information about files is retrieved in
+ * background so caller is never blocked by I/O. Callbacks are called in
+ * main thread after this function returned. The @launcher is copied so
+ * it may be freed after this call. If @cancellable is cancelled before
+ * files are queried then nothing will be launched.
+ *
+ * Returns: %TRUE if launching was started.
+ *
+ * Since: 1.3.0
+ */
+gboolean fm_launch_paths_async(GAppLaunchContext* ctx, GList* paths,
+                               FmFileLauncher* launcher, gpointer user_data,
+                               GDestroyNotify destroy_data,
+                               GCancellable* cancellable)
+{
+    LaunchAsyncData* data = launch_async_data_new(ctx, launcher, user_data,
+                                                  destroy_data, cancellable);
+    FmFileInfoJob* job = launch_async_job_new(data, G_CALLBACK(on_paths_info_finished));
+    GList* l;
+    gboolean ret;
+
+    for (l = paths; l; l = l->next)
+        fm_file_info_job_add(job, (FmPath*)l->data);
+    ret = fm_job_run_async(FM_JOB(job));
+    if (!ret)
+    {
+        launch_async_job_disconnect(job, data);
+        launch_async_data_free(data);
+    }
+    g_object_unref(job);
+    return ret;
+}
@@ -70,6 +70,14 @@ struct _FmFileLauncher
 
 gboolean fm_launch_files(GAppLaunchContext* ctx, GList* file_infos, FmFileLauncher* launcher, gpointer user_data);
 gboolean fm_launch_paths(GAppLaunchContext* ctx, GList* paths, FmFileLauncher* launcher, gpointer user_data);
+gboolean fm_launch_files_async(GAppLaunchContext* ctx, GList* file_infos,
+                               FmFileLauncher* launcher, gpointer user_data,
+                               GDestroyNotify destroy_data,
+                               GCancellable* cancellable);
+gboolean fm_launch_paths_async(GAppLaunchContext* ctx, GList* paths,
+                               FmFileLauncher* launcher, gpointer user_data,
+                               GDestroyNotify destroy_data,
+                               GCancellable* cancellable);
 gboolean fm_launch_desktop_entry(GAppLaunchContext* ctx, const char* file_or_id, GList* uris, FmFileLauncher* launcher, gpointer user_data);
 
 G_END_DECLS
@@ -32,6 +32,11 @@
  * opened first, then required operations performed, then closed. Each
  * opened descriptor holds a lock on the cache so it is not adviced to
  * keep it somewhere.
+ *
+ * Since 1.3.0 changes in the cache are saved by appending settings of
+ * changed folders to a journal file instead of rewriting whole cache
+ * file each time. The cache file is rewritten only when journal becomes
+ * large enough.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -42,7 +47,10 @@
 
 #include "fm-utils.h"
 
+#include <glib/gstdio.h>
 #include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
 
 struct _FmFolderConfig
 {
@@ -56,6 +64,18 @@ static GKeyFile *fc_cache = NULL;
 
 static gboolean fc_cache_changed = FALSE;
 
+/* The journal contains records each of which is a header line "#<size>"
+   followed by <size> bytes of key file with single group which contains
+   all settings of some folder. Group without keys means the folder has
+   no settings anymore. Records are applied in order on load. */
+static GHashTable *fc_cache_dirty = NULL; /* folders changed since last save */
+static gsize fc_cache_size = 0; /* size of dir-settings.conf */
+static gsize fc_journal_size = 0; /* size of valid data in journal */
+static gboolean fc_journal_broken = FALSE; /* journal has garbage at end */
+
+/* journal is merged into the cache when it grows over half of cache size */
+#define FC_JOURNAL_MIN_SIZE (64 * 1024)
+
 G_LOCK_DEFINE_STATIC(cache);
 
 /**
@@ -132,10 +152,15 @@ gboolean fm_folder_config_close(FmFolderConfig *fc, GError **error)
     }
     else
     {
-        g_free(fc->group);
-        G_UNLOCK(cache);
         if (fc->changed)
+        {
+            /* remember the folder to save it into journal later */
+            g_hash_table_insert(fc_cache_dirty, fc->group, NULL);
             fc_cache_changed = TRUE;
+        }
+        else
+            g_free(fc->group);
+        G_UNLOCK(cache);
     }
 
     g_slice_free(FmFolderConfig, fc);
@@ -434,6 +459,107 @@ void fm_folder_config_purge(FmFolderConfig *fc)
     g_key_file_remove_group(fc->kf, fc->group, NULL);
 }
 
+/* appends settings of changed folders to the journal, should be called
+   with cache lock held */
+static gboolean _journal_append(const char *path)
+{
+    GString *buf = g_string_sized_new(1024);
+    GString *rec = g_string_sized_new(256);
+    GHashTableIter it;
+    gpointer group;
+    gboolean ret = FALSE;
+    int errsv;
+    FILE *f;
+
+    g_hash_table_iter_init(&it, fc_cache_dirty);
+    while (g_hash_table_iter_next(&it, &group, NULL))
+    {
+        char **keys = g_key_file_get_keys(fc_cache, group, NULL, NULL);
+        char **key;
+
+        g_string_assign(rec, "[");
+        g_string_append(rec, group);
+        g_string_append(rec, "]\n");
+        for (key = keys; key && *key; key++)
+        {
+            /* value is kept escaped so may be copied as is */
+            char *value = g_key_file_get_value(fc_cache, group, *key, NULL);
+            g_string_append_printf(rec, "%s=%s\n", *key, value ? value : "");
+            g_free(value);
+        }
+        g_strfreev(keys);
+        g_string_append_printf(buf, "#%" G_GSIZE_FORMAT "\n", rec->len);
+        g_string_append_len(buf, rec->str, rec->len);
+    }
+    group = g_path_get_dirname(path);
+    g_mkdir_with_parents(group, 0700);
+    g_free(group);
+    f = fopen(path, "ab");
+    errsv = errno;
+    if (f != NULL)
+    {
+        /* partially written record is ignored on load so it's safe */
+        ret = (fwrite(buf->str, 1, buf->len, f) == buf->len);
+        errsv = errno;
+        if (fclose(f) != 0)
+        {
+            if (ret)
+                errsv = errno;
+            ret = FALSE;
+        }
+        if (ret)
+            fc_journal_size += buf->len;
+        else
+            fc_journal_broken = TRUE;
+    }
+    if (!ret)
+        g_warning("cannot write %s: %s", path, g_strerror(errsv));
+    g_string_free(rec, TRUE);
+    g_string_free(buf, TRUE);
+    return ret;
+}
+
+/* applies records from journal to the cache, returns size of valid data */
+static gsize _journal_replay(const char *data, gsize len)
+{
+    const char *p = data, *end = data + len;
+
+    while (p < end && *p == '#')
+    {
+        char *e;
+        gulong size = strtoul(p + 1, &e, 10);
+        GKeyFile *kf;
+        char **groups, **group;
+
+        if (*e != '\n' || size > (gulong)(end - e - 1))
+            break;
+        e++;
+        kf = g_key_file_new();
+        if (g_key_file_load_from_data(kf, e, size, 0, NULL))
+        {
+            groups = g_key_file_get_groups(kf, NULL);
+            for (group = groups; *group; group++)
+            {
+                char **keys = g_key_file_get_keys(kf, *group, NULL, NULL);
+                char **key;
+
+                g_key_file_remove_group(fc_cache, *group, NULL);
+                for (key = keys; key && *key; key++)
+                {
+                    char *value = g_key_file_get_value(kf, *group, *key, NULL);
+                    g_key_file_set_value(fc_cache, *group, *key, value);
+                    g_free(value);
+                }
+                g_strfreev(keys);
+            }
+            g_strfreev(groups);
+        }
+        g_key_file_free(kf);
+        p = e + size;
+    }
+    return p - data;
+}
+
 /**
  * fm_folder_config_save_cache
  *
@@ -444,13 +570,24 @@ void fm_folder_config_purge(FmFolderConfig *fc)
 void fm_folder_config_save_cache(void)
 {
     char *out;
-    char *path, *path2, *path3;
+    char *path, *path2, *path3, *journal;
     GError *error = NULL;
     gsize len;
 
     G_LOCK(cache);
-    /* if per-directory cache was changed since last invocation then save it */
-    if (fc_cache_changed && (out = g_key_file_to_data(fc_cache, &len, NULL)))
+    if (!fc_cache_changed)
+        goto _out;
+    /* append changes into journal while it is small enough */
+    journal = g_build_filename(g_get_user_config_dir(), "libfm/dir-settings.log", NULL);
+    if (!fc_journal_broken &&
+        fc_journal_size < MAX(FC_JOURNAL_MIN_SIZE, fc_cache_size / 2) &&
+        _journal_append(journal))
+    {
+        g_hash_table_remove_all(fc_cache_dirty);
+        fc_cache_changed = FALSE;
+    }
+    /* otherwise merge journal into the cache file */
+    else if ((out = g_key_file_to_data(fc_cache, &len, NULL)))
     {
         /* FIXME: create dir */
         /* create temp file with settings */
@@ -470,6 +607,12 @@ void fm_folder_config_save_cache(void)
                 {
                     /* success! remove the old cache file */
                     g_unlink(path3);
+                    /* journal is merged now */
+                    g_unlink(journal);
+                    fc_journal_size = 0;
+                    fc_journal_broken = FALSE;
+                    fc_cache_size = len;
+                    g_hash_table_remove_all(fc_cache_dirty);
                     /* reset the 'changed' flag */
                     fc_cache_changed = FALSE;
                 }
@@ -491,6 +634,8 @@ void fm_folder_config_save_cache(void)
         g_free(path3);
         g_free(out);
     }
+    g_free(journal);
+_out:
     G_UNLOCK(cache);
 }
 
@@ -499,13 +644,42 @@ void _fm_folder_config_finalize(void)
     fm_folder_config_save_cache();
     g_key_file_free(fc_cache);
     fc_cache = NULL;
+    g_hash_table_destroy(fc_cache_dirty);
+    fc_cache_dirty = NULL;
 }
 
 void _fm_folder_config_init(void)
 {
     char *path = g_build_filename(g_get_user_config_dir(),
                                   "libfm/dir-settings.conf", NULL);
+    char *data;
+    gsize len;
+
     fc_cache = g_key_file_new();
-    g_key_file_load_from_file(fc_cache, path, 0, NULL);
+    fc_cache_dirty = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    fc_cache_changed = FALSE;
+    fc_cache_size = 0;
+    fc_journal_size = 0;
+    fc_journal_broken = FALSE;
+    if (g_file_get_contents(path, &data, &len, NULL))
+    {
+        g_key_file_load_from_data(fc_cache, data, len, 0, NULL);
+        fc_cache_size = len;
+        g_free(data);
+    }
+    g_free(path);
+    /* apply changes saved after the cache file was written */
+    path = g_build_filename(g_get_user_config_dir(), "libfm/dir-settings.log", NULL);
+    if (g_file_get_contents(path, &data, &len, NULL))
+    {
+        fc_journal_size = _journal_replay(data, len);
+        if (fc_journal_size < len)
+        {
+            /* interrupted write, rewrite all on next save */
+            fc_journal_broken = TRUE;
+            fc_cache_changed = TRUE;
+        }
+        g_free(data);
+    }
     g_free(path);
 }
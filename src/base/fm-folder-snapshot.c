@@ -0,0 +1,449 @@
+/*
+ *      fm-folder-snapshot.c
+ *
+ *      This file is a part of the Libfm library.
+ *
+ *      This library is free software; you can redistribute it and/or
+ *      modify it under the terms of the GNU Lesser General Public
+ *      License as published by the Free Software Foundation; either
+ *      version 2.1 of the License, or (at your option) any later version.
+ *
+ *      This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Persistent listing snapshots for slow (remote) folders.
+ *
+ * Snapshot file is stored in $XDG_CACHE_HOME/libfm/snapshots/ and named
+ * after MD5 sum of the folder URI. Its content is:
+ *   "FMSNAP1\n" magic
+ *   string: folder URI (to detect hash collisions)
+ *   string: folder etag (may be empty)
+ *   record: the folder info
+ *   uint:   number of file records
+ *   records of the folder items
+ * where uint is an LEB128 varint and string is an uint length followed
+ * by that many bytes and a terminating NUL. Record format is defined in
+ * fm-file-info.c. Snapshot is written atomically so a crash never leaves
+ * a partially written file, and any malformed file is simply ignored. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "fm-folder-snapshot.h"
+#include "fm-config.h"
+#include "fm-simple-job.h"
+
+#include <glib/gstdio.h>
+#include <sys/stat.h>
+#include <string.h>
+
+#define SNAPSHOT_MAGIC          "FMSNAP1\n"
+#define SNAPSHOT_MAGIC_LEN      8
+/* don't bother saving huge folders, they will not fit into memory budget */
+#define SNAPSHOT_MAX_FILES      50000
+/* when the whole store is over this size then oldest snapshots are removed
+   until it is trimmed to 3/4 of it, so the next trim will be not soon */
+#define SNAPSHOT_STORE_MAX_SIZE (64 * 1024 * 1024)
+#define SNAPSHOT_STORE_TRIM_SIZE (SNAPSHOT_STORE_MAX_SIZE / 4 * 3)
+
+/* schemes which are worth the snapshot, local ones are fast enough */
+static const char *remote_schemes[] = {
+    "sftp", "smb", "ftp", "ftps", "dav", "davs", "afp", "nfs",
+    "mtp", "gphoto2", "afc", "google-drive", NULL
+};
+
+void _fm_snapshot_put_uint(GString *buf, guint64 val)
+{
+    while (val >= 0x80)
+    {
+        g_string_append_c(buf, (char)((val & 0x7f) | 0x80));
+        val >>= 7;
+    }
+    g_string_append_c(buf, (char)val);
+}
+
+void _fm_snapshot_put_string(GString *buf, const char *str)
+{
+    gsize len = str ? strlen(str) : 0;
+
+    _fm_snapshot_put_uint(buf, len);
+    if (len > 0)
+        g_string_append_len(buf, str, len);
+    g_string_append_c(buf, '\0');
+}
+
+gboolean _fm_snapshot_get_uint(const char **data, const char *end, guint64 *val)
+{
+    const char *p = *data;
+    guint64 res = 0;
+    guint shift = 0;
+
+    while (p < end && shift < 64)
+    {
+        guchar c = (guchar)*p++;
+        res |= (guint64)(c & 0x7f) << shift;
+        if ((c & 0x80) == 0)
+        {
+            *data = p;
+            *val = res;
+            return TRUE;
+        }
+        shift += 7;
+    }
+    return FALSE;
+}
+
+/* returns pointer into data, NULL for empty string */
+gboolean _fm_snapshot_get_string(const char **data, const char *end, const char **str)
+{
+    const char *p = *data;
+    guint64 len;
+
+    if (!_fm_snapshot_get_uint(&p, end, &len))
+        return FALSE;
+    if (len >= (guint64)(end - p) || p[len] != '\0')
+        return FALSE;
+    *str = len ? p : NULL;
+    *data = p + len + 1;
+    return TRUE;
+}
+
+static char *_snapshot_dir(void)
+{
+    return g_build_filename(g_get_user_cache_dir(), "libfm", "snapshots", NULL);
+}
+
+static char *_snapshot_file(const char *uri)
+{
+    char *dir = _snapshot_dir();
+    char *name = g_compute_checksum_for_string(G_CHECKSUM_MD5, uri, -1);
+    char *file = g_build_filename(dir, name, NULL);
+
+    g_free(name);
+    g_free(dir);
+    return file;
+}
+
+/* gvfs FUSE mounts are native paths but as slow as their remote origins */
+static gboolean _is_gvfs_fuse_path(FmPath *dir)
+{
+    char *path = fm_path_to_str(dir);
+    char *prefix;
+    gboolean res;
+
+#if GLIB_CHECK_VERSION(2, 28, 0)
+    prefix = g_build_filename(g_get_user_runtime_dir(), "gvfs", "", NULL);
+    res = g_str_has_prefix(path, prefix);
+    g_free(prefix);
+    if (!res)
+#endif
+    {
+        prefix = g_build_filename(g_get_home_dir(), ".gvfs", "", NULL);
+        res = g_str_has_prefix(path, prefix);
+        g_free(prefix);
+    }
+    g_free(path);
+    return res;
+}
+
+gboolean _fm_folder_snapshot_is_wanted(FmPath *dir)
+{
+    return fm_config->listing_snapshots && _fm_folder_is_slow(dir);
+}
+
+gboolean _fm_folder_is_slow(FmPath *dir)
+{
+    FmPath *scheme;
+    const char *name;
+    guint i;
+
+    if (fm_path_is_native(dir))
+        return _is_gvfs_fuse_path(dir);
+    scheme = fm_path_get_scheme_path(dir);
+    name = fm_path_get_basename(scheme);
+    for (i = 0; remote_schemes[i]; i++)
+    {
+        gsize len = strlen(remote_schemes[i]);
+        /* scheme path basename is like "sftp://host" */
+        if (strncmp(name, remote_schemes[i], len) == 0 && name[len] == ':')
+            return TRUE;
+    }
+    return FALSE;
+}
+
+FmFileInfoList *_fm_folder_snapshot_parse(FmPath *dir, const char *data, gsize len,
+                                          FmFileInfo **dir_fi, char **etag)
+{
+    char *uri = fm_path_to_uri(dir);
+    const char *p = data, *end = data + len, *str;
+    guint64 n;
+    FmFileInfo *fi = NULL;
+    FmFileInfoList *files = NULL;
+
+    *etag = NULL;
+    if (len < SNAPSHOT_MAGIC_LEN || memcmp(p, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN) != 0)
+        goto _broken;
+    p += SNAPSHOT_MAGIC_LEN;
+    if (!_fm_snapshot_get_string(&p, end, &str) || g_strcmp0(str, uri) != 0)
+        goto _broken;
+    if (!_fm_snapshot_get_string(&p, end, &str))
+        goto _broken;
+    *etag = g_strdup(str);
+    fi = _fm_file_info_new_from_snapshot(dir, NULL, &p, end);
+    if (fi == NULL || !_fm_snapshot_get_uint(&p, end, &n) || n > SNAPSHOT_MAX_FILES)
+        goto _broken;
+    files = fm_file_info_list_new();
+    while (n-- > 0)
+    {
+        FmFileInfo *item = _fm_file_info_new_from_snapshot(NULL, dir, &p, end);
+        if (item == NULL)
+            goto _broken;
+        fm_file_info_list_push_tail_noref(files, item);
+    }
+    *dir_fi = fi;
+    g_free(uri);
+    return files;
+
+_broken:
+    if (fi)
+        fm_file_info_unref(fi);
+    if (files)
+        fm_file_info_list_unref(files);
+    g_free(*etag);
+    *etag = NULL;
+    g_free(uri);
+    return NULL;
+}
+
+typedef struct
+{
+    FmPath *dir;
+    FmFileInfoList *files;
+    FmFileInfo *dir_fi;
+    char *etag;
+} LoadData;
+
+static void load_data_free(gpointer user_data)
+{
+    LoadData *data = user_data;
+
+    fm_path_unref(data->dir);
+    if (data->files)
+        fm_file_info_list_unref(data->files);
+    if (data->dir_fi)
+        fm_file_info_unref(data->dir_fi);
+    g_free(data->etag);
+    g_slice_free(LoadData, data);
+}
+
+static gboolean load_snapshot_job(FmJob *job, gpointer user_data)
+{
+    LoadData *data = user_data;
+    char *uri = fm_path_to_uri(data->dir);
+    char *file = _snapshot_file(uri);
+    char *contents = NULL;
+    gsize len;
+
+    if (!fm_job_is_cancelled(job) &&
+        g_file_get_contents(file, &contents, &len, NULL))
+    {
+        data->files = _fm_folder_snapshot_parse(data->dir, contents, len,
+                                                &data->dir_fi, &data->etag);
+        if (data->files == NULL)
+        {
+            g_debug("ignoring broken listing snapshot %s", file);
+            g_unlink(file);
+        }
+    }
+    g_free(contents);
+    g_free(file);
+    g_free(uri);
+    return TRUE;
+}
+
+FmJob *_fm_folder_snapshot_load_job_new(FmPath *dir)
+{
+    LoadData *data = g_slice_new0(LoadData);
+    FmJob *job;
+
+    data->dir = fm_path_ref(dir);
+    job = fm_simple_job_new(load_snapshot_job, data, NULL);
+    /* the job object owns the data so _finish() can reach it later */
+    g_object_set_data_full(G_OBJECT(job), "fm-snapshot-load", data, load_data_free);
+    return job;
+}
+
+FmFileInfoList *_fm_folder_snapshot_load_finish(FmJob *job, FmFileInfo **dir_fi,
+                                                char **etag)
+{
+    LoadData *data = g_object_get_data(G_OBJECT(job), "fm-snapshot-load");
+    FmFileInfoList *files;
+
+    if (data == NULL || data->files == NULL || fm_job_is_cancelled(job))
+        return NULL;
+    files = data->files;
+    *dir_fi = data->dir_fi;
+    *etag = data->etag;
+    data->files = NULL;
+    data->dir_fi = NULL;
+    data->etag = NULL;
+    return files;
+}
+
+GString *_fm_folder_snapshot_serialize(FmPath *dir, FmFileInfo *dir_fi,
+                                       FmFileInfoList *files, const char *etag)
+{
+    char *uri;
+    GString *buf;
+    GList *l;
+    guint n = fm_file_info_list_get_length(files);
+
+    if (dir_fi == NULL || n > SNAPSHOT_MAX_FILES)
+        return NULL;
+    uri = fm_path_to_uri(dir);
+    buf = g_string_sized_new(256 + n * 128);
+    g_string_append_len(buf, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_LEN);
+    _fm_snapshot_put_string(buf, uri);
+    _fm_snapshot_put_string(buf, etag);
+    _fm_file_info_write_snapshot(dir_fi, buf);
+    _fm_snapshot_put_uint(buf, n);
+    for (l = fm_file_info_list_peek_head_link(files); l; l = l->next)
+        _fm_file_info_write_snapshot(l->data, buf);
+    g_free(uri);
+    return buf;
+}
+
+typedef struct
+{
+    char *file;
+    GString *data; /* NULL to drop the snapshot */
+} SaveData;
+
+static void save_data_free(gpointer user_data)
+{
+    SaveData *data = user_data;
+
+    g_free(data->file);
+    if (data->data)
+        g_string_free(data->data, TRUE);
+    g_slice_free(SaveData, data);
+}
+
+typedef struct
+{
+    char *path;
+    time_t mtime;
+    goffset size;
+} StoreItem;
+
+static gint compare_store_items(gconstpointer a, gconstpointer b)
+{
+    const StoreItem *ia = a, *ib = b;
+
+    return (ia->mtime < ib->mtime) ? -1 : (ia->mtime > ib->mtime);
+}
+
+/* Running total size of the store, -1 until the store is scanned first
+   time. Snapshots saved by other processes are counted on the next scan.
+   Protected by store lock which also serializes saving of snapshots. */
+static goffset store_size = -1;
+G_LOCK_DEFINE_STATIC(store);
+
+/* remove oldest snapshots until the store fits into its limit, returns
+   the size of the store after that */
+static goffset _trim_store(const char *dir_path)
+{
+    GDir *dir = g_dir_open(dir_path, 0, NULL);
+    const char *name;
+    GSList *items = NULL, *l;
+    goffset total = 0;
+
+    if (dir == NULL)
+        return 0;
+    while ((name = g_dir_read_name(dir)) != NULL)
+    {
+        char *path = g_build_filename(dir_path, name, NULL);
+        GStatBuf st;
+        StoreItem *item;
+
+        if (g_stat(path, &st) < 0 || !S_ISREG(st.st_mode))
+        {
+            g_free(path);
+            continue;
+        }
+        item = g_slice_new(StoreItem);
+        item->path = path;
+        item->mtime = st.st_mtime;
+        item->size = st.st_size;
+        total += st.st_size;
+        items = g_slist_prepend(items, item);
+    }
+    g_dir_close(dir);
+    items = g_slist_sort(items, compare_store_items);
+    for (l = items; l; l = l->next)
+    {
+        StoreItem *item = l->data;
+        if (total > SNAPSHOT_STORE_TRIM_SIZE && g_unlink(item->path) == 0)
+            total -= item->size;
+        g_free(item->path);
+        g_slice_free(StoreItem, item);
+    }
+    g_slist_free(items);
+    return total;
+}
+
+static gboolean save_snapshot_job(FmJob *job, gpointer user_data)
+{
+    SaveData *data = user_data;
+    GStatBuf st;
+    goffset old_size;
+    char *dir;
+
+    G_LOCK(store);
+    old_size = (g_stat(data->file, &st) == 0) ? st.st_size : 0;
+    if (data->data == NULL)
+    {
+        if (g_unlink(data->file) == 0 && store_size >= 0)
+            store_size -= old_size;
+        G_UNLOCK(store);
+        return TRUE;
+    }
+    dir = _snapshot_dir();
+    if (g_mkdir_with_parents(dir, 0700) == 0 &&
+        g_file_set_contents(data->file, data->data->str, data->data->len, NULL))
+    {
+        if (store_size >= 0)
+            store_size += (goffset)data->data->len - old_size;
+        /* scan the store on first save and then only if it is over limit */
+        if (store_size < 0 || store_size > SNAPSHOT_STORE_MAX_SIZE)
+            store_size = _trim_store(dir);
+    }
+    G_UNLOCK(store);
+    g_free(dir);
+    return TRUE;
+}
+
+void _fm_folder_snapshot_save(FmPath *dir, FmFileInfo *dir_fi,
+                              FmFileInfoList *files, const char *etag)
+{
+    char *uri = fm_path_to_uri(dir);
+    SaveData *data = g_slice_new(SaveData);
+    FmJob *job;
+
+    data->file = _snapshot_file(uri);
+    /* serialize in the caller thread since file infos may change later */
+    data->data = _fm_folder_snapshot_serialize(dir, dir_fi, files, etag);
+    g_free(uri);
+    job = fm_simple_job_new(save_snapshot_job, data, save_data_free);
+    if (!fm_job_run_async(job))
+        g_debug("failed to start listing snapshot save");
+    g_object_unref(job);
+}
@@ -0,0 +1,68 @@
+/*
+ *      fm-folder-snapshot.h
+ *
+ *      This file is a part of the Libfm library.
+ *
+ *      This library is free software; you can redistribute it and/or
+ *      modify it under the terms of the GNU Lesser General Public
+ *      License as published by the Free Software Foundation; either
+ *      version 2.1 of the License, or (at your option) any later version.
+ *
+ *      This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* This header is internal for libfm and is not installed. */
+
+#ifndef __FM_FOLDER_SNAPSHOT_H__
+#define __FM_FOLDER_SNAPSHOT_H__
+
+#include <glib.h>
+#include "fm-path.h"
+#include "fm-file-info.h"
+#include "fm-job.h"
+#include "fm-dir-list-job.h"
+
+G_BEGIN_DECLS
+
+gboolean _fm_folder_snapshot_is_wanted(FmPath *dir);
+/* TRUE for remote folders which listing takes long */
+gboolean _fm_folder_is_slow(FmPath *dir);
+
+/* the job reads and parses the snapshot in its thread, then the result
+   can be taken from its "finished" signal handler */
+FmJob *_fm_folder_snapshot_load_job_new(FmPath *dir);
+FmFileInfoList *_fm_folder_snapshot_load_finish(FmJob *job, FmFileInfo **dir_fi,
+                                                char **etag);
+void _fm_folder_snapshot_save(FmPath *dir, FmFileInfo *dir_fi,
+                              FmFileInfoList *files, const char *etag);
+
+/* whole listing in the snapshot format, used by load and save */
+GString *_fm_folder_snapshot_serialize(FmPath *dir, FmFileInfo *dir_fi,
+                                       FmFileInfoList *files, const char *etag);
+FmFileInfoList *_fm_folder_snapshot_parse(FmPath *dir, const char *data, gsize len,
+                                          FmFileInfo **dir_fi, char **etag);
+
+/* primitives of compact snapshot format */
+void _fm_snapshot_put_uint(GString *buf, guint64 val);
+void _fm_snapshot_put_string(GString *buf, const char *str);
+gboolean _fm_snapshot_get_uint(const char **data, const char *end, guint64 *val);
+gboolean _fm_snapshot_get_string(const char **data, const char *end, const char **str);
+
+/* implemented in fm-dir-list-job.c */
+const char *_fm_dir_list_job_get_etag(FmDirListJob *job);
+
+/* implemented in fm-file-info.c */
+void _fm_file_info_write_snapshot(FmFileInfo *fi, GString *buf);
+FmFileInfo *_fm_file_info_new_from_snapshot(FmPath *path, FmPath *parent,
+                                            const char **data, const char *end);
+
+G_END_DECLS
+
+#endif /* __FM_FOLDER_SNAPSHOT_H__ */
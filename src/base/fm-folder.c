@@ -31,6 +31,12 @@
  * The #FmFolder object allows to open and monitor items of some directory
  * (either local or remote), i.e. files and directories, to have fast access
  * to their info and to info of the directory itself as well.
+ *
+ * Since 1.3.0 folders released by all users are not freed immediately but
+ * kept in a small cache (see #FmConfig:folder_cache_size) so reopening
+ * them is instant. Changes in cached folder are applied when it is taken
+ * from the cache, using only #FmFolder::files-added, #FmFolder::files-removed,
+ * and #FmFolder::files-changed signals.
  */
 
 #include "fm-folder.h"
@@ -39,6 +45,8 @@
 #include "fm-dummy-monitor.h"
 #include "fm-file.h"
 #include "fm-config.h"
+#include "fm-folder-snapshot.h"
+#include "fm-trace.h"
 
 #include <string.h>
 
@@ -80,6 +88,8 @@ struct _FmFolder
     gboolean wants_incremental;
     guint idle_reload_handler;
     gboolean stop_emission; /* don't set it 1 bit to not lock other bits */
+    guint n_blocked_events; /* changes queued while updates are blocked */
+    gboolean dirty; /* changes were dropped, list folder again on unblock */
 
     /* filesystem info - set in query thread, read in main */
     guint64 fs_total_size;
@@ -88,6 +98,25 @@ struct _FmFolder
     gboolean has_fs_info : 1;
     gboolean fs_info_not_avail : 1;
     gboolean defer_content_test : 1;
+
+    /* for cache of released folders - protected by hash lock */
+    gboolean retained : 1; /* folder is in cache and cache holds a ref */
+    gboolean no_retain : 1; /* folder is being evicted from cache */
+    gboolean prefetched : 1; /* loaded by prefetch and not used since */
+    gsize retained_size; /* memory accounted for the folder in cache */
+    guint last_used; /* value of use_counter when folder was requested */
+    FmDirListJob* revalidate_job;
+
+    /* for listing snapshots of slow folders */
+    char* etag; /* entity tag of the folder when it was listed */
+    char* revalidate_etag; /* entity tag of changed folder being listed */
+    FmJob* snapshot_job; /* reads the snapshot in place of listing */
+
+    /* for polling of remote folders which have no working monitor */
+    guint poll_handler;
+    GCancellable* poll_cancellable; /* not NULL while probe is running */
+    guint poll_interval; /* in seconds, 0 if polling is not possible */
+    const char* poll_host; /* interned */
 };
 
 static void fm_folder_dispose(GObject *object);
@@ -95,6 +124,12 @@ static void fm_folder_finalize(GObject *object);
 static void fm_folder_content_changed(FmFolder* folder);
 
 static GList* _fm_folder_get_file_by_path(FmFolder* folder, FmPath *path);
+static gboolean _fm_folder_retain(FmFolder* folder);
+static void _fm_folder_revalidate(FmFolder* folder);
+static void _fm_folder_create_monitor(FmFolder* folder);
+static void _fm_folder_query_changes(FmFolder* folder);
+static void _fm_folder_poll_start(FmFolder* folder);
+static void _fm_folder_poll_stop(FmFolder* folder);
 
 G_DEFINE_TYPE(FmFolder, fm_folder, G_TYPE_OBJECT);
 
@@ -104,6 +139,42 @@ static int hash_uses = 0;
 
 static GVolumeMonitor* volume_monitor = NULL;
 
+/* Folders which were released by all users but are kept loaded for a
+   while so reopening them is instant. The head is most recently used.
+   The cache holds one reference on each folder in it. */
+static GQueue retained_folders = G_QUEUE_INIT;
+static gsize retained_memory = 0; /* estimated, in bytes */
+static guint use_counter = 0; /* protected by hash lock */
+
+/* estimated memory used by single file in the folder: FmFileInfo itself,
+   its strings, collate keys, and the list link */
+#define FOLDER_CACHE_ITEM_SIZE 512
+
+/* Speculative prefetch of folders which will likely be opened next. The
+   candidates are loaded one by one when nothing else is loading and then
+   released into the least recently used end of the cache above, so they
+   are dropped first. Accessed from main thread only. */
+#define PREFETCH_QUEUE_SIZE 4
+static GQueue prefetch_queue = G_QUEUE_INIT; /* of FmPath, head is next */
+static FmFolder* prefetch_folder = NULL; /* being loaded by prefetch now */
+static guint prefetch_handler = 0;
+static gboolean in_prefetch = FALSE;
+
+static void _fm_folder_prefetch_pause(FmPath* path);
+
+/* Limit of changes collected while updates of folder are blocked, such
+   as for folders in the cache above. If there are more of them then it is
+   cheaper to forget them and list the folder again when it is unblocked. */
+#define MAX_BLOCKED_EVENTS 1000
+
+/* Remote folders are polled while they are in use: the folder info is
+   queried and only if it was changed then folder is listed again. The
+   interval is doubled each time nothing was changed. Only one probe per
+   host is running at any time. Accessed from main thread only. */
+#define POLL_MIN_INTERVAL 5 /* seconds */
+#define POLL_MAX_INTERVAL 120
+static GHashTable* poll_hosts = NULL; /* host -> probe is running */
+
 static void on_mount_added(GVolumeMonitor* vm, GMount* mount, gpointer user_data);
 static void on_mount_removed(GVolumeMonitor* vm, GMount* mount, gpointer user_data);
 
@@ -460,6 +531,7 @@ static gboolean on_idle(FmFolder* folder)
         folder->files_to_del = NULL;
         files_to_update = folder->files_to_update;
         folder->files_to_update = NULL;
+        folder->n_blocked_events = 0;
     }
     G_UNLOCK(lists);
 
@@ -547,14 +619,36 @@ _finish:
     return FALSE;
 }
 
+/* should be called with lists lock held; returns TRUE if the folder will
+   be listed again on unblock so there is no sense to queue this change */
+static gboolean _fm_folder_events_overflow(FmFolder *folder)
+{
+    if(!folder->stop_emission)
+        return FALSE;
+    if(folder->dirty)
+        return TRUE;
+    if(++folder->n_blocked_events <= MAX_BLOCKED_EVENTS)
+        return FALSE;
+    g_slist_free_full(folder->files_to_add, (GDestroyNotify)fm_path_unref);
+    folder->files_to_add = NULL;
+    g_slist_free_full(folder->files_to_update, (GDestroyNotify)fm_path_unref);
+    folder->files_to_update = NULL;
+    g_slist_free(folder->files_to_del);
+    folder->files_to_del = NULL;
+    folder->dirty = TRUE;
+    return TRUE;
+}
+
 /* returns TRUE if reference was taken from path */
 gboolean _fm_folder_event_file_added(FmFolder *folder, FmPath *path)
 {
     gboolean added = TRUE;
 
     G_LOCK(lists);
+    if(_fm_folder_events_overflow(folder))
+        added = FALSE;
     /* make sure that the file is not already queued for addition. */
-    if(!g_slist_find(folder->files_to_add, path))
+    else if(!g_slist_find(folder->files_to_add, path))
     {
         GList *l = _fm_folder_get_file_by_path(folder, path);
         if(!l) /* it's new file */
@@ -593,7 +687,8 @@ gboolean _fm_folder_event_file_changed(FmFolder *folder, FmPath *path)
     G_LOCK(lists);
     /* make sure that the file is not already queued for changes or
      * it's already queued for addition. */
-    if(!g_slist_find(folder->files_to_update, path) &&
+    if(!_fm_folder_events_overflow(folder) &&
+       !g_slist_find(folder->files_to_update, path) &&
        !g_slist_find(folder->files_to_add, path) &&
        _fm_folder_get_file_by_path(folder, path)) /* ensure it is our file */
     {
@@ -616,6 +711,11 @@ void _fm_folder_event_file_deleted(FmFolder *folder, FmPath *path)
     GSList *sl;
 
     G_LOCK(lists);
+    if(_fm_folder_events_overflow(folder))
+    {
+        G_UNLOCK(lists);
+        return;
+    }
     l = _fm_folder_get_file_by_path(folder, path);
     if(l && !g_slist_find(folder->files_to_del, l) )
         folder->files_to_del = g_slist_prepend(folder->files_to_del, l);
@@ -688,7 +788,8 @@ static void on_folder_changed(GFileMonitor* mon, GFile* gf, GFile* other, GFileM
         case G_FILE_MONITOR_EVENT_CHANGED:
             folder->pending_change_notify = TRUE;
             G_LOCK(lists);
-            if (g_slist_find(folder->files_to_update, folder->dir_path) == NULL)
+            if (!_fm_folder_events_overflow(folder) &&
+                g_slist_find(folder->files_to_update, folder->dir_path) == NULL)
             {
                 folder->files_to_update = g_slist_append(folder->files_to_update, fm_path_ref(folder->dir_path));
                 if(!folder->idle_handler)
@@ -800,9 +901,19 @@ static void on_dirlist_job_finished(FmDirListJob* job, FmFolder* folder)
     else if(!folder->dir_fi && job->dir_fi)
         /* we may need dir_fi for incremental folders too */
         folder->dir_fi = fm_file_info_ref(job->dir_fi);
+    if(!fm_job_is_cancelled(FM_JOB(job)) && !folder->wants_incremental &&
+       _fm_folder_snapshot_is_wanted(folder->dir_path))
+    {
+        /* reload has forgot the old tag, keep one taken by this listing */
+        g_free(folder->etag);
+        folder->etag = g_strdup(_fm_dir_list_job_get_etag(job));
+        _fm_folder_snapshot_save(folder->dir_path, folder->dir_fi,
+                                 folder->files, folder->etag);
+    }
     g_object_unref(folder->dirlist_job);
     folder->dirlist_job = NULL;
 
+    FM_TRACE2(folder__load__finish, folder, fm_file_info_list_get_length(folder->files));
     g_object_ref(folder);
     g_signal_emit(folder, signals[FINISH_LOADING], 0);
     g_object_unref(folder);
@@ -834,13 +945,79 @@ static FmJobErrorAction on_dirlist_job_error(FmDirListJob* job, GError* err, FmJ
     return ret;
 }
 
+static void on_snapshot_job_finished(FmJob* job, FmFolder* folder)
+{
+    FmFileInfoList* files;
+    FmFileInfo* dir_fi = NULL;
+    GSList* added = NULL;
+    FmFileInfo* inf;
+
+    files = _fm_folder_snapshot_load_finish(job, &dir_fi, &folder->etag);
+    g_object_unref(folder->snapshot_job);
+    folder->snapshot_job = NULL;
+    if(files == NULL)
+    {
+        /* there is no usable snapshot, so list the folder as usual */
+        fm_folder_reload(folder);
+        return;
+    }
+    FM_TRACE2(folder__load__snapshot, folder, fm_file_info_list_get_length(files));
+    while((inf = fm_file_info_list_pop_head(files)) != NULL)
+    {
+        fm_file_info_list_push_tail_noref(folder->files, inf);
+        added = g_slist_prepend(added, inf);
+    }
+    fm_file_info_list_unref(files);
+    folder->dir_fi = dir_fi;
+    _fm_folder_create_monitor(folder);
+    _fm_folder_query_changes(folder);
+    fm_folder_query_filesystem_info(folder);
+
+    g_object_ref(folder);
+    if(added)
+    {
+        g_signal_emit(folder, signals[FILES_ADDED], 0, added);
+        g_slist_free(added);
+    }
+    g_signal_emit(folder, signals[FINISH_LOADING], 0);
+    g_object_unref(folder);
+}
+
+static void free_snapshot_job(FmFolder* folder)
+{
+    g_signal_handlers_disconnect_by_func(folder->snapshot_job, on_snapshot_job_finished, folder);
+    fm_job_cancel(folder->snapshot_job);
+    g_object_unref(folder->snapshot_job);
+    folder->snapshot_job = NULL;
+}
+
+/* starts filling new folder from its listing snapshot in background; if
+   there is a snapshot then a test if the folder was changed since it was
+   made is started after that, otherwise the folder is listed as usual */
+static gboolean _fm_folder_load_snapshot(FmFolder* folder)
+{
+    if(folder->wants_incremental || !_fm_folder_snapshot_is_wanted(folder->dir_path))
+        return FALSE;
+    folder->snapshot_job = _fm_folder_snapshot_load_job_new(folder->dir_path);
+    g_signal_connect(folder->snapshot_job, "finished",
+                     G_CALLBACK(on_snapshot_job_finished), folder);
+    if(!fm_job_run_async(folder->snapshot_job))
+    {
+        g_object_unref(folder->snapshot_job);
+        folder->snapshot_job = NULL;
+        return FALSE;
+    }
+    return TRUE;
+}
+
 static FmFolder* fm_folder_new_internal(FmPath* path, GFile* gf)
 {
     FmFolder* folder = (FmFolder*)g_object_new(FM_TYPE_FOLDER, NULL);
     folder->dir_path = fm_path_ref(path);
     folder->gf = (GFile*)g_object_ref(gf);
     folder->wants_incremental = fm_file_wants_incremental(gf);
-    fm_folder_reload(folder);
+    if(!_fm_folder_load_snapshot(folder))
+        fm_folder_reload(folder);
     return folder;
 }
 
@@ -851,8 +1028,27 @@ static FmFolder* fm_folder_get_internal(FmPath* path, GFile* gf)
     /* FIXME: should we provide a generic FmPath cache in fm-path.c
      * to associate all kinds of data structures with FmPaths? */
 
+    /* real user request has priority over any speculative loading */
+    if(!in_prefetch && g_main_context_is_owner(g_main_context_default()))
+        _fm_folder_prefetch_pause(path);
+
     G_LOCK(hash);
     folder = hash ? (FmFolder*)g_hash_table_lookup(hash, path) : NULL;
+    if(folder)
+        folder->last_used = ++use_counter;
+
+    if(folder && folder->retained)
+    {
+        /* take the folder from cache, the reference held by the cache
+           is passed to the caller now */
+        g_queue_remove(&retained_folders, folder);
+        retained_memory -= folder->retained_size;
+        folder->retained = FALSE;
+        folder->prefetched = FALSE;
+        G_UNLOCK(hash);
+        _fm_folder_revalidate(folder);
+        return folder;
+    }
 
     if( G_UNLIKELY(!folder) )
     {
@@ -866,9 +1062,16 @@ static FmFolder* fm_folder_get_internal(FmPath* path, GFile* gf)
             g_object_unref(_gf);
         G_LOCK(hash);
         g_hash_table_insert(hash, folder->dir_path, folder);
+        folder->prefetched = in_prefetch;
+        folder->last_used = ++use_counter;
     }
     else
+    {
         g_object_ref(folder);
+        /* it might be evicted from cache while somebody kept it */
+        folder->no_retain = FALSE;
+        folder->prefetched = FALSE;
+    }
     G_UNLOCK(hash);
     return folder;
 }
@@ -884,6 +1087,499 @@ static void free_dirlist_job(FmFolder* folder)
     folder->dirlist_job = NULL;
 }
 
+/* updates folder content to match the listing @files, emitting signals
+   only for files which were added, removed, or changed since last load */
+static void _fm_folder_apply_listing(FmFolder* folder, FmFileInfoList* files,
+                                     FmFileInfo* dir_fi)
+{
+    GHashTable* old_files;
+    GHashTableIter it;
+    GSList *files_to_add = NULL, *files_to_update = NULL, *files_to_del = NULL;
+    GList* l;
+    gpointer link;
+    gboolean dir_changed = FALSE;
+
+    /* FmPath objects are unique so they can be compared as pointers */
+    old_files = g_hash_table_new(g_direct_hash, NULL);
+    for(l = fm_file_info_list_peek_head_link(folder->files); l; l = l->next)
+        g_hash_table_insert(old_files, fm_file_info_get_path(l->data), l);
+
+    G_LOCK(lists);
+    for(l = fm_file_info_list_peek_head_link(files); l; l = l->next)
+    {
+        FmFileInfo* fi = (FmFileInfo*)l->data;
+        FmPath* path = fm_file_info_get_path(fi);
+        GList* l2 = g_hash_table_lookup(old_files, path);
+
+        if(l2 == NULL) /* it's new file */
+        {
+            fm_file_info_list_push_tail(folder->files, fi);
+            files_to_add = g_slist_prepend(files_to_add, fi);
+        }
+        else
+        {
+            FmFileInfo* fi2 = (FmFileInfo*)l2->data;
+
+            g_hash_table_remove(old_files, path);
+            if(fm_file_info_get_mtime(fi2) != fm_file_info_get_mtime(fi) ||
+               fm_file_info_get_size(fi2) != fm_file_info_get_size(fi) ||
+               fm_file_info_get_mode(fi2) != fm_file_info_get_mode(fi))
+            {
+                /* see FIXME in on_file_info_job_finished() */
+                fm_file_info_update(fi2, fi);
+                files_to_update = g_slist_prepend(files_to_update, fi2);
+            }
+        }
+    }
+    /* everything left was deleted */
+    g_hash_table_iter_init(&it, old_files);
+    while(g_hash_table_iter_next(&it, NULL, &link))
+    {
+        l = (GList*)link;
+        /* the link might be queued for deletion by monitor already */
+        folder->files_to_del = g_slist_remove(folder->files_to_del, l);
+        files_to_del = g_slist_prepend(files_to_del, l->data);
+        fm_file_info_list_delete_link_nounref(folder->files, l);
+    }
+    G_UNLOCK(lists);
+    g_hash_table_destroy(old_files);
+
+    if(dir_fi && folder->dir_fi)
+    {
+        dir_changed = (fm_file_info_get_mtime(folder->dir_fi) != fm_file_info_get_mtime(dir_fi));
+        fm_file_info_update(folder->dir_fi, dir_fi);
+    }
+    else if(dir_fi)
+        folder->dir_fi = fm_file_info_ref(dir_fi);
+
+    g_object_ref(folder);
+    if(files_to_del)
+    {
+        g_signal_emit(folder, signals[FILES_REMOVED], 0, files_to_del);
+        g_slist_free_full(files_to_del, (GDestroyNotify)fm_file_info_unref);
+    }
+    if(files_to_add)
+    {
+        g_signal_emit(folder, signals[FILES_ADDED], 0, files_to_add);
+        g_slist_free(files_to_add);
+    }
+    if(files_to_update)
+    {
+        g_signal_emit(folder, signals[FILES_CHANGED], 0, files_to_update);
+        g_slist_free(files_to_update);
+    }
+    if(dir_changed)
+        g_signal_emit(folder, signals[CHANGED], 0);
+    if(files_to_del || files_to_add || files_to_update)
+        g_signal_emit(folder, signals[CONTENT_CHANGED], 0);
+    g_object_unref(folder);
+}
+
+static void on_revalidate_job_finished(FmDirListJob* job, FmFolder* folder)
+{
+    if(!fm_job_is_cancelled(FM_JOB(job)))
+    {
+        g_free(folder->etag);
+        folder->etag = folder->revalidate_etag;
+        folder->revalidate_etag = NULL;
+        _fm_folder_apply_listing(folder, job->files, job->dir_fi);
+        if(_fm_folder_snapshot_is_wanted(folder->dir_path))
+            _fm_folder_snapshot_save(folder->dir_path, folder->dir_fi,
+                                     folder->files, folder->etag);
+    }
+    g_object_unref(folder->revalidate_job);
+    folder->revalidate_job = NULL;
+}
+
+static void free_revalidate_job(FmFolder* folder)
+{
+    g_signal_handlers_disconnect_by_func(folder->revalidate_job, on_revalidate_job_finished, folder);
+    fm_job_cancel(FM_JOB(folder->revalidate_job));
+    g_object_unref(folder->revalidate_job);
+    folder->revalidate_job = NULL;
+    g_free(folder->revalidate_etag);
+    folder->revalidate_etag = NULL;
+}
+
+/* tests if folder was changed since it was listed: entity tag is more
+   reliable if backend supports it, otherwise test modification time */
+static gboolean _fm_folder_is_changed(FmFolder* folder, GFileInfo* inf)
+{
+    const char* etag = g_file_info_get_etag(inf);
+
+    if(etag && folder->etag)
+        return (strcmp(etag, folder->etag) != 0);
+    /* if backend doesn't support mtime then we cannot test it */
+    if(!g_file_info_has_attribute(inf, G_FILE_ATTRIBUTE_TIME_MODIFIED) ||
+       folder->dir_fi == NULL)
+        return TRUE;
+    if((time_t)g_file_info_get_attribute_uint64(inf, G_FILE_ATTRIBUTE_TIME_MODIFIED)
+        != fm_file_info_get_mtime(folder->dir_fi))
+        return TRUE;
+    /* remember the tag for the next test */
+    if(etag)
+        folder->etag = g_strdup(etag);
+    return FALSE;
+}
+
+/* the folder was changed, load it in background and apply changes;
+   @inf is the folder info which was tested, may be %NULL */
+static void _fm_folder_start_revalidate(FmFolder* folder, GFileInfo* inf)
+{
+    folder->revalidate_etag = inf ? g_strdup(g_file_info_get_etag(inf)) : NULL;
+    FM_TRACE2(folder__revalidate, folder, fm_path_get_basename(folder->dir_path));
+    folder->revalidate_job = fm_dir_list_job_new2(folder->dir_path,
+                                                  FM_DIR_LIST_JOB_DETAILED);
+    g_signal_connect(folder->revalidate_job, "finished",
+                     G_CALLBACK(on_revalidate_job_finished), folder);
+    if (!fm_job_run_async(FM_JOB(folder->revalidate_job)))
+    {
+        g_object_unref(folder->revalidate_job);
+        folder->revalidate_job = NULL;
+        g_free(folder->revalidate_etag);
+        folder->revalidate_etag = NULL;
+        g_critical("failed to start directory revalidation job for the folder");
+    }
+}
+
+static void on_revalidate_query_finished(GObject *src, GAsyncResult *res, FmFolder* folder)
+{
+    GFileInfo* inf = g_file_query_info_finish(G_FILE(src), res, NULL);
+
+    if(inf == NULL)
+        /* the folder is inaccessible now, let reload handle the error */
+        queue_reload(folder);
+    /* don't revalidate if folder is being reloaded already */
+    else if(folder->dirlist_job == NULL && folder->revalidate_job == NULL &&
+            _fm_folder_is_changed(folder, inf))
+        _fm_folder_start_revalidate(folder, inf);
+    if(inf)
+        g_object_unref(inf);
+    g_object_unref(folder);
+}
+
+/* tests if the folder was changed and if so then gets listing in background */
+static void _fm_folder_query_changes(FmFolder* folder)
+{
+    g_file_query_info_async(folder->gf, G_FILE_ATTRIBUTE_TIME_MODIFIED","
+                                        G_FILE_ATTRIBUTE_ETAG_VALUE,
+                            G_FILE_QUERY_INFO_NONE, G_PRIORITY_LOW, NULL,
+                            (GAsyncReadyCallback)on_revalidate_query_finished,
+                            g_object_ref(folder));
+}
+
+/* some changes of folder were lost, list it and apply the difference */
+static void _fm_folder_relist(FmFolder* folder)
+{
+    /* folder being listed from scratch will get everything anyway */
+    if(folder->dirlist_job != NULL || folder->snapshot_job != NULL)
+        return;
+    /* running revalidation may miss the lost changes, start it again */
+    if(folder->revalidate_job != NULL)
+        free_revalidate_job(folder);
+    _fm_folder_start_revalidate(folder, NULL);
+}
+
+static gboolean on_poll_timeout(gpointer user_data);
+
+static void _fm_folder_poll_schedule(FmFolder* folder)
+{
+    /* the source holds no reference so there should be only one */
+    if(folder->poll_handler)
+        g_source_remove(folder->poll_handler);
+    folder->poll_handler = g_timeout_add_seconds(folder->poll_interval,
+                                                 on_poll_timeout, folder);
+}
+
+static void on_poll_query_finished(GObject *src, GAsyncResult *res, FmFolder* folder)
+{
+    GFileInfo* inf = g_file_query_info_finish(G_FILE(src), res, NULL);
+
+    g_hash_table_remove(poll_hosts, folder->poll_host);
+    /* polling was stopped while probe was running */
+    if(folder->poll_cancellable == NULL)
+    {
+        if(inf)
+            g_object_unref(inf);
+        g_object_unref(folder);
+        return;
+    }
+    g_object_unref(folder->poll_cancellable);
+    folder->poll_cancellable = NULL;
+    if(inf == NULL)
+        /* server may be down, don't bother it often */
+        folder->poll_interval = POLL_MAX_INTERVAL;
+    else if(g_file_info_get_etag(inf) == NULL &&
+            !g_file_info_has_attribute(inf, G_FILE_ATTRIBUTE_TIME_MODIFIED))
+        /* backend gives nothing to test, each probe would list folder */
+        folder->poll_interval = 0;
+    else if(folder->dirlist_job == NULL && folder->revalidate_job == NULL &&
+            _fm_folder_is_changed(folder, inf))
+    {
+        folder->poll_interval = POLL_MIN_INTERVAL;
+        _fm_folder_start_revalidate(folder, inf);
+    }
+    else
+        folder->poll_interval = MIN(folder->poll_interval * 2, POLL_MAX_INTERVAL);
+    if(inf)
+        g_object_unref(inf);
+    /* _fm_folder_poll_start() might schedule next probe already */
+    if(folder->poll_handler == 0 && folder->poll_interval > 0 && folder->dir_path)
+        _fm_folder_poll_schedule(folder);
+    g_object_unref(folder);
+}
+
+static gboolean on_poll_timeout(gpointer user_data)
+{
+    FmFolder* folder = (FmFolder*)user_data;
+
+    folder->poll_handler = 0;
+    /* folder is being listed already or another probe for the same host
+       is running now, so just try again later */
+    if(folder->dirlist_job != NULL || folder->revalidate_job != NULL ||
+       folder->poll_cancellable != NULL ||
+       g_hash_table_lookup(poll_hosts, folder->poll_host) != NULL)
+    {
+        _fm_folder_poll_schedule(folder);
+        return FALSE;
+    }
+    g_hash_table_insert(poll_hosts, (gpointer)folder->poll_host, GINT_TO_POINTER(1));
+    folder->poll_cancellable = g_cancellable_new();
+    g_file_query_info_async(folder->gf, G_FILE_ATTRIBUTE_TIME_MODIFIED","
+                                        G_FILE_ATTRIBUTE_ETAG_VALUE,
+                            G_FILE_QUERY_INFO_NONE, G_PRIORITY_LOW,
+                            folder->poll_cancellable,
+                            (GAsyncReadyCallback)on_poll_query_finished,
+                            g_object_ref(folder));
+    return FALSE;
+}
+
+/* returns server part of remote path, such as "sftp://host" for remote
+   one or "sftp:host=host" for gvfs FUSE path, as interned string */
+static const char* _fm_folder_poll_host(FmPath* path)
+{
+    FmPath* parent;
+
+    if(!fm_path_is_native(path))
+        return g_intern_string(fm_path_get_basename(fm_path_get_scheme_path(path)));
+    for(; (parent = fm_path_get_parent(path)) != NULL; path = parent)
+    {
+        const char* name = fm_path_get_basename(parent);
+        if(strcmp(name, "gvfs") == 0 || strcmp(name, ".gvfs") == 0)
+            break;
+    }
+    return g_intern_string(fm_path_get_basename(path));
+}
+
+/* starts polling of slow folder since its monitor doesn't see changes
+   made on server, or of folder without monitor at all; restarts with the
+   shortest interval if polling is running already */
+static void _fm_folder_poll_start(FmFolder* folder)
+{
+    if(folder->wants_incremental ||
+       (folder->mon != NULL && !_fm_folder_is_slow(folder->dir_path)))
+        return;
+    folder->poll_host = _fm_folder_poll_host(folder->dir_path);
+    folder->poll_interval = POLL_MIN_INTERVAL;
+    _fm_folder_poll_schedule(folder);
+}
+
+static void _fm_folder_poll_stop(FmFolder* folder)
+{
+    if(folder->poll_handler)
+        g_source_remove(folder->poll_handler);
+    folder->poll_handler = 0;
+    /* the probe holds a reference on folder so it will be finished */
+    if(folder->poll_cancellable)
+    {
+        g_cancellable_cancel(folder->poll_cancellable);
+        g_object_unref(folder->poll_cancellable);
+        folder->poll_cancellable = NULL;
+    }
+}
+
+/* called when folder is taken from cache of released folders */
+static void _fm_folder_revalidate(FmFolder* folder)
+{
+    /* monitor might be released to save kernel watches, folder was marked
+       dirty then, so watch it again before it is listed on unblock */
+    if(folder->mon == NULL)
+        _fm_folder_create_monitor(folder);
+    /* replay all changes collected by the monitor while it was in cache */
+    fm_folder_unblock_updates(folder);
+    /* dummy monitor doesn't report changes so test the folder instead */
+    if(folder->mon == NULL || FM_IS_DUMMY_MONITOR(folder->mon))
+        _fm_folder_query_changes(folder);
+    /* folder is in use again so keep it fresh */
+    _fm_folder_poll_start(folder);
+}
+
+/* Folders in use which were requested most recently are most likely
+   visible so their monitors are never released. */
+#define WATCH_KEEP_RECENT 4
+
+/* tests if monitor of the folder may be dropped, should be called with
+   hash lock held */
+static inline gboolean _fm_folder_can_release_monitor(FmFolder* folder)
+{
+    GFileMonitor* mon = folder->mon;
+
+    /* skip monitors which are shared with someone else */
+    return (mon != NULL && !FM_IS_DUMMY_MONITOR(mon) &&
+            g_file_is_native(folder->gf) && G_OBJECT(mon)->ref_count == 1);
+}
+
+static GFileMonitor* _fm_folder_take_monitor(FmFolder* folder)
+{
+    GFileMonitor* mon = folder->mon;
+
+    g_signal_handlers_disconnect_by_func(mon, on_folder_changed, folder);
+    folder->mon = NULL;
+    return mon;
+}
+
+static gint _fm_folder_compare_last_used(gconstpointer a, gconstpointer b)
+{
+    guint used_a = ((FmFolder*)a)->last_used, used_b = ((FmFolder*)b)->last_used;
+
+    return (used_a < used_b) ? -1 : (used_a > used_b);
+}
+
+/* called by monitor code when too many kernel watches are used: drops
+   monitors of the least recently used folders in the cache first, such
+   folder is revalidated when taken from the cache. If that is not enough
+   then drops monitors of folders in use which were requested long ago,
+   least recently requested first, and polls them instead. */
+static guint _fm_folder_release_monitors(guint n_wanted)
+{
+    GSList* released = NULL, *polled = NULL, *l;
+    GList* item, *in_use = NULL;
+    GHashTableIter it;
+    gpointer value;
+    guint n = 0, n_in_use = 0;
+
+    /* signal handlers may be disconnected only in main thread */
+    if(!g_main_context_is_owner(g_main_context_default()))
+        return 0;
+    G_LOCK(hash);
+    for(item = retained_folders.tail; item && n < n_wanted; item = item->prev)
+    {
+        FmFolder* folder = (FmFolder*)item->data;
+
+        if(!_fm_folder_can_release_monitor(folder))
+            continue;
+        released = g_slist_prepend(released, _fm_folder_take_monitor(folder));
+        /* changes since now are not seen, list the folder on reuse */
+        G_LOCK(lists);
+        folder->dirty = TRUE;
+        G_UNLOCK(lists);
+        n++;
+    }
+    if(n < n_wanted && hash)
+    {
+        g_hash_table_iter_init(&it, hash);
+        while(g_hash_table_iter_next(&it, NULL, &value))
+        {
+            if(FM_FOLDER(value)->retained)
+                continue;
+            in_use = g_list_prepend(in_use, value);
+            n_in_use++;
+        }
+        in_use = g_list_sort(in_use, _fm_folder_compare_last_used);
+        for(item = in_use; item && n < n_wanted && n_in_use > WATCH_KEEP_RECENT;
+            item = item->next, n_in_use--)
+        {
+            FmFolder* folder = (FmFolder*)item->data;
+
+            if(!_fm_folder_can_release_monitor(folder))
+                continue;
+            released = g_slist_prepend(released, _fm_folder_take_monitor(folder));
+            polled = g_slist_prepend(polled, g_object_ref(folder));
+            n++;
+        }
+        g_list_free(in_use);
+    }
+    G_UNLOCK(hash);
+    /* monitors remove themselves from the monitor hash when destroyed */
+    for(l = released; l; l = l->next)
+        g_object_unref(l->data);
+    g_slist_free(released);
+    /* changes are not reported anymore so test the folders periodically */
+    for(l = polled; l; l = l->next)
+        _fm_folder_poll_start(l->data);
+    g_slist_free_full(polled, g_object_unref);
+    return n;
+}
+
+/* should be called with hash lock held, returns list of folders which
+   should be unreferenced after releasing the lock */
+static GSList* _fm_folder_cache_trim(guint max_size, gsize max_memory)
+{
+    GSList* evicted = NULL;
+
+    while(retained_folders.length > max_size || retained_memory > max_memory)
+    {
+        FmFolder* folder = (FmFolder*)g_queue_pop_tail(&retained_folders);
+
+        retained_memory -= folder->retained_size;
+        folder->retained = FALSE;
+        folder->no_retain = TRUE;
+        evicted = g_slist_prepend(evicted, folder);
+    }
+    return evicted;
+}
+
+/* called from fm_folder_dispose(), returns TRUE if folder was resurrected
+   and put into the cache of released folders */
+static gboolean _fm_folder_retain(FmFolder* folder)
+{
+    GSList* evicted;
+    guint max_size;
+    gsize max_memory, size;
+    gboolean ret = FALSE;
+
+    /* keep only valid completely loaded folders, and incremental ones
+       such as search results aren't worth keeping either */
+    if(folder->dir_path == NULL || folder->dirlist_job != NULL ||
+       folder->snapshot_job != NULL || folder->dir_fi == NULL || folder->wants_incremental)
+        return FALSE;
+    max_size = MAX(fm_config->folder_cache_size, 0);
+    max_memory = (gsize)MAX(fm_config->folder_cache_memory, 0) * 1024;
+    size = (fm_file_info_list_get_length(folder->files) + 1) * FOLDER_CACHE_ITEM_SIZE;
+
+    G_LOCK(hash);
+    if(!folder->no_retain && !folder->retained && max_size > 0 && size <= max_memory)
+    {
+        g_object_ref(folder); /* the reference is owned by cache now */
+        folder->retained = TRUE;
+        folder->retained_size = size;
+        /* speculatively loaded folder should never push out the folders
+           which user has really visited so it goes to the LRU end and is
+           the first one to be evicted */
+        if(folder->prefetched)
+            g_queue_push_tail(&retained_folders, folder);
+        else
+            g_queue_push_head(&retained_folders, folder);
+        folder->prefetched = FALSE;
+        retained_memory += size;
+        /* drop handlers left by former users as GObject would do */
+        g_signal_handlers_destroy(folder);
+        /* nobody watches the folder now so just collect the changes from
+           the monitor, they will be applied when folder is reopened */
+        G_LOCK(query);
+        folder->stop_emission = TRUE;
+        G_UNLOCK(query);
+        /* nobody looks at the folder so don't poll the server */
+        _fm_folder_poll_stop(folder);
+        ret = TRUE;
+    }
+    evicted = _fm_folder_cache_trim(max_size, max_memory);
+    G_UNLOCK(hash);
+
+    g_slist_free_full(evicted, g_object_unref);
+    return ret;
+}
+
 static void fm_folder_dispose(GObject *object)
 {
     FmFolder *folder;
@@ -894,9 +1590,21 @@ static void fm_folder_dispose(GObject *object)
 
     folder = (FmFolder*)object;
 
+    /* the folder may be resurrected and kept in cache */
+    if(_fm_folder_retain(folder))
+        return;
+
     if(folder->dirlist_job)
         free_dirlist_job(folder);
 
+    if(folder->snapshot_job)
+        free_snapshot_job(folder);
+
+    if(folder->revalidate_job)
+        free_revalidate_job(folder);
+
+    _fm_folder_poll_stop(folder);
+
     if(folder->pending_jobs)
     {
         GSList* l;
@@ -984,6 +1692,9 @@ static void fm_folder_dispose(GObject *object)
         folder->files = NULL;
     }
 
+    g_free(folder->etag);
+    folder->etag = NULL;
+
     (* G_OBJECT_CLASS(fm_folder_parent_class)->dispose)(object);
 }
 
@@ -1082,6 +1793,31 @@ FmFolder*    fm_folder_from_uri    (const char* uri)
     return folder;
 }
 
+static void _fm_folder_create_monitor(FmFolder* folder)
+{
+    GError* err = NULL;
+
+    if(folder->mon)
+    {
+        g_signal_handlers_disconnect_by_func(folder->mon, on_folder_changed, folder);
+        g_object_unref(folder->mon);
+        /* monitors of other folders may be released while creating new one */
+        folder->mon = NULL;
+    }
+    folder->mon = fm_monitor_directory(folder->gf, &err);
+    if(folder->mon)
+    {
+        g_signal_connect(folder->mon, "changed", G_CALLBACK(on_folder_changed), folder);
+    }
+    else
+    {
+        g_debug("file monitor cannot be created: %s", err->message);
+        g_error_free(err);
+        folder->mon = NULL;
+    }
+    _fm_folder_poll_start(folder);
+}
+
 /**
  * fm_folder_reload
  * @folder: folder to be reloaded
@@ -1093,8 +1829,6 @@ FmFolder*    fm_folder_from_uri    (const char* uri)
  */
 void fm_folder_reload(FmFolder* folder)
 {
-    GError* err = NULL;
-
     /* Tell the world that we're about to reload the folder.
      * It might be a good idea for users of the folder to disconnect
      * from the folder temporarily and reconnect to it again after
@@ -1140,6 +1874,10 @@ void fm_folder_reload(FmFolder* folder)
     /* cancel running dir listing job if there is any. */
     if(folder->dirlist_job)
         free_dirlist_job(folder);
+    if(folder->snapshot_job)
+        free_snapshot_job(folder);
+    if(folder->revalidate_job)
+        free_revalidate_job(folder);
 
     /* remove all existing files */
     if(l)
@@ -1156,27 +1894,17 @@ void fm_folder_reload(FmFolder* folder)
         fm_file_info_list_clear(folder->files); /* fm_file_info_unref will be invoked. */
     }
 
+    /* listing is made anew, so forget the entity tag */
+    g_free(folder->etag);
+    folder->etag = NULL;
+
     /* also re-create a new file monitor */
-    if(folder->mon)
-    {
-        g_signal_handlers_disconnect_by_func(folder->mon, on_folder_changed, folder);
-        g_object_unref(folder->mon);
-    }
-    folder->mon = fm_monitor_directory(folder->gf, &err);
-    if(folder->mon)
-    {
-        g_signal_connect(folder->mon, "changed", G_CALLBACK(on_folder_changed), folder);
-    }
-    else
-    {
-        g_debug("file monitor cannot be created: %s", err->message);
-        g_error_free(err);
-        folder->mon = NULL;
-    }
+    _fm_folder_create_monitor(folder);
 
     g_signal_emit(folder, signals[CONTENT_CHANGED], 0);
 
     /* run a new dir listing job */
+    FM_TRACE2(folder__load__start, folder, fm_path_get_basename(folder->dir_path));
     folder->defer_content_test = fm_config->defer_content_test;
     folder->dirlist_job = fm_dir_list_job_new2(folder->dir_path,
             folder->defer_content_test ? FM_DIR_LIST_JOB_FAST : FM_DIR_LIST_JOB_DETAILED);
@@ -1331,7 +2059,7 @@ FmFolder* fm_folder_from_path(FmPath* path)
  */
 gboolean fm_folder_is_loaded(FmFolder* folder)
 {
-    return (folder->dirlist_job == NULL);
+    return (folder->dirlist_job == NULL && folder->snapshot_job == NULL);
 }
 
 /**
@@ -1484,6 +2212,9 @@ void fm_folder_query_filesystem_info(FmFolder* folder)
  *
  * Checks if folder by @path is already in use.
  *
+ * Since 1.3.0 folders kept in cache after last user released them are
+ * not returned since changes for them are collected but not applied yet.
+ *
  * Returns: (transfer full): found folder or %NULL.
  *
  * Since: 1.2.0
@@ -1494,8 +2225,187 @@ FmFolder *fm_folder_find_by_path(FmPath *path)
 
     G_LOCK(hash);
     folder = hash ? (FmFolder*)g_hash_table_lookup(hash, path) : NULL;
+    if(folder && folder->retained)
+        folder = NULL;
+    else if(folder)
+        g_object_ref(folder);
     G_UNLOCK(hash);
-    return folder ? g_object_ref(folder) : NULL;
+    return folder;
+}
+
+/* retry delay if some folder is loading for user */
+#define PREFETCH_DELAY 500
+
+static gboolean on_prefetch_timeout(gpointer user_data);
+
+static void _fm_folder_prefetch_schedule(void)
+{
+    if(prefetch_handler == 0 && prefetch_folder == NULL && prefetch_queue.length > 0)
+        prefetch_handler = g_idle_add_full(G_PRIORITY_LOW, on_prefetch_timeout, NULL, NULL);
+}
+
+static void on_prefetch_finished(FmFolder* folder, gpointer user_data)
+{
+    g_signal_handlers_disconnect_by_func(folder, on_prefetch_finished, NULL);
+    prefetch_folder = NULL;
+    /* if nobody else uses it then it goes into the cache now */
+    g_object_unref(folder);
+    _fm_folder_prefetch_schedule();
+}
+
+/* returns TRUE if folder is in use or in the cache */
+static gboolean _fm_folder_is_known(FmPath* path)
+{
+    gboolean ret;
+
+    G_LOCK(hash);
+    ret = hash && g_hash_table_lookup(hash, path) != NULL;
+    G_UNLOCK(hash);
+    return ret;
+}
+
+/* returns TRUE if some folder is being loaded on behalf of user */
+static gboolean _fm_folder_is_busy(void)
+{
+    GHashTableIter it;
+    gpointer folder;
+    gboolean busy = FALSE;
+
+    G_LOCK(hash);
+    if(hash)
+    {
+        g_hash_table_iter_init(&it, hash);
+        while(!busy && g_hash_table_iter_next(&it, NULL, &folder))
+            busy = (FM_FOLDER(folder)->dirlist_job != NULL ||
+                    FM_FOLDER(folder)->snapshot_job != NULL ||
+                    FM_FOLDER(folder)->revalidate_job != NULL);
+    }
+    G_UNLOCK(hash);
+    return busy;
+}
+
+static gboolean on_prefetch_timeout(gpointer user_data)
+{
+    FmPath* path;
+    FmFolder* folder;
+    GFile* gf;
+
+    prefetch_handler = 0;
+    if(_fm_folder_is_busy())
+    {
+        /* don't compete with foreground loading, try again later */
+        prefetch_handler = g_timeout_add_full(G_PRIORITY_LOW, PREFETCH_DELAY,
+                                              on_prefetch_timeout, NULL, NULL);
+        return FALSE;
+    }
+    while((path = (FmPath*)g_queue_pop_head(&prefetch_queue)) != NULL)
+    {
+        if(!_fm_folder_is_known(path))
+            break;
+        fm_path_unref(path);
+    }
+    if(path == NULL)
+        return FALSE;
+    gf = fm_path_to_gfile(path);
+    /* incremental folders such as search results aren't cached anyway */
+    if(fm_file_wants_incremental(gf))
+    {
+        g_object_unref(gf);
+        fm_path_unref(path);
+        _fm_folder_prefetch_schedule();
+        return FALSE;
+    }
+    in_prefetch = TRUE;
+    folder = fm_folder_get_internal(path, gf);
+    in_prefetch = FALSE;
+    g_object_unref(gf);
+    fm_path_unref(path);
+    if(fm_folder_is_loaded(folder)) /* it was restored from snapshot */
+    {
+        g_object_unref(folder);
+        _fm_folder_prefetch_schedule();
+    }
+    else
+    {
+        prefetch_folder = folder;
+        g_signal_connect(folder, "finish-loading", G_CALLBACK(on_prefetch_finished), NULL);
+    }
+    return FALSE;
+}
+
+/* called when user requests a folder by @path: abort loading of prefetched
+   folder (unless it is the requested one) and put it back into the queue,
+   pending prefetches will be continued when user's folder is loaded */
+static void _fm_folder_prefetch_pause(FmPath* path)
+{
+    FmFolder* folder = prefetch_folder;
+    GList* l;
+
+    if(path)
+    {
+        for(l = prefetch_queue.head; l; l = l->next)
+            if(fm_path_equal(l->data, path))
+                break;
+        if(l)
+        {
+            fm_path_unref(l->data);
+            g_queue_delete_link(&prefetch_queue, l);
+        }
+    }
+    if(folder == NULL || (path && fm_path_equal(folder->dir_path, path)))
+        return;
+    g_signal_handlers_disconnect_by_func(folder, on_prefetch_finished, NULL);
+    prefetch_folder = NULL;
+    if(path)
+        g_queue_push_head(&prefetch_queue, fm_path_ref(folder->dir_path));
+    /* it is not loaded yet so it's disposed with its job if not used */
+    g_object_unref(folder);
+    _fm_folder_prefetch_schedule();
+}
+
+/**
+ * fm_folder_prefetch
+ * @path: path descriptor for the folder
+ *
+ * Hints that folder by @path will be likely opened soon. The folder is
+ * loaded in background with low priority when no other folder is being
+ * loaded and then kept in the cache of released folders so opening it
+ * later is instant. Prefetched folder is evicted from the cache before
+ * any folder actually opened by user. Loading of prefetched folder is aborted as soon as
+ * any other folder is requested and continued after that. Last hints
+ * are served first and only few last hints are kept. Does nothing if
+ * the cache of released folders is disabled.
+ *
+ * This API should be called from main thread only.
+ *
+ * Since: 1.3.0
+ */
+void fm_folder_prefetch(FmPath *path)
+{
+    GList *l;
+
+    g_return_if_fail(path != NULL);
+    if(fm_config->folder_cache_size <= 0)
+        return;
+    if(prefetch_folder && fm_path_equal(prefetch_folder->dir_path, path))
+        return;
+    if(_fm_folder_is_known(path))
+        return;
+    for(l = prefetch_queue.head; l; l = l->next)
+        if(fm_path_equal(l->data, path))
+            break;
+    if(l) /* already queued, just raise it */
+    {
+        g_queue_unlink(&prefetch_queue, l);
+        g_queue_push_head_link(&prefetch_queue, l);
+    }
+    else
+    {
+        g_queue_push_head(&prefetch_queue, fm_path_ref(path));
+        if(prefetch_queue.length > PREFETCH_QUEUE_SIZE)
+            fm_path_unref(g_queue_pop_tail(&prefetch_queue));
+    }
+    _fm_folder_prefetch_schedule();
 }
 
 /**
@@ -1529,13 +2439,21 @@ void fm_folder_block_updates(FmFolder *folder)
  */
 void fm_folder_unblock_updates(FmFolder *folder)
 {
+    gboolean dirty;
+
     /* g_debug("fm_folder_unblock_updates %p", folder); */
     G_LOCK(lists);
     folder->stop_emission = FALSE;
+    dirty = folder->dirty;
+    folder->dirty = FALSE;
+    folder->n_blocked_events = 0;
     /* query update now */
     if(!folder->idle_handler)
         folder->idle_handler = g_idle_add_full(G_PRIORITY_LOW, (GSourceFunc)on_idle, folder, NULL);
     G_UNLOCK(lists);
+    /* too many changes were collected, so they were dropped */
+    if(dirty)
+        _fm_folder_relist(folder);
     /* g_debug("fm_folder_unblock_updates OK"); */
 }
 
@@ -1679,10 +2597,41 @@ static void on_mount_removed(GVolumeMonitor* vm, GMount* mount, gpointer user_da
     }
 }
 
+/* hash_uses is the number of alive folders */
+void _fm_folder_get_stats(guint *n, guint *n_cached, gsize *cached_size)
+{
+    G_LOCK(hash);
+    *n = hash_uses;
+    *n_cached = retained_folders.length;
+    *cached_size = retained_memory;
+    G_UNLOCK(hash);
+}
+
 void _fm_folder_init()
 {
+    _fm_monitor_set_release_func(_fm_folder_release_monitors);
+    /* kept after finalize since running probes may still finish */
+    if(poll_hosts == NULL)
+        poll_hosts = g_hash_table_new(g_direct_hash, NULL);
 }
 
 void _fm_folder_finalize()
 {
+    GSList* evicted;
+
+    _fm_monitor_set_release_func(NULL);
+
+    /* drop all pending prefetches */
+    g_queue_foreach(&prefetch_queue, (GFunc)fm_path_unref, NULL);
+    g_queue_clear(&prefetch_queue);
+    _fm_folder_prefetch_pause(NULL);
+    if(prefetch_handler)
+        g_source_remove(prefetch_handler);
+    prefetch_handler = 0;
+
+    /* drop all folders from the cache */
+    G_LOCK(hash);
+    evicted = _fm_folder_cache_trim(0, 0);
+    G_UNLOCK(hash);
+    g_slist_free_full(evicted, g_object_unref);
 }
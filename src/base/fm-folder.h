@@ -92,6 +92,7 @@ FmFolder*   fm_folder_from_path_name(const char* path);
 FmFolder*   fm_folder_from_uri(const char* uri);
 
 FmFolder *fm_folder_find_by_path(FmPath *path);
+void fm_folder_prefetch(FmPath *path);
 void fm_folder_block_updates(FmFolder *folder);
 void fm_folder_unblock_updates(FmFolder *folder);
 
@@ -120,6 +121,7 @@ gboolean fm_folder_make_directory(FmFolder *folder, const char *name, GError **e
 
 void _fm_folder_init();
 void _fm_folder_finalize();
+void _fm_folder_get_stats(guint *n, guint *n_cached, gsize *cached_size);
 
 G_END_DECLS
 
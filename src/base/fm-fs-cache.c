@@ -0,0 +1,241 @@
+/*
+ *      fm-fs-cache.c
+ *
+ *      This file is a part of the Libfm library.
+ *
+ *      This library is free software; you can redistribute it and/or
+ *      modify it under the terms of the GNU Lesser General Public
+ *      License as published by the Free Software Foundation; either
+ *      version 2.1 of the License, or (at your option) any later version.
+ *
+ *      This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* Cache of properties which are the same for every file on a filesystem,
+ * such as the read-only flag, so they are queried once per filesystem and
+ * not once per directory. Native filesystems are identified by device
+ * number, other ones by the id::filesystem attribute; files without that
+ * attribute are not cached. GIO keeps only low 32 bits of the device
+ * number in unix::device so the same is used as the key for native files.
+ * The whole cache is dropped when the mount table changes, i.e. something
+ * is mounted, unmounted or remounted. Note that a read-only bind mount
+ * shares device number with its origin so it is not distinguished. */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "fm-fs-cache.h"
+
+#include <gio/gunixmounts.h>
+#include <string.h>
+
+#define FS_PROPS_ATTRIBS G_FILE_ATTRIBUTE_FILESYSTEM_READONLY","G_FILE_ATTRIBUTE_FILESYSTEM_TYPE
+
+/* types (as GIO names them) where access is checked by a remote side */
+static const char *remote_fs_types[] = {
+    "nfs", "smbfs", "smb2", "cifs", "ncp", "afs", "coda", "v9fs", "ceph",
+    "gfs/gfs2", "ocfs2", NULL
+};
+
+/* types which have no POSIX ACL support */
+static const char *no_acl_fs_types[] = {
+    "msdos", "isofs", "udf", "squashfs", "cramfs", "romfs", NULL
+};
+
+typedef struct
+{
+    guint64 dev; /* the key for dev_cache, full dev_t */
+    FmFsProps props;
+} FsEntry;
+
+G_LOCK_DEFINE_STATIC(fs_cache);
+static GHashTable *dev_cache = NULL; /* dev -> FsEntry */
+static GHashTable *id_cache = NULL; /* interned id::filesystem -> FsEntry */
+static guint cache_serial = 0;
+static GUnixMountMonitor *mount_monitor = NULL;
+
+static void on_mounts_changed(GUnixMountMonitor *mon, gpointer user_data)
+{
+    G_LOCK(fs_cache);
+    g_hash_table_remove_all(dev_cache);
+    g_hash_table_remove_all(id_cache);
+    cache_serial++;
+    G_UNLOCK(fs_cache);
+}
+
+void _fm_fs_cache_init(void)
+{
+    dev_cache = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, g_free);
+    id_cache = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+#if GLIB_CHECK_VERSION(2, 44, 0)
+    mount_monitor = g_unix_mount_monitor_get();
+#else
+    mount_monitor = g_unix_mount_monitor_new();
+#endif
+    g_signal_connect(mount_monitor, "mounts-changed", G_CALLBACK(on_mounts_changed), NULL);
+}
+
+void _fm_fs_cache_finalize(void)
+{
+    g_signal_handlers_disconnect_by_func(mount_monitor, on_mounts_changed, NULL);
+    g_object_unref(mount_monitor);
+    mount_monitor = NULL;
+    G_LOCK(fs_cache);
+    g_hash_table_destroy(dev_cache);
+    dev_cache = NULL;
+    g_hash_table_destroy(id_cache);
+    id_cache = NULL;
+    G_UNLOCK(fs_cache);
+}
+
+static gboolean _type_in_list(const char *type, const char **list)
+{
+    for (; *list; list++)
+        if (strcmp(type, *list) == 0)
+            return TRUE;
+    return FALSE;
+}
+
+static gboolean _query_props(GFile *gf, FmFsProps *props,
+                             GCancellable *cancellable, GError **error)
+{
+    GFileInfo *inf = g_file_query_filesystem_info(gf, FS_PROPS_ATTRIBS,
+                                                  cancellable, error);
+
+    if (inf == NULL)
+        return FALSE;
+    /* default is R/W */
+    props->readonly = g_file_info_get_attribute_boolean(inf, G_FILE_ATTRIBUTE_FILESYSTEM_READONLY);
+    props->type = g_intern_string(g_file_info_get_attribute_string(inf, G_FILE_ATTRIBUTE_FILESYSTEM_TYPE));
+    g_object_unref(inf);
+    /* FUSE filesystems may ignore mode bits, unknown ones are suspicious */
+    props->remote = (props->type == NULL || g_str_has_prefix(props->type, "fuse") ||
+                     _type_in_list(props->type, remote_fs_types));
+    props->no_acl = (props->type != NULL && _type_in_list(props->type, no_acl_fs_types));
+    return TRUE;
+}
+
+/* if key is NULL then looks up dev_cache by dev, otherwise id_cache */
+static gboolean _cache_lookup(guint64 dev, const char *key, FmFsProps *props,
+                              guint *serial)
+{
+    FsEntry *entry = NULL;
+
+    G_LOCK(fs_cache);
+    if (key)
+    {
+        if (id_cache)
+            entry = g_hash_table_lookup(id_cache, key);
+    }
+    else if (dev_cache)
+        entry = g_hash_table_lookup(dev_cache, &dev);
+    if (entry)
+        *props = entry->props;
+    *serial = cache_serial;
+    G_UNLOCK(fs_cache);
+    return (entry != NULL);
+}
+
+static void _cache_add(guint64 dev, const char *key, FmFsProps *props, guint serial)
+{
+    FsEntry *entry;
+
+    G_LOCK(fs_cache);
+    /* don't add stale data if mounts were changed while we queried */
+    if (dev_cache && serial == cache_serial)
+    {
+        entry = g_new(FsEntry, 1);
+        entry->dev = dev;
+        entry->props = *props;
+        /* replace key as well since old one is freed with old entry */
+        if (key)
+            g_hash_table_replace(id_cache, (gpointer)key, entry);
+        else
+            g_hash_table_replace(dev_cache, &entry->dev, entry);
+    }
+    G_UNLOCK(fs_cache);
+}
+
+/* key is NULL for native files looked up by dev */
+static gboolean _cache_get(guint64 dev, const char *key, GFile *gf, FmFsProps *props,
+                           GCancellable *cancellable, GError **error)
+{
+    guint serial;
+
+    if (_cache_lookup(dev, key, props, &serial))
+        return TRUE;
+    if (!_query_props(gf, props, cancellable, error))
+        return FALSE; /* don't cache failures, they may be temporary */
+    _cache_add(dev, key, props, serial);
+    return TRUE;
+}
+
+gboolean _fm_fs_cache_get_for_dev(dev_t dev, const char *path, FmFsProps *props)
+{
+    GFile *gf;
+    guint serial;
+    gboolean ok;
+
+    /* don't create GFile unless it's really needed */
+    if (_cache_lookup((guint64)dev, NULL, props, &serial))
+        return TRUE;
+    gf = g_file_new_for_path(path);
+    ok = _query_props(gf, props, NULL, NULL);
+    g_object_unref(gf);
+    if (ok)
+        _cache_add((guint64)dev, NULL, props, serial);
+    return ok;
+}
+
+void _fm_fs_cache_set_no_acl(dev_t dev)
+{
+    guint64 key = dev;
+    FsEntry *entry;
+
+    G_LOCK(fs_cache);
+    if (dev_cache && (entry = g_hash_table_lookup(dev_cache, &key)) != NULL)
+        entry->props.no_acl = TRUE;
+    G_UNLOCK(fs_cache);
+}
+
+gboolean _fm_fs_cache_get_for_gfile(GFile *gf, GFileInfo *inf, FmFsProps *props,
+                                    GCancellable *cancellable, GError **error)
+{
+    const char *fs_id;
+    char *end;
+    guint64 dev;
+
+    fs_id = g_file_info_get_attribute_string(inf, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
+    if (fs_id == NULL)
+        return _query_props(gf, props, cancellable, error);
+    /* GIO makes it "l<dev>" for local files, with full dev_t unlike
+       unix::device which is 32-bit, so it may share entry with
+       _fm_fs_cache_get_for_dev() */
+    if (fs_id[0] == 'l' && g_file_is_native(gf))
+    {
+        dev = g_ascii_strtoull(&fs_id[1], &end, 10);
+        if (end != &fs_id[1] && *end == '\0')
+            return _cache_get(dev, NULL, gf, props, cancellable, error);
+    }
+    return _cache_get(0, g_intern_string(fs_id), gf, props, cancellable, error);
+}
+
+gboolean _fm_fs_cache_set_readonly_attr(GFile *gf, GFileInfo *inf,
+                                        GCancellable *cancellable, GError **error)
+{
+    FmFsProps props;
+
+    if (!_fm_fs_cache_get_for_gfile(gf, inf, &props, cancellable, error))
+        return FALSE;
+    g_file_info_set_attribute_boolean(inf, G_FILE_ATTRIBUTE_FILESYSTEM_READONLY,
+                                      props.readonly);
+    return TRUE;
+}
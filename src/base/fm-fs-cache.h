@@ -0,0 +1,57 @@
+/*
+ *      fm-fs-cache.h
+ *
+ *      This file is a part of the Libfm library.
+ *
+ *      This library is free software; you can redistribute it and/or
+ *      modify it under the terms of the GNU Lesser General Public
+ *      License as published by the Free Software Foundation; either
+ *      version 2.1 of the License, or (at your option) any later version.
+ *
+ *      This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* This header is internal for libfm and is not installed. */
+
+#ifndef __FM_FS_CACHE_H__
+#define __FM_FS_CACHE_H__
+
+#include <gio/gio.h>
+#include <sys/types.h>
+
+G_BEGIN_DECLS
+
+typedef struct
+{
+    gboolean readonly;
+    const char *type; /* interned string, may be NULL */
+    guint remote : 1; /* permissions are decided by server, or type unknown */
+    guint no_acl : 1; /* mode bits are the only permissions */
+} FmFsProps;
+
+void _fm_fs_cache_init(void);
+void _fm_fs_cache_finalize(void);
+
+/* both return FALSE if properties could not be retrieved */
+gboolean _fm_fs_cache_get_for_dev(dev_t dev, const char *path, FmFsProps *props);
+/* remembers that filesystem on dev doesn't support POSIX ACL */
+void _fm_fs_cache_set_no_acl(dev_t dev);
+/* uses id::filesystem from inf as the key */
+gboolean _fm_fs_cache_get_for_gfile(GFile *gf, GFileInfo *inf, FmFsProps *props,
+                                    GCancellable *cancellable, GError **error);
+
+/* sets filesystem::readonly in inf, for jobs in place of
+   _fm_file_info_job_update_fs_readonly() which queries it each time */
+gboolean _fm_fs_cache_set_readonly_attr(GFile *gf, GFileInfo *inf,
+                                        GCancellable *cancellable, GError **error);
+
+G_END_DECLS
+
+#endif /* __FM_FS_CACHE_H__ */
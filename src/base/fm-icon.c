@@ -57,6 +57,17 @@ void _fm_icon_finalize()
     hash = NULL;
 }
 
+/* icons are never freed so all of them are in the hash table */
+guint _fm_icon_get_count(void)
+{
+    guint n;
+
+    G_LOCK(hash);
+    n = hash ? g_hash_table_size(hash) : 0;
+    G_UNLOCK(hash);
+    return n;
+}
+
 /**
  * fm_icon_from_gicon
  * @gicon: a #GIcon object
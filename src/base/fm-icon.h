@@ -41,6 +41,7 @@ typedef struct _FmIcon			FmIcon;
 /* must be called before using FmIcon */
 void _fm_icon_init();
 void _fm_icon_finalize();
+guint _fm_icon_get_count(void);
 
 FmIcon* fm_icon_from_gicon(GIcon* gicon);
 FmIcon* fm_icon_from_name(const char* name);
@@ -29,26 +29,85 @@
  *
  * This implementation can help to exclude creation of duplicate monitors
  * for the same file and also do fast search for created file monitors.
+ *
+ * Each monitor of native directory takes a kernel watch (inotify) and the
+ * number of watches is limited per user. Monitors are counted and if this
+ * process uses more than its share of the limit then monitors which were
+ * marked as releasable (ones of cached folders first, then ones of folders
+ * in background which are polled after that) are dropped before a new
+ * monitor is created. It is tried at most once in a few seconds.
  */
 
 #include "fm-monitor.h"
 #include "fm-dummy-monitor.h"
 #include <string.h>
+#include <stdlib.h>
 
 #define MONITOR_RATE_LIMIT 5000
 
+/* budget of native monitors if inotify limit is unknown */
+#define WATCH_BUDGET_DEFAULT 2048
+/* share of the per-user inotify limit this process may use */
+#define WATCH_BUDGET_SHARE 4
+/* release at least that many monitors at once to not do it every time */
+#define WATCH_RELEASE_BATCH 16
+/* don't try to release monitors more often than once per that, in us */
+#define WATCH_RELEASE_INTERVAL (2 * G_USEC_PER_SEC)
+
 static GHashTable* hash = NULL;
 static GHashTable* dummy_hash = NULL;
 G_LOCK_DEFINE_STATIC(hash);
 
+static guint n_watches = 0; /* native monitors in hash */
+static guint watch_budget = WATCH_BUDGET_DEFAULT;
+static FmMonitorReleaseFunc release_func = NULL;
+static gint64 last_release = 0; /* time of last release attempt */
+static gboolean budget_logged = FALSE;
+
 static void on_monitor_destroy(gpointer data, GObject* mon)
 {
     GFile* gf = (GFile*)data;
     G_LOCK(hash);
+    /* gf may be destroyed by removing from hash */
+    if(g_file_is_native(gf))
+        n_watches--;
     g_hash_table_remove(hash, gf);
     G_UNLOCK(hash);
 }
 
+/* if this process uses too many kernel watches then try to free some */
+static void _fm_monitor_check_budget(void)
+{
+    guint over, released;
+    gint64 now;
+    gboolean log;
+
+    if(release_func == NULL)
+        return;
+    now = g_get_monotonic_time();
+    G_LOCK(hash);
+    over = (n_watches >= watch_budget) ? (n_watches - watch_budget + 1) : 0;
+    /* release walks all the folders and may find nothing to release, so
+       don't repeat it for each new monitor, just go over budget */
+    if(over > 0 && last_release != 0 && now - last_release < WATCH_RELEASE_INTERVAL)
+        over = 0;
+    if(over > 0)
+        last_release = now;
+    G_UNLOCK(hash);
+    if(over == 0)
+        return;
+    released = release_func(MAX(over, WATCH_RELEASE_BATCH));
+    G_LOCK(hash);
+    log = !budget_logged;
+    budget_logged = TRUE;
+    G_UNLOCK(hash);
+    if(log)
+        g_message("libfm: budget of %u directory monitors is exhausted, "
+                  "%u released, some folders will be polled", watch_budget, released);
+    else
+        g_debug("monitors budget %u is exhausted, released %u", watch_budget, released);
+}
+
 static void on_dummy_monitor_destroy(gpointer data, GObject* mon)
 {
     GFile* gf = (GFile*)data;
@@ -72,9 +131,13 @@ static void on_dummy_monitor_destroy(gpointer data, GObject* mon)
 GFileMonitor* fm_monitor_directory(GFile* gf, GError** err)
 {
     GFileMonitor* ret = NULL;
+    gboolean is_native = g_file_is_native(gf);
+
+    if(is_native)
+        _fm_monitor_check_budget();
     G_LOCK(hash);
     ret = (GFileMonitor*)g_hash_table_lookup(hash, gf);
-    if(!ret && !g_file_is_native(gf))
+    if(!ret && !is_native)
         ret = (GFileMonitor*)g_hash_table_lookup(dummy_hash, gf);
     if(ret)
         g_object_ref(ret);
@@ -87,6 +150,8 @@ GFileMonitor* fm_monitor_directory(GFile* gf, GError** err)
             g_object_weak_ref(G_OBJECT(ret), on_monitor_destroy, gf);
             g_file_monitor_set_rate_limit(ret, MONITOR_RATE_LIMIT);
             g_hash_table_insert(hash, g_object_ref(gf), ret);
+            if(is_native)
+                n_watches++;
         }
         else
         {
@@ -119,8 +184,26 @@ GFileMonitor* fm_monitor_directory(GFile* gf, GError** err)
 
 void _fm_monitor_init()
 {
+    char* contents;
+
     hash = g_hash_table_new_full(g_file_hash, (GEqualFunc)g_file_equal, g_object_unref, NULL);
     dummy_hash = g_hash_table_new_full(g_file_hash, (GEqualFunc)g_file_equal, g_object_unref, NULL);
+    /* the limit is per user so leave the most of it for other processes */
+    if(g_file_get_contents("/proc/sys/fs/inotify/max_user_watches", &contents, NULL, NULL))
+    {
+        guint max = strtoul(contents, NULL, 10);
+        if(max > 0)
+            watch_budget = MAX(max / WATCH_BUDGET_SHARE, WATCH_RELEASE_BATCH * 2);
+        g_free(contents);
+    }
+}
+
+/* sets function which is called to release some monitors when the budget
+   of monitors is exhausted, the function returns the number of released
+   monitors */
+void _fm_monitor_set_release_func(FmMonitorReleaseFunc func)
+{
+    release_func = func;
 }
 
 void _fm_monitor_finalize()
@@ -34,6 +34,9 @@ GFileMonitor* fm_monitor_directory(GFile* gf, GError** err);
 void _fm_monitor_init();
 void _fm_monitor_finalize();
 
+typedef guint (*FmMonitorReleaseFunc)(guint n_wanted);
+void _fm_monitor_set_release_func(FmMonitorReleaseFunc func);
+
 GFileMonitor* fm_monitor_lookup_monitor(GFile* gf);
 GFileMonitor* fm_monitor_lookup_dummy_monitor(GFile* gf);
 
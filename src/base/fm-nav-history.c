@@ -33,6 +33,7 @@
  */
 
 #include "fm-nav-history.h"
+#include "fm-folder.h"
 
 struct _FmNavHistory
 {
@@ -49,6 +50,7 @@ struct _FmNavHistoryClass
 };
 
 static void fm_nav_history_finalize (GObject *object);
+static void prefetch_neighbours(FmNavHistory* nh);
 
 G_DEFINE_TYPE(FmNavHistory, fm_nav_history, G_TYPE_OBJECT);
 
@@ -196,6 +198,7 @@ void fm_nav_history_forward(FmNavHistory* nh, int old_scroll_pos)
             tmp->scroll_pos = old_scroll_pos;
         nh->cur = nh->cur->prev;
         nh->n_cur--;
+        prefetch_neighbours(nh);
     }
 }
 
@@ -239,9 +242,30 @@ void fm_nav_history_back(FmNavHistory* nh, int old_scroll_pos)
             tmp->scroll_pos = old_scroll_pos;
         nh->cur = nh->cur->next;
         nh->n_cur++;
+        prefetch_neighbours(nh);
     }
 }
 
+static inline void prefetch_path(FmPath* path)
+{
+    /* remote folders cost traffic and may even ask for password */
+    if(path && fm_path_is_native(path))
+        fm_folder_prefetch(path);
+}
+
+/* hint folders which user will likely go next from the current one */
+static void prefetch_neighbours(FmNavHistory* nh)
+{
+    if(nh->cur == NULL)
+        return;
+    prefetch_path(fm_path_get_parent(((FmNavHistoryItem*)nh->cur->data)->path));
+    /* last hint is served first so 'Back' goes last */
+    if(nh->cur->prev)
+        prefetch_path(((FmNavHistoryItem*)nh->cur->prev->data)->path);
+    if(nh->cur->next)
+        prefetch_path(((FmNavHistoryItem*)nh->cur->next->data)->path);
+}
+
 static inline void cut_history(FmNavHistory* nh, guint num)
 {
     while(g_queue_get_length(&nh->items) > num)
@@ -290,6 +314,7 @@ void fm_nav_history_chdir(FmNavHistory* nh, FmPath* path, gint old_scroll_pos)
         g_queue_push_head(&nh->items, tmp);
         nh->cur = g_queue_peek_head_link(&nh->items);
         cut_history(nh, nh->n_max);
+        prefetch_neighbours(nh);
     }
 }
 
@@ -423,6 +448,7 @@ FmPath* fm_nav_history_go_to(FmNavHistory* nh, guint n, gint old_scroll_pos)
         return NULL;
     nh->n_cur = n;
     nh->cur = link;
+    prefetch_neighbours(nh);
     return ((FmNavHistoryItem*)link->data)->path;
 }
 
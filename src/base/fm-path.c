@@ -84,10 +84,16 @@ static GSList* roots = NULL;
    members of FmPath struct: disp_name, iter, children */
 G_LOCK_DEFINE_STATIC(roots);
 
+/* statistics for fm_get_memory_stats() */
+static volatile gint n_paths = 0;
+static volatile gint paths_size = 0;
+
 static FmPath* _fm_path_alloc(FmPath* parent, int name_len, int flags)
 {
     FmPath* path;
     path = (FmPath*)g_malloc(sizeof(FmPath) + name_len);
+    g_atomic_int_inc(&n_paths);
+    g_atomic_int_add(&paths_size, sizeof(FmPath) + name_len);
     path->n_ref = 1;
     path->flags = flags;
     path->parent = parent ? fm_path_ref(parent) : NULL;
@@ -817,6 +823,8 @@ void fm_path_unref(FmPath* path)
             g_assert(g_sequence_get_length(path->children) == 0);
             g_sequence_free(path->children);
         }
+        g_atomic_int_add(&paths_size, -(gint)(sizeof(FmPath) + strlen(path->name)));
+        g_atomic_int_add(&n_paths, -1);
         g_free(path);
     }
 }
@@ -1327,6 +1335,12 @@ void _fm_path_finalize(void)
     root_path = home_path = desktop_path = trash_root_path = apps_root_path = NULL;
 }
 
+void _fm_path_get_stats(guint *n, gsize *size)
+{
+    *n = g_atomic_int_get(&n_paths);
+    *size = g_atomic_int_get(&paths_size);
+}
+
 /* For used in hash tables */
 
 /**
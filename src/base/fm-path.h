@@ -72,6 +72,7 @@ typedef struct _FmFileInfoList FmFileInfoList; /* fm-file-info.h includes this t
 
 void _fm_path_init(void);
 void _fm_path_finalize(void);
+void _fm_path_get_stats(guint *n, gsize *size);
 
 FmPath* fm_path_new_for_path(const char* path_name);
 FmPath* fm_path_new_for_uri(const char* uri);
@@ -1097,7 +1097,7 @@ _create_empty_file:
     }
     else
     {
-        app = g_app_info_get_default_for_type(fm_mime_type_get_type(templ->mime_type), FALSE);
+        app = fm_app_info_get_default_for_type(fm_mime_type_get_type(templ->mime_type));
         if(!app && error)
             g_set_error(error, G_IO_ERROR, G_IO_ERROR_FAILED,
                         _("No default application is set for MIME type %s"),
@@ -41,6 +41,7 @@
 
 #include "fm-config.h"
 #include "fm-utils.h"
+#include "fm-trace.h"
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -103,6 +104,7 @@ struct _ThumbnailCacheItem
 {
     guint size;
     GObject* pix; /* no reference on it */
+    gsize mem_size; /* estimated */
 };
 
 typedef struct _ThumbnailCache ThumbnailCache;
@@ -141,6 +143,11 @@ static GHashTable* hash = NULL;
 
 static char* thumb_dir = NULL;
 
+/* statistics for fm_get_memory_stats() */
+static volatile gint n_requests = 0;
+static guint n_cached = 0; /* protected by queue lock */
+static gsize cached_size = 0;
+
 static guint thumbnailer_timeout_id = 0;
 
 static gpointer load_thumbnail_thread(gpointer user_data);
@@ -158,6 +165,7 @@ static void fm_thumbnail_loader_free(FmThumbnailLoader* req)
     if(req->pix)
         g_object_unref(req->pix);
     g_slice_free(FmThumbnailLoader, req);
+    g_atomic_int_add(&n_requests, -1);
 }
 
 /* in main loop */
@@ -169,6 +177,7 @@ static gboolean on_ready_idle(gpointer user_data)
     while((req = (FmThumbnailLoader*)g_queue_pop_head(&ready_queue)) != NULL)
     {
         g_mutex_unlock(lock_ptr);
+        FM_TRACE1(thumbnail__ready, req);
         if(!req->cancelled)
             req->callback(req, req->user_data);
         fm_thumbnail_loader_free(req);
@@ -225,6 +234,8 @@ static void on_pixbuf_destroy(gpointer data, GObject* obj_ptr)
         if(item->pix == pix)
         {
             cache->items = g_slist_delete_link(cache->items, l);
+            n_cached--;
+            cached_size -= item->mem_size;
             g_slice_free(ThumbnailCacheItem, item);
             if(!cache->items)
             {
@@ -267,6 +278,9 @@ inline static void cache_thumbnail_in_hash(FmPath* path, GObject* pix, guint siz
         item = g_slice_new(ThumbnailCacheItem);
         item->size = size;
         item->pix = pix;
+        item->mem_size = (gsize)backend.get_image_width(pix) * backend.get_image_height(pix) * 4;
+        n_cached++;
+        cached_size += item->mem_size;
         cache->items = g_slist_prepend(cache->items, item);
         g_object_weak_ref(G_OBJECT(pix), on_pixbuf_destroy, cache);
     }
@@ -377,6 +391,8 @@ static void load_thumbnails(ThumbnailTask* task)
     const char* normal_path = task->normal_path;
     const char* large_path = task->large_path;
 
+    FM_TRACE2(thumbnail__load, task, task->uri);
+
     if( g_cancellable_is_cancelled(task->cancellable) )
         goto _out;
 
@@ -587,6 +603,7 @@ FmThumbnailLoader* fm_thumbnail_loader_load(FmFileInfo* src_file,
     g_return_val_if_fail(hash != NULL, NULL);
     g_assert(callback != NULL);
     req = g_slice_new(FmThumbnailLoader);
+    g_atomic_int_inc(&n_requests);
     req->fi = fm_file_info_ref(src_file);
     req->size = size;
     req->callback = callback;
@@ -597,6 +614,7 @@ FmThumbnailLoader* fm_thumbnail_loader_load(FmFileInfo* src_file,
     req->cancelled = FALSE;
 
     DEBUG("request thumbnail: %s", fm_path_get_basename(src_path));
+    FM_TRACE2(thumbnail__queue, req, fm_path_get_basename(src_path));
 
     g_mutex_lock(lock_ptr);
 
@@ -768,6 +786,21 @@ static gboolean fm_thumbnail_loader_cleanup(gpointer unused)
     return FALSE;
 }
 
+void _fm_thumbnail_loader_get_stats(guint *n_req, guint *n, gsize *size)
+{
+    *n_req = g_atomic_int_get(&n_requests);
+    if (hash == NULL) /* not initialized or already finalized */
+    {
+        *n = 0;
+        *size = 0;
+        return;
+    }
+    g_mutex_lock(lock_ptr);
+    *n = n_cached;
+    *size = cached_size;
+    g_mutex_unlock(lock_ptr);
+}
+
 /* in main loop */
 void _fm_thumbnail_loader_finalize(void)
 {
@@ -804,6 +837,7 @@ void _fm_thumbnail_loader_finalize(void)
 /* in thread */
 static void generate_thumbnails(ThumbnailTask* task)
 {
+    FM_TRACE2(thumbnail__generate, task, task->uri);
     if (fm_file_info_is_image(task->fi) &&
         /* if the image file is too large, don't generate thumbnail for it. */
         (fm_config->thumbnail_max == 0 ||
@@ -54,6 +54,8 @@ void _fm_thumbnail_loader_init();
 
 void _fm_thumbnail_loader_finalize();
 
+void _fm_thumbnail_loader_get_stats(guint *n_req, guint *n, gsize *size);
+
 FmThumbnailLoader* fm_thumbnail_loader_load(FmFileInfo* src_file,
                                             guint size,
                                             FmThumbnailLoaderCallback callback,
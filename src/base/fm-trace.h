@@ -0,0 +1,66 @@
+/*
+ *      fm-trace.h
+ *
+ *      This file is a part of the Libfm library.
+ *
+ *      This library is free software; you can redistribute it and/or
+ *      modify it under the terms of the GNU Lesser General Public
+ *      License as published by the Free Software Foundation; either
+ *      version 2.1 of the License, or (at your option) any later version.
+ *
+ *      This library is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *      Lesser General Public License for more details.
+ *
+ *      You should have received a copy of the GNU Lesser General Public
+ *      License along with this library; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* This header is internal for libfm and is not installed. */
+
+/* Static tracepoints (USDT probes) of provider "libfm". Each probe is a
+ * single nop instruction until a tracer such as perf, bpftrace or stap
+ * attaches to it, for example:
+ *   bpftrace -e 'usdt:/usr/lib/libfm.so.4:libfm:job__finish { ... }'
+ * Probes are compiled in only if configure found sys/sdt.h, otherwise
+ * the macros expand to nothing and their arguments are not evaluated.
+ *
+ * Probes defined:
+ *   job__queue(job, type_name)         job is sent to the thread pool
+ *   job__start(job)                    job started in working thread
+ *   job__done(job, cancelled)          job run() returned
+ *   job__finish(job, cancelled)        "finished" is emitted in main thread
+ *   main__call__enqueue(func)          thread waits for main thread call
+ *   main__call__dispatch(func)         main thread runs the call
+ *   main__call__return(func)           waiting thread got the result
+ *   folder__load__start(folder, name)  folder listing is started
+ *   folder__load__snapshot(folder, n)  folder filled from snapshot
+ *   folder__load__batch(job, n)        batch of files read by listing job
+ *   folder__load__finish(folder, n)    folder listing is complete
+ *   folder__revalidate(folder, name)   changed folder is listed again
+ *   thumbnail__queue(req, name)        thumbnail is requested
+ *   thumbnail__load(task, name)        thumbnail loading is started
+ *   thumbnail__generate(task, name)    thumbnail generation is started
+ *   thumbnail__ready(req)              thumbnail callback is called */
+
+#ifndef __FM_TRACE_H__
+#define __FM_TRACE_H__
+
+#ifdef ENABLE_TRACEPOINTS
+#include <sys/sdt.h>
+
+#define FM_TRACE(name)                  DTRACE_PROBE(libfm, name)
+#define FM_TRACE1(name, a1)             DTRACE_PROBE1(libfm, name, a1)
+#define FM_TRACE2(name, a1, a2)         DTRACE_PROBE2(libfm, name, a1, a2)
+
+#else
+
+#define FM_TRACE(name)                  G_STMT_START {} G_STMT_END
+#define FM_TRACE1(name, a1)             G_STMT_START {} G_STMT_END
+#define FM_TRACE2(name, a1, a2)         G_STMT_START {} G_STMT_END
+
+#endif
+
+#endif /* __FM_TRACE_H__ */
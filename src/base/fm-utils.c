@@ -45,6 +45,7 @@
 #include "fm-utils.h"
 #include "fm-file-info-job.h"
 #include "fm-config.h"
+#include "fm-trace.h"
 
 #define BI_KiB  ((gdouble)1024.0)
 #define BI_MiB  ((gdouble)1024.0 * 1024.0)
@@ -461,6 +462,7 @@ typedef struct
 static gboolean _fm_run_in_default_main_context_real(gpointer user_data)
 {
     _main_context_data *data = user_data;
+    FM_TRACE1(main__call__dispatch, data->func);
     data->result = data->func(data->data);
 #if GLIB_CHECK_VERSION(2, 32, 0)
     g_mutex_lock(&main_loop_run_mutex);
@@ -491,6 +493,7 @@ gboolean fm_run_in_default_main_context(GSourceFunc func, gpointer data)
 {
     _main_context_data md;
 
+    FM_TRACE1(main__call__enqueue, func);
 #if GLIB_CHECK_VERSION(2, 32, 0)
     md.done = FALSE;
     md.func = func;
@@ -529,6 +532,7 @@ gboolean fm_run_in_default_main_context(GSourceFunc func, gpointer data)
         g_mutex_unlock(main_loop_run_mutex);
     }
 #endif
+    FM_TRACE1(main__call__return, func);
     return md.result;
 }
 
@@ -31,6 +31,35 @@
 #include "fm-gtk.h"
 
 static volatile gint gtk_initialized = 0;
+static guint stats_handler = 0;
+
+/**
+ * fm_gtk_get_memory_stats
+ * @stats: (out): location to save statistics
+ *
+ * Retrieves the same data as fm_get_memory_stats() does, and also
+ * numbers and sizes of libfm-gtk caches. This API should be called
+ * from main thread only.
+ *
+ * Since: 1.3.0
+ */
+void fm_gtk_get_memory_stats(FmMemoryStats *stats)
+{
+    g_return_if_fail(stats != NULL);
+
+    fm_get_memory_stats(stats);
+    _fm_icon_pixbuf_get_stats(&stats->n_icon_pixbufs, &stats->icon_pixbufs_size);
+}
+
+static gboolean on_dump_stats(gpointer user_data)
+{
+    FmMemoryStats stats;
+
+    fm_gtk_get_memory_stats(&stats);
+    g_message("libfm-gtk: %u icon images (%" G_GSIZE_FORMAT " KB)",
+              stats.n_icon_pixbufs, stats.icon_pixbufs_size / 1024);
+    return TRUE;
+}
 
 /**
  * fm_gtk_init
@@ -64,6 +93,8 @@ gboolean fm_gtk_init(FmConfig* config)
     _fm_folder_view_init();
     _fm_file_menu_init();
 
+    stats_handler = fm_add_stats_timeout(on_dump_stats);
+
     return TRUE;
 }
 
@@ -82,6 +113,12 @@ void fm_gtk_finalize(void)
     if (!g_atomic_int_dec_and_test(&gtk_initialized))
         return;
 
+    if (stats_handler)
+    {
+        g_source_remove(stats_handler);
+        stats_handler = 0;
+    }
+
     _fm_icon_pixbuf_finalize();
     _fm_thumbnail_finalize();
     _fm_file_properties_finalize();
@@ -58,6 +58,8 @@ G_BEGIN_DECLS
 gboolean fm_gtk_init(FmConfig* config);
 void fm_gtk_finalize();
 
+void fm_gtk_get_memory_stats(FmMemoryStats *stats);
+
 G_END_DECLS
 
 #endif
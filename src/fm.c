@@ -33,6 +33,8 @@
 #include <config.h>
 #endif
 #include <glib/gi18n-lib.h>
+#include <stdlib.h>
+#include <string.h>
 #include "fm.h"
 
 #ifdef HAVE_ACTIONS
@@ -60,6 +62,63 @@ const char *fm_version(void)
 }
 
 static volatile gint init_done = 0;
+static guint stats_handler = 0;
+
+/**
+ * fm_get_memory_stats
+ * @stats: (out): location to save statistics
+ *
+ * Retrieves numbers of alive objects and estimated sizes of caches of
+ * the library. Counters are cheap so they are always maintained. Use
+ * fm_gtk_get_memory_stats() to get statistics of libfm-gtk caches too.
+ *
+ * If LIBFM_STATS_INTERVAL environment variable is set to some number
+ * of seconds then statistics are also written to the log periodically.
+ *
+ * Since: 1.3.0
+ */
+void fm_get_memory_stats(FmMemoryStats *stats)
+{
+    g_return_if_fail(stats != NULL);
+
+    memset(stats, 0, sizeof(FmMemoryStats));
+    _fm_path_get_stats(&stats->n_paths, &stats->paths_size);
+    stats->n_file_infos = _fm_file_info_get_count();
+    _fm_folder_get_stats(&stats->n_folders, &stats->n_cached_folders,
+                         &stats->cached_folders_size);
+    stats->n_icons = _fm_icon_get_count();
+    _fm_thumbnail_loader_get_stats(&stats->n_thumbnail_requests,
+                                   &stats->n_thumbnails, &stats->thumbnails_size);
+}
+
+static gboolean on_dump_stats(gpointer user_data)
+{
+    FmMemoryStats stats;
+
+    fm_get_memory_stats(&stats);
+    g_message("libfm: %u paths (%" G_GSIZE_FORMAT " KB), %u file infos, "
+              "%u folders (%u cached, %" G_GSIZE_FORMAT " KB), %u icons, "
+              "%u thumbnail requests, %u thumbnails (%" G_GSIZE_FORMAT " KB)",
+              stats.n_paths, stats.paths_size / 1024, stats.n_file_infos,
+              stats.n_folders, stats.n_cached_folders,
+              stats.cached_folders_size / 1024, stats.n_icons,
+              stats.n_thumbnail_requests, stats.n_thumbnails,
+              stats.thumbnails_size / 1024);
+    return TRUE;
+}
+
+/* used by libfm-gtk too, so it's exported but isn't a public API:
+   adds a timeout to dump statistics every LIBFM_STATS_INTERVAL seconds
+   (see fm_get_memory_stats()), returns 0 if the variable isn't set */
+guint fm_add_stats_timeout(GSourceFunc func)
+{
+    const char *env = g_getenv("LIBFM_STATS_INTERVAL");
+    int interval = env ? atoi(env) : 0;
+
+    if (interval <= 0)
+        return 0;
+    return g_timeout_add_seconds(interval, func, NULL);
+}
 
 /**
  * fm_init
@@ -130,6 +189,8 @@ gboolean fm_init(FmConfig* config)
 
     fm_qdata_id = g_quark_from_static_string("fm_qdata_id");
 
+    stats_handler = fm_add_stats_timeout(on_dump_stats);
+
     return TRUE;
 }
 
@@ -148,11 +209,18 @@ void fm_finalize(void)
     if (!g_atomic_int_dec_and_test(&init_done))
         return;
 
+    if (stats_handler)
+    {
+        g_source_remove(stats_handler);
+        stats_handler = 0;
+    }
+
 #ifdef HAVE_ACTIONS
 	/* generated by vala */
     _fm_file_actions_finalize();
 #endif
     _fm_folder_config_finalize();
+    _fm_app_info_finalize();
     _fm_templates_finalize();
     _fm_terminal_finalize();
     _fm_thumbnail_loader_finalize();
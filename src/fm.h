@@ -61,11 +61,58 @@
 
 G_BEGIN_DECLS
 
+typedef struct _FmMemoryStats FmMemoryStats;
+
+/**
+ * FmMemoryStats:
+ * @n_paths: number of #FmPath objects alive
+ * @paths_size: estimated memory used by the paths tree, in bytes
+ * @n_file_infos: number of #FmFileInfo objects alive
+ * @n_folders: number of #FmFolder objects alive, including cached ones
+ * @n_cached_folders: number of released folders kept in cache
+ * @cached_folders_size: estimated memory used by cached folders, in bytes
+ * @n_icons: number of #FmIcon objects alive
+ * @n_thumbnail_requests: number of #FmThumbnailLoader requests alive
+ * @n_thumbnails: number of loaded thumbnails known to the loader cache
+ * @thumbnails_size: estimated memory used by the thumbnails, in bytes
+ * @n_icon_pixbufs: number of icon images in cache, only set by libfm-gtk
+ * @icon_pixbufs_size: memory used by icon images cache, only set by libfm-gtk
+ *
+ * Counters of alive objects and sizes of caches. See fm_get_memory_stats().
+ *
+ * Since: 1.3.0
+ */
+struct _FmMemoryStats
+{
+    guint n_paths;
+    gsize paths_size;
+    guint n_file_infos;
+    guint n_folders;
+    guint n_cached_folders;
+    gsize cached_folders_size;
+    guint n_icons;
+    guint n_thumbnail_requests;
+    guint n_thumbnails;
+    gsize thumbnails_size;
+    guint n_icon_pixbufs;
+    gsize icon_pixbufs_size;
+    /*< private >*/
+    gpointer _reserved1;
+    gpointer _reserved2;
+    gpointer _reserved3;
+    gpointer _reserved4;
+};
+
 gboolean fm_init(FmConfig* config);
 void fm_finalize();
 
 const char *fm_version(void);
 
+void fm_get_memory_stats(FmMemoryStats *stats);
+
+/* for libfm-gtk only */
+guint fm_add_stats_timeout(GSourceFunc func);
+
 extern GQuark fm_qdata_id; /* a quark value used to associate data with objects */
 
 G_END_DECLS
@@ -33,6 +33,53 @@
 
 #include "fm-cell-renderer-text.h"
 
+#include <string.h>
+
+/* Measuring text requires shaping it with pango which is expensive, and
+ * views ask size of every item on each relayout. Therefore measured sizes
+ * are cached per renderer, keyed by text and all layout parameters, and
+ * layouts of recently rendered items are kept to draw them again. Whole
+ * cache is dropped when pango context or its font is changed. */
+
+/* limits of the cache, the least recently used items are dropped first */
+#define SIZE_CACHE_MAX_ITEMS    100000
+#define SIZE_CACHE_MAX_LAYOUTS  512
+
+typedef struct
+{
+    char *text;
+    gint wrap_width;
+    gint height;
+    PangoWrapMode wrap_mode;
+    PangoAlignment alignment;
+} SizeKey;
+
+typedef struct
+{
+    SizeKey key; /* should be first member */
+    gint width, height; /* in pixels */
+    PangoLayout *layout; /* NULL if not rendered recently */
+    GList lru_link; /* in SizeCache.lru */
+    GList layout_link; /* in SizeCache.layouts */
+} SizeItem;
+
+typedef struct
+{
+    PangoContext *context;
+#if PANGO_VERSION_CHECK(1, 32, 4)
+    guint serial;
+#else
+    PangoFontDescription *font;
+#endif
+    /* properties of GtkCellRendererText, tracked via notify */
+    PangoWrapMode wrap_mode;
+    gint wrap_width;
+    PangoAlignment alignment;
+    GHashTable *items; /* SizeKey -> SizeItem */
+    GQueue lru; /* most recently used first */
+    GQueue layouts; /* items with layout, most recently rendered first */
+} SizeCache;
+
 static void fm_cell_renderer_text_get_property(GObject *object, guint param_id,
                                                GValue *value, GParamSpec *psec);
 static void fm_cell_renderer_text_set_property(GObject *object, guint param_id,
@@ -46,6 +93,85 @@ enum
 
 G_DEFINE_TYPE(FmCellRendererText, fm_cell_renderer_text, GTK_TYPE_CELL_RENDERER_TEXT);
 
+static guint size_key_hash(gconstpointer key)
+{
+    const SizeKey *k = key;
+
+    return g_str_hash(k->text) ^ ((guint)k->wrap_width << 16) ^ ((guint)k->height << 4)
+           ^ ((guint)k->wrap_mode << 2) ^ (guint)k->alignment;
+}
+
+static gboolean size_key_equal(gconstpointer a, gconstpointer b)
+{
+    const SizeKey *ka = a, *kb = b;
+
+    return ka->wrap_width == kb->wrap_width && ka->height == kb->height &&
+           ka->wrap_mode == kb->wrap_mode && ka->alignment == kb->alignment &&
+           strcmp(ka->text, kb->text) == 0;
+}
+
+static void size_item_free(gpointer data)
+{
+    SizeItem *item = data;
+
+    g_free(item->key.text);
+    if (item->layout)
+        g_object_unref(item->layout);
+    g_slice_free(SizeItem, item);
+}
+
+static void size_cache_clear(SizeCache *cache)
+{
+    /* items are freed by hash table so just forget links */
+    g_queue_init(&cache->lru);
+    g_queue_init(&cache->layouts);
+    g_hash_table_remove_all(cache->items);
+    if (cache->context)
+        g_object_unref(cache->context);
+    cache->context = NULL;
+#if !PANGO_VERSION_CHECK(1, 32, 4)
+    if (cache->font)
+        pango_font_description_free(cache->font);
+    cache->font = NULL;
+#endif
+}
+
+/* drops all items if context is not the same as when they were measured */
+static void size_cache_set_context(SizeCache *cache, PangoContext *context)
+{
+#if PANGO_VERSION_CHECK(1, 32, 4)
+    if (context == cache->context && pango_context_get_serial(context) == cache->serial)
+        return;
+    size_cache_clear(cache);
+    cache->serial = pango_context_get_serial(context);
+#else
+    const PangoFontDescription *font = pango_context_get_font_description(context);
+
+    if (context == cache->context && cache->font && font &&
+        pango_font_description_equal(font, cache->font))
+        return;
+    size_cache_clear(cache);
+    if (font)
+        cache->font = pango_font_description_copy(font);
+#endif
+    cache->context = g_object_ref(context);
+}
+
+static void size_cache_drop_layout(SizeCache *cache, SizeItem *item)
+{
+    g_queue_unlink(&cache->layouts, &item->layout_link);
+    g_object_unref(item->layout);
+    item->layout = NULL;
+}
+
+static void size_cache_remove(SizeCache *cache, SizeItem *item)
+{
+    g_queue_unlink(&cache->lru, &item->lru_link);
+    if (item->layout)
+        g_queue_unlink(&cache->layouts, &item->layout_link);
+    g_hash_table_remove(cache->items, &item->key);
+}
+
 static void fm_cell_renderer_text_get_size(GtkCellRenderer            *cell,
                                            GtkWidget                  *widget,
 #if GTK_CHECK_VERSION(3, 0, 0)
@@ -92,6 +218,35 @@ static void fm_cell_renderer_text_get_preferred_height_for_width(GtkCellRenderer
                                                                  gint *natural_height);
 #endif
 
+static void fm_cell_renderer_text_finalize(GObject *object)
+{
+    FmCellRendererText *self = FM_CELL_RENDERER_TEXT(object);
+    SizeCache *cache = self->size_cache;
+
+    size_cache_clear(cache);
+    g_hash_table_destroy(cache->items);
+    g_slice_free(SizeCache, cache);
+
+    G_OBJECT_CLASS(fm_cell_renderer_text_parent_class)->finalize(object);
+}
+
+/* keep copies of properties which affect layout, so they are not queried
+   on each measurement */
+static void fm_cell_renderer_text_notify(GObject *object, GParamSpec *pspec)
+{
+    FmCellRendererText *self = FM_CELL_RENDERER_TEXT(object);
+    SizeCache *cache = self->size_cache;
+
+    if (strcmp(pspec->name, "wrap-mode") == 0)
+        g_object_get(object, "wrap-mode", &cache->wrap_mode, NULL);
+    else if (strcmp(pspec->name, "wrap-width") == 0)
+        g_object_get(object, "wrap-width", &cache->wrap_width, NULL);
+    else if (strcmp(pspec->name, "alignment") == 0)
+        g_object_get(object, "alignment", &cache->alignment, NULL);
+    if (G_OBJECT_CLASS(fm_cell_renderer_text_parent_class)->notify)
+        G_OBJECT_CLASS(fm_cell_renderer_text_parent_class)->notify(object, pspec);
+}
+
 static void fm_cell_renderer_text_class_init(FmCellRendererTextClass *klass)
 {
     GObjectClass *g_object_class = G_OBJECT_CLASS(klass);
@@ -99,6 +254,8 @@ static void fm_cell_renderer_text_class_init(FmCellRendererTextClass *klass)
 
     g_object_class->get_property = fm_cell_renderer_text_get_property;
     g_object_class->set_property = fm_cell_renderer_text_set_property;
+    g_object_class->finalize = fm_cell_renderer_text_finalize;
+    g_object_class->notify = fm_cell_renderer_text_notify;
 
     render_class->render = fm_cell_renderer_text_render;
     render_class->get_size = fm_cell_renderer_text_get_size;
@@ -130,6 +287,14 @@ static void fm_cell_renderer_text_class_init(FmCellRendererTextClass *klass)
 
 static void fm_cell_renderer_text_init(FmCellRendererText *self)
 {
+    SizeCache *cache = g_slice_new0(SizeCache);
+
+    cache->items = g_hash_table_new_full(size_key_hash, size_key_equal,
+                                         NULL, size_item_free);
+    g_object_get(self, "wrap-mode", &cache->wrap_mode,
+                       "wrap-width", &cache->wrap_width,
+                       "alignment", &cache->alignment, NULL);
+    self->size_cache = cache;
     self->height = -1;
 }
 
@@ -177,64 +342,124 @@ static void fm_cell_renderer_text_set_property(GObject *object, guint param_id,
     }
 }
 
-static void _get_size(GtkCellRenderer *cell, GtkWidget *widget,
-                      PangoLayout *layout, gchar *text,
-                      const GdkRectangle *cell_area,
-                      gint *text_width, gint *text_height,
-                      gint *xpad, gint *ypad,
-                      gint *x_offset, gint *y_offset,
-                      gint *x_align_offset)
+static PangoLayout *_create_layout(PangoContext *context, const SizeKey *key)
 {
-    FmCellRendererText *self = FM_CELL_RENDERER_TEXT(cell);
-    PangoWrapMode wrap_mode;
-    gint wrap_width;
-    PangoAlignment alignment;
-    gfloat xalign, yalign;
-    gint a_width, a_height;
-    gint a_xpad, a_ypad;
-
-    if (layout)
-        g_object_ref(layout);
-    else
-        layout = pango_layout_new(gtk_widget_get_pango_context(widget));
-
-    g_object_get(G_OBJECT(cell),
-                 "wrap-mode" , &wrap_mode,
-                 "wrap-width", &wrap_width,
-                 "alignment" , &alignment,
-                 NULL);
+    PangoLayout *layout = pango_layout_new(context);
 
-    pango_layout_set_alignment(layout, alignment);
+    pango_layout_set_alignment(layout, key->alignment);
 
     /* Setup the wrapping. */
-    if (wrap_width < 0)
+    if (key->wrap_width < 0)
     {
         pango_layout_set_width(layout, -1);
         pango_layout_set_wrap(layout, PANGO_WRAP_CHAR);
     }
     else
     {
-        pango_layout_set_width(layout, wrap_width * PANGO_SCALE);
-        pango_layout_set_wrap(layout, wrap_mode);
-        if(self->height > 0)
+        pango_layout_set_width(layout, key->wrap_width * PANGO_SCALE);
+        pango_layout_set_wrap(layout, key->wrap_mode);
+        if(key->height > 0)
         {
             /* FIXME: add custom ellipsize from object? */
             pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_END);
-            pango_layout_set_height(layout, self->height * PANGO_SCALE);
+            pango_layout_set_height(layout, key->height * PANGO_SCALE);
         }
         else
             pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_NONE);
     }
 
-    pango_layout_set_text(layout, text, -1);
+    pango_layout_set_text(layout, key->text, -1);
 
     pango_layout_set_auto_dir(layout, TRUE);
+    return layout;
+}
+
+/* returns cached item for text, measures text if not cached yet */
+static SizeItem *_get_size_item(FmCellRendererText *self, GtkWidget *widget,
+                                gchar *text, gboolean want_layout)
+{
+    SizeCache *cache = self->size_cache;
+    SizeKey key;
+    SizeItem *item;
+    PangoLayout *layout;
+
+    size_cache_set_context(cache, gtk_widget_get_pango_context(widget));
+    key.text = text ? text : "";
+    key.wrap_width = cache->wrap_width;
+    key.wrap_mode = cache->wrap_mode;
+    key.alignment = cache->alignment;
+    /* height limit is used only with wrapping */
+    key.height = (cache->wrap_width < 0) ? -1 : self->height;
+    item = g_hash_table_lookup(cache->items, &key);
+    if (item)
+    {
+        /* move it to the head of LRU */
+        g_queue_unlink(&cache->lru, &item->lru_link);
+        g_queue_push_head_link(&cache->lru, &item->lru_link);
+        if (item->layout)
+        {
+            if (want_layout)
+            {
+                g_queue_unlink(&cache->layouts, &item->layout_link);
+                g_queue_push_head_link(&cache->layouts, &item->layout_link);
+            }
+            return item;
+        }
+        if (!want_layout)
+            return item;
+    }
+
+    layout = _create_layout(cache->context, &key);
+    if (!item)
+    {
+        item = g_slice_new0(SizeItem);
+        item->key = key;
+        item->key.text = g_strdup(key.text);
+        item->lru_link.data = item;
+        item->layout_link.data = item;
+        pango_layout_get_pixel_size(layout, &item->width, &item->height);
+        g_hash_table_insert(cache->items, &item->key, item);
+        g_queue_push_head_link(&cache->lru, &item->lru_link);
+        if (cache->lru.length > SIZE_CACHE_MAX_ITEMS)
+            size_cache_remove(cache, cache->lru.tail->data);
+    }
+    if (want_layout)
+    {
+        item->layout = layout;
+        g_queue_push_head_link(&cache->layouts, &item->layout_link);
+        if (cache->layouts.length > SIZE_CACHE_MAX_LAYOUTS)
+            size_cache_drop_layout(cache, cache->layouts.tail->data);
+    }
+    else
+        g_object_unref(layout);
+    return item;
+}
+
+static void _get_size(GtkCellRenderer *cell, GtkWidget *widget,
+                      PangoLayout **layout, gchar *text,
+                      const GdkRectangle *cell_area,
+                      gint *text_width, gint *text_height,
+                      gint *xpad, gint *ypad,
+                      gint *x_offset, gint *y_offset,
+                      gint *x_align_offset)
+{
+    FmCellRendererText *self = FM_CELL_RENDERER_TEXT(cell);
+    SizeCache *cache = self->size_cache;
+    SizeItem *item;
+    gfloat xalign, yalign;
+    gint a_width, a_height;
+    gint a_xpad, a_ypad;
+
+    item = _get_size_item(self, widget, text, layout != NULL);
+    if (layout)
+        *layout = g_object_ref(item->layout);
 
     if (!text_width)
         text_width = &a_width;
     if (!text_height)
         text_height = &a_height;
-    pango_layout_get_pixel_size(layout, text_width, text_height);
+    *text_width = item->width;
+    *text_height = item->height;
 
     gtk_cell_renderer_get_alignment(cell, &xalign, &yalign);
     if (!xpad)
@@ -258,9 +483,7 @@ static void _get_size(GtkCellRenderer *cell, GtkWidget *widget,
 
     /* FIXME: this hack is ugly, need to rewrite this later */
     if (x_align_offset)
-        *x_align_offset = (alignment == PANGO_ALIGN_CENTER) ? (wrap_width - *text_width) / 2 : 0;
-
-    g_object_unref(layout);
+        *x_align_offset = (cache->alignment == PANGO_ALIGN_CENTER) ? (cache->wrap_width - *text_width) / 2 : 0;
 }
 
 #if GTK_CHECK_VERSION(3, 0, 0)
@@ -296,18 +519,14 @@ static void fm_cell_renderer_text_render(GtkCellRenderer *cell,
     GdkRectangle rect;
     gint xpad, ypad;
 
-    /* FIXME: this is time-consuming since it invokes pango_layout.
-     *        if we want to fix this, we must implement the whole cell
-     *        renderer ourselves instead of derived from GtkCellRendererText. */
-    PangoContext* context = gtk_widget_get_pango_context(widget);
-
-    PangoLayout* layout = pango_layout_new(context);
+    /* layouts of recently rendered texts are cached so this is cheap */
+    PangoLayout* layout;
 
     g_object_get(G_OBJECT(cell),
                  "text", &text,
                  NULL);
 
-    _get_size(cell, widget, layout, text, cell_area, &text_width, &text_height,
+    _get_size(cell, widget, &layout, text, cell_area, &text_width, &text_height,
               &xpad, &ypad, &x_offset, &y_offset, &x_align_offset);
 
     if(flags & (GTK_CELL_RENDERER_SELECTED|GTK_CELL_RENDERER_FOCUSED))
@@ -431,9 +650,8 @@ static void fm_cell_renderer_text_get_preferred_width(GtkCellRenderer *cell,
                                                       gint *minimum_size,
                                                       gint *natural_size)
 {
-    gint wrap_width;
+    gint wrap_width = ((SizeCache*)FM_CELL_RENDERER_TEXT(cell)->size_cache)->wrap_width;
 
-    g_object_get(G_OBJECT(cell), "wrap-width", &wrap_width, NULL);
     if(wrap_width > 0)
     {
         if(minimum_size)
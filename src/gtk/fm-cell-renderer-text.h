@@ -45,7 +45,7 @@ struct _FmCellRendererText
 	GtkCellRendererText parent;
 	/* add your public declarations here */
 	/*< private >*/
-	gpointer _reserved1;
+	gpointer size_cache; /* cache of text measurements */
 	gint height; /* "max-height" - height in pixels */
 };
 
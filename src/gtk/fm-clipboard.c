@@ -36,6 +36,9 @@
 #include "gtk-compat.h"
 #include "fm-clipboard.h"
 #include "fm-gtk-utils.h"
+#include "fm-simple-job.h"
+
+#include <string.h>
 
 enum {
     URI_LIST = 1,
@@ -73,25 +76,23 @@ static inline void check_atoms(void)
     }
 }
 
-static void get_data(GtkClipboard *clip, GtkSelectionData *sel, guint info, gpointer user_data)
+/* data on clipboard: the files and their lists rendered on demand */
+typedef struct
+{
+    FmPathList* files;
+    GString* rendered[N_CLIPBOARD_TARGETS];
+} ClipData;
+
+static GString* render_files(FmPathList* files, guint info)
 {
-    FmPathList* files = (FmPathList*)user_data;
     GString* uri_list;
     GList *l;
-    GdkAtom target = gtk_selection_data_get_target(sel);
-
-    if(info == KDE_CUT_SEL)
-    {
-        /* set application/kde-cutselection data */
-        if(is_cut)
-            gtk_selection_data_set(sel, target, 8, (guchar*)"1", 2);
-        return;
-    }
+    guint n = fm_path_list_get_length(files);
 
-    uri_list = g_string_sized_new(4096);
+    /* few reallocations for big lists: assume 64 bytes per path */
+    uri_list = g_string_sized_new(MAX(4096, (gsize)n * 64));
     if(info == GNOME_COPIED_FILES)
     {
-        g_string_append(uri_list, is_cut ? "cut\n" : "copy\n");
         fm_path_list_write_uri_list(files, uri_list);
     }
     /* FIXME: this is invalid, UTF8_STRING means this is plain text not file list */
@@ -118,8 +119,40 @@ static void get_data(GtkClipboard *clip, GtkSelectionData *sel, guint info, gpoi
                 g_string_append(uri_list, "\r\n");
         }
     }
-    gtk_selection_data_set(sel, target, 8, (guchar*)uri_list->str, uri_list->len + 1);
-    g_string_free(uri_list, TRUE);
+    return uri_list;
+}
+
+static void get_data(GtkClipboard *clip, GtkSelectionData *sel, guint info, gpointer user_data)
+{
+    ClipData* cd = (ClipData*)user_data;
+    GString* uri_list;
+    GdkAtom target = gtk_selection_data_get_target(sel);
+
+    if(info == KDE_CUT_SEL)
+    {
+        /* set application/kde-cutselection data */
+        if(is_cut)
+            gtk_selection_data_set(sel, target, 8, (guchar*)"1", 2);
+        return;
+    }
+
+    /* the list is rendered once since it may be requested several times */
+    if(cd->rendered[info] == NULL)
+        cd->rendered[info] = render_files(cd->files, info);
+    uri_list = cd->rendered[info];
+    if(info == GNOME_COPIED_FILES)
+    {
+        const char* op = is_cut ? "cut\n" : "copy\n";
+        gsize op_len = strlen(op);
+        guchar* buf = g_malloc(op_len + uri_list->len + 1);
+
+        memcpy(buf, op, op_len);
+        memcpy(buf + op_len, uri_list->str, uri_list->len + 1);
+        gtk_selection_data_set(sel, target, 8, buf, op_len + uri_list->len + 1);
+        g_free(buf);
+    }
+    else
+        gtk_selection_data_set(sel, target, 8, (guchar*)uri_list->str, uri_list->len + 1);
     if(is_cut && info == GNOME_COPIED_FILES)
     {
         /* info about is_cut is already on clipboard so reset it */
@@ -130,8 +163,14 @@ static void get_data(GtkClipboard *clip, GtkSelectionData *sel, guint info, gpoi
 
 static void clear_data(GtkClipboard* clip, gpointer user_data)
 {
-    FmPathList* files = (FmPathList*)user_data;
-    fm_path_list_unref(files);
+    ClipData* cd = (ClipData*)user_data;
+    guint i;
+
+    fm_path_list_unref(cd->files);
+    for(i = 0; i < N_CLIPBOARD_TARGETS; i++)
+        if(cd->rendered[i])
+            g_string_free(cd->rendered[i], TRUE);
+    g_slice_free(ClipData, cd);
     is_cut = FALSE;
 }
 
@@ -151,169 +190,241 @@ gboolean fm_clipboard_cut_or_copy_files(GtkWidget* src_widget, FmPathList* files
 {
     GdkDisplay* dpy = src_widget ? gtk_widget_get_display(src_widget) : gdk_display_get_default();
     GtkClipboard* clip = gtk_clipboard_get_for_display(dpy, GDK_SELECTION_CLIPBOARD);
+    ClipData* cd = g_slice_new0(ClipData);
     gboolean ret;
 
+    cd->files = fm_path_list_ref(files);
     ret = gtk_clipboard_set_with_data(clip, targets, G_N_ELEMENTS(targets),
-                                      get_data, clear_data, fm_path_list_ref(files));
+                                      get_data, clear_data, cd);
+    if(!ret)
+        clear_data(clip, cd);
     is_cut = _is_cut;
     return ret;
 }
 
-static gboolean check_kde_curselection(GtkClipboard* clip)
+/* Paste is done asynchronously: the clipboard owner may be slow to reply
+ * and the list may contain huge number of files, so neither waiting for
+ * the reply nor parsing it should freeze the main loop. */
+typedef struct
+{
+    GtkWidget* parent; /* weak pointer to toplevel window */
+    FmPath* dest_dir;
+    int type;
+    gboolean is_cut;
+    char* data; /* NUL-terminated list of URIs */
+    gsize len;
+    FmPathList* files;
+} PasteData;
+
+static void paste_data_free(PasteData* pd)
+{
+    if(pd->parent)
+        g_object_remove_weak_pointer(G_OBJECT(pd->parent), (gpointer*)&pd->parent);
+    fm_path_unref(pd->dest_dir);
+    g_free(pd->data);
+    if(pd->files)
+        fm_path_list_unref(pd->files);
+    g_slice_free(PasteData, pd);
+}
+
+/* runs in working thread */
+static gboolean parse_uris_job(FmJob* job, gpointer user_data)
+{
+    PasteData* pd = user_data;
+    char *line, *eol, *end = pd->data + pd->len;
+    GPtrArray* uris = g_ptr_array_new();
+
+    /* split the list in place, as g_uri_list_extract_uris() does it */
+    for(line = pd->data; line < end; line = eol + 1)
+    {
+        char* tail;
+
+        eol = memchr(line, '\n', end - line);
+        if(eol == NULL)
+            eol = end;
+        *eol = '\0';
+        while(g_ascii_isspace(*line))
+            line++;
+        for(tail = eol; tail > line && g_ascii_isspace(tail[-1]); tail--)
+            tail[-1] = '\0';
+        if(*line != '\0' && *line != '#')
+            g_ptr_array_add(uris, line);
+    }
+    g_ptr_array_add(uris, NULL);
+    pd->files = fm_path_list_new_from_uris((char**)uris->pdata);
+    g_ptr_array_free(uris, TRUE);
+    return TRUE;
+}
+
+static void on_parse_finished(FmJob* job, PasteData* pd)
+{
+    GtkWindow* parent = GTK_IS_WINDOW(pd->parent) ? GTK_WINDOW(pd->parent) : NULL;
+
+    if(!fm_path_list_is_empty(pd->files))
+    {
+        if(pd->is_cut)
+            fm_move_files(parent, pd->files, pd->dest_dir);
+        else
+            fm_copy_files(parent, pd->files, pd->dest_dir);
+    }
+    paste_data_free(pd);
+}
+
+static void on_paste_contents(GtkClipboard* clip, GtkSelectionData* sel, gpointer user_data)
+{
+    PasteData* pd = user_data;
+    const gchar* pdata;
+    gint length;
+    FmJob* job;
+
+    pdata = sel ? (const gchar*)gtk_selection_data_get_data_with_length(sel, &length) : NULL;
+    if(pdata == NULL || length <= 0)
+    {
+        paste_data_free(pd);
+        return;
+    }
+    if(pd->type == GNOME_COPIED_FILES)
+    {
+        /* the first line is the operation */
+        const gchar* eol = memchr(pdata, '\n', length);
+
+        pd->is_cut = (length >= 4 && strncmp(pdata, "cut\n", 4) == 0);
+        length = eol ? length - (eol + 1 - pdata) : 0;
+        pdata = eol ? eol + 1 : pdata;
+    }
+    /* FIXME: how should we treat UTF-8 strings? URIs or filenames? */
+    /* FIXME: this is invalid, UTF8_STRING means this is plain text
+       not file list. We should save text into file instead. */
+    pd->data = g_malloc(length + 1);
+    memcpy(pd->data, pdata, length);
+    pd->data[length] = '\0';
+    pd->len = strlen(pd->data); /* data may be NUL-terminated already */
+
+    job = fm_simple_job_new(parse_uris_job, pd, NULL);
+    g_signal_connect(job, "finished", G_CALLBACK(on_parse_finished), pd);
+    if(!fm_job_run_async(job))
+    {
+        g_signal_handlers_disconnect_by_func(job, on_parse_finished, pd);
+        paste_data_free(pd);
+    }
+    g_object_unref(job);
+}
+
+static void on_kde_cut_selection(GtkClipboard* clip, GtkSelectionData* sel, gpointer user_data)
 {
     /* Check application/x-kde-cutselection:
      * If the content of this format is string "1", that means the
      * file is cut in KDE (Dolphin). */
-    gboolean ret = FALSE;
-    GtkSelectionData* data;
+    PasteData* pd = user_data;
 
-    check_atoms();
-    data = gtk_clipboard_wait_for_contents(clip, target_atom[KDE_CUT_SEL]);
-    if(data)
+    if(sel)
     {
         gint length, format;
         const gchar* pdata;
 
-        pdata = (const gchar*)gtk_selection_data_get_data_with_length(data, &length);
-        format = gtk_selection_data_get_format(data);
+        pdata = (const gchar*)gtk_selection_data_get_data_with_length(sel, &length);
+        format = gtk_selection_data_get_format(sel);
         if(length > 0 && format == 8 && pdata[0] == '1')
-            ret = TRUE;
-        gtk_selection_data_free(data);
+            pd->is_cut = TRUE;
     }
-    return ret;
+    gtk_clipboard_request_contents(clip, target_atom[URI_LIST], on_paste_contents, pd);
 }
 
-/**
- * fm_clipboard_paste_files
- * @dest_widget: widget where to paste files
- * @dest_dir: directory to place files
- *
- * Copies or moves files from system clipboard into @dest_dir.
- *
- * Returns: %TRUE if operation was successful.
- *
- * Since: 0.1.0
- */
-gboolean fm_clipboard_paste_files(GtkWidget* dest_widget, FmPath* dest_dir)
+static void on_paste_targets(GtkClipboard* clip, GdkAtom* avail_targets,
+                             gint n, gpointer user_data)
 {
-    GdkDisplay* dpy;
-    GtkClipboard* clip;
-    FmPathList* files;
-    char** uris;
-    int type = 0;
-    GdkAtom *avail_targets;
-    int n, i;
-    gboolean _is_cut;
-
-    /* safeguard this API call */
-    if (dest_dir == NULL)
-    {
-        g_warning("fm_clipboard_paste_files() for NULL destination");
-        return FALSE;
-    }
-
-    /* get all available targets currently in the clipboard. */
-    dpy = dest_widget ? gtk_widget_get_display(dest_widget) : gdk_display_get_default();
-    clip = gtk_clipboard_get_for_display(dpy, GDK_SELECTION_CLIPBOARD);
-    if( !gtk_clipboard_wait_for_targets(clip, &avail_targets, &n) )
-        return FALSE;
+    PasteData* pd = user_data;
+    gboolean has_kde_cut_sel = FALSE;
+    int i;
 
     /* check gnome and xfce compatible format first */
-    check_atoms();
     for(i = 0; i < n; ++i)
     {
         if(avail_targets[i] == target_atom[GNOME_COPIED_FILES])
-        {
-            type = GNOME_COPIED_FILES;
-            break;
-        }
+            pd->type = GNOME_COPIED_FILES;
+        else if(avail_targets[i] == target_atom[KDE_CUT_SEL])
+            has_kde_cut_sel = TRUE;
     }
-    if( 0 == type ) /* x-special/gnome-copied-files is not found. */
+    if( 0 == pd->type ) /* x-special/gnome-copied-files is not found. */
     {
         /* check uri-list */
         for(i = 0; i < n; ++i)
         {
             if(avail_targets[i] == target_atom[URI_LIST])
             {
-                type = URI_LIST;
+                pd->type = URI_LIST;
                 break;
             }
         }
-        if( 0 == type ) /* text/uri-list is not found. */
+        if( 0 == pd->type ) /* text/uri-list is not found. */
         {
             /* finally, fallback to UTF-8 string */
             for(i = 0; i < n; ++i)
             {
                 if(avail_targets[i] == target_atom[UTF8_STRING])
                 {
-                    type = UTF8_STRING;
+                    pd->type = UTF8_STRING;
                     break;
                 }
             }
         }
     }
-    g_free(avail_targets);
-
-    if( type )
-    {
-        GtkSelectionData* data;
-        const gchar* pdata;
-        gint length;
-
-        data = gtk_clipboard_wait_for_contents(clip, target_atom[type]);
-        pdata = (const gchar*)gtk_selection_data_get_data_with_length(data, &length);
-        _is_cut = FALSE;
 
-        switch(type)
-        {
-        case GNOME_COPIED_FILES:
-            _is_cut = g_str_has_prefix(pdata, "cut\n");
-            while(length)
-            {
-                register gchar ch = *pdata++;
-                length--;
-                if(ch == '\n')
-                    break;
-            }
-            uris = g_uri_list_extract_uris(pdata);
-            break;
-        case URI_LIST:
-            uris = g_uri_list_extract_uris(pdata);
-            _is_cut = check_kde_curselection(clip);
-            break;
-        case UTF8_STRING:
-        default:
-            /* FIXME: how should we treat UTF-8 strings? URIs or filenames? */
-            /* FIXME: this is invalid, UTF8_STRING means this is plain text
-               not file list. We should save text into file instead. */
-            uris = g_uri_list_extract_uris(pdata);
-            break;
-        }
-        gtk_selection_data_free(data);
+    if( 0 == pd->type )
+        paste_data_free(pd);
+    else if(pd->type == URI_LIST && has_kde_cut_sel)
+        gtk_clipboard_request_contents(clip, target_atom[KDE_CUT_SEL],
+                                       on_kde_cut_selection, pd);
+    else
+        gtk_clipboard_request_contents(clip, target_atom[pd->type],
+                                       on_paste_contents, pd);
+}
 
-        if(uris)
-        {
-            GtkWidget* parent;
-            if(dest_widget)
-                parent = gtk_widget_get_toplevel(dest_widget);
-            else
-                parent = NULL;
+/**
+ * fm_clipboard_paste_files
+ * @dest_widget: widget where to paste files
+ * @dest_dir: directory to place files
+ *
+ * Copies or moves files from system clipboard into @dest_dir.
+ *
+ * Since 1.3.0 the clipboard contents are received and parsed
+ * asynchronously and operation is started after this function returns.
+ * Therefore the returned value does not tell if anything will be pasted
+ * anymore: before 1.3.0 %FALSE was also returned if clipboard had no
+ * files, since 1.3.0 empty or unsupported clipboard contents are just
+ * ignored later. Use fm_clipboard_have_files() to test the clipboard.
+ *
+ * Returns: %TRUE if paste was requested, %FALSE if @dest_dir is %NULL.
+ *
+ * Since: 0.1.0
+ */
+gboolean fm_clipboard_paste_files(GtkWidget* dest_widget, FmPath* dest_dir)
+{
+    GdkDisplay* dpy;
+    GtkClipboard* clip;
+    PasteData* pd;
 
-            files = fm_path_list_new_from_uris(uris);
-            g_strfreev(uris);
+    /* safeguard this API call */
+    if (dest_dir == NULL)
+    {
+        g_warning("fm_clipboard_paste_files() for NULL destination");
+        return FALSE;
+    }
 
-            if(!fm_path_list_is_empty(files))
-            {
-                if( _is_cut )
-                    fm_move_files(GTK_WINDOW(parent), files, dest_dir);
-                else
-                    fm_copy_files(GTK_WINDOW(parent), files, dest_dir);
-            }
-            fm_path_list_unref(files);
-            return TRUE;
-        }
+    pd = g_slice_new0(PasteData);
+    pd->dest_dir = fm_path_ref(dest_dir);
+    if(dest_widget)
+    {
+        pd->parent = gtk_widget_get_toplevel(dest_widget);
+        g_object_add_weak_pointer(G_OBJECT(pd->parent), (gpointer*)&pd->parent);
     }
-    return FALSE;
+
+    /* get all available targets currently in the clipboard. */
+    dpy = dest_widget ? gtk_widget_get_display(dest_widget) : gdk_display_get_default();
+    clip = gtk_clipboard_get_for_display(dpy, GDK_SELECTION_CLIPBOARD);
+    check_atoms();
+    gtk_clipboard_request_targets(clip, on_paste_targets, pd);
+    return TRUE;
 }
 
 /**
@@ -604,7 +604,7 @@ static void on_open(GtkAction* action, gpointer user_data)
     FmFileMenu* data = (FmFileMenu*)user_data;
     GList* l = fm_file_info_list_peek_head_link(data->file_infos);
     GtkWindow *window = GTK_WINDOW(gtk_menu_get_attach_widget(data->menu));
-    fm_launch_files_simple(window, NULL, l, data->folder_func, data->folder_func_data);
+    fm_launch_files_simple_async(window, NULL, l, data->folder_func, data->folder_func_data);
 }
 
 static void open_with_app(FmFileMenu* data, GAppInfo* app)
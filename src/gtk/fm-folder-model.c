@@ -71,6 +71,7 @@ struct _FmFolderModel
     guint thumbnail_max;
     GList* thumbnail_requests;
     GHashTable* items_hash;
+    GHashTable* icon_requests; /* set of pending IconRequest */
 
     GSList* filters;
 };
@@ -84,10 +85,22 @@ struct _FmFolderItem
     gboolean is_thumbnail : 1;
     gboolean thumbnail_loading : 1;
     gboolean thumbnail_failed : 1;
+    gboolean icon_loading : 1;
+    gboolean icon_failed : 1;
     gboolean is_extra : 1;
     FmFolderModelExtraFilePos pos : 3;
 };
 
+/* one request for an image is shared by all items which need the same one */
+typedef struct _IconRequest
+{
+    FmIcon* icon;
+    int size;
+    const char* fallback; /* interned */
+    FmFolderModel* model;
+    GSList* waiting; /* FmFileInfo of items to update */
+}IconRequest;
+
 typedef struct _FmFolderModelFilterItem
 {
     FmFolderModelFilterFunc func;
@@ -166,6 +179,11 @@ static inline gboolean file_can_show(FmFolderModel* model, FmFileInfo* file);
 static void on_icon_theme_changed(GtkIconTheme* theme, FmFolderModel* model);
 
 static void on_thumbnail_loaded(FmThumbnailRequest* req, gpointer user_data);
+static void on_icon_loaded(FmIcon* icon, int size, GdkPixbuf* pix, gpointer user_data);
+static guint icon_request_hash(gconstpointer key);
+static gboolean icon_request_equal(gconstpointer a, gconstpointer b);
+static void icon_request_free(IconRequest* req);
+static void cancel_icon_requests(FmFolderModel* model);
 
 static void on_show_thumbnail_changed(FmConfig* cfg, gpointer user_data);
 
@@ -367,6 +385,7 @@ static void fm_folder_model_dispose(GObject *object)
         g_list_free(model->thumbnail_requests);
         model->thumbnail_requests = NULL;
     }
+    cancel_icon_requests(model);
     if(model->items_hash)
     {
         g_hash_table_destroy(model->items_hash);
@@ -721,21 +740,58 @@ static void fm_folder_model_get_value(GtkTreeModel *tree_model,
         break;
     case FM_FOLDER_MODEL_COL_ICON:
     {
-        if(G_UNLIKELY(!item->icon))
+        if(G_UNLIKELY(!item->icon) && !item->icon_failed)
         {
+            IconRequest key, *req = NULL;
+
             icon = fm_file_info_get_icon(info);
             if(!icon)
                 return;
+            key.icon = icon;
+            key.size = model->icon_size;
+            key.fallback = NULL;
             /* FIXME: use "emblem-symbolic-link" if file is some kind of link */
             /* special handle for desktop entries that have invalid icon */
             if(fm_file_info_is_dir(info))
-                item->icon = fm_pixbuf_from_icon_with_fallback(icon,
-                                                model->icon_size, "folder");
+                key.fallback = g_intern_static_string("folder");
             else if(fm_file_info_is_desktop_entry(info))
-                item->icon = fm_pixbuf_from_icon_with_fallback(icon,
-                                                model->icon_size, "application-x-executable");
+                key.fallback = g_intern_static_string("application-x-executable");
+            if(model->icon_requests)
+                req = g_hash_table_lookup(model->icon_requests, &key);
+            /* the request might be finished while item was hidden */
+            if(item->icon_loading && req == NULL)
+                item->icon_loading = FALSE;
+            if(item->icon_loading)
+                ; /* leave it empty until the image is loaded */
+            else if(req)
+            {
+                /* there is a request for the same image already */
+                req->waiting = g_slist_prepend(req->waiting, fm_file_info_ref(info));
+                item->icon_loading = TRUE;
+            }
             else
-                item->icon = fm_pixbuf_from_icon(icon, model->icon_size);
+            {
+                req = g_slice_new(IconRequest);
+                req->icon = g_object_ref(icon);
+                req->size = key.size;
+                req->fallback = key.fallback;
+                req->model = model;
+                req->waiting = NULL;
+                item->icon = fm_pixbuf_from_icon_async(icon, req->size,
+                                                       req->fallback,
+                                                       on_icon_loaded, req);
+                if(item->icon == NULL)
+                {
+                    if(!model->icon_requests)
+                        model->icon_requests = g_hash_table_new(icon_request_hash,
+                                                                icon_request_equal);
+                    req->waiting = g_slist_prepend(NULL, fm_file_info_ref(info));
+                    g_hash_table_insert(model->icon_requests, req, req);
+                    item->icon_loading = TRUE;
+                }
+                else
+                    icon_request_free(req);
+            }
         }
         g_value_set_object(value, item->icon);
 
@@ -1422,6 +1478,7 @@ void fm_folder_model_file_changed(FmFolderModel* model, FmFileInfo* file)
         item->icon = NULL;
         item->is_thumbnail = FALSE;
     }
+    item->icon_failed = FALSE;
     it.user_data  = items_it;
 
     path = gtk_tree_path_new_from_indices(g_sequence_iter_get_position(items_it), -1);
@@ -1480,12 +1537,90 @@ void fm_folder_model_set_show_hidden(FmFolderModel* model, gboolean show_hidden)
     fm_folder_model_apply_filters(model);
 }
 
+static guint icon_request_hash(gconstpointer key)
+{
+    const IconRequest* req = (const IconRequest*)key;
+    return g_direct_hash(req->icon) ^ g_direct_hash(req->fallback) ^ req->size;
+}
+
+static gboolean icon_request_equal(gconstpointer a, gconstpointer b)
+{
+    const IconRequest* ra = (const IconRequest*)a;
+    const IconRequest* rb = (const IconRequest*)b;
+    return ra->icon == rb->icon && ra->size == rb->size && ra->fallback == rb->fallback;
+}
+
+static void icon_request_free(IconRequest* req)
+{
+    g_object_unref(req->icon);
+    g_slist_free_full(req->waiting, (GDestroyNotify)fm_file_info_unref);
+    g_slice_free(IconRequest, req);
+}
+
+static gboolean cancel_icon_request(gpointer key, gpointer value, gpointer unused)
+{
+    fm_pixbuf_cancel_async(on_icon_loaded, value);
+    icon_request_free(value);
+    return TRUE;
+}
+
+static void cancel_icon_requests(FmFolderModel* model)
+{
+    if(model->icon_requests)
+    {
+        g_hash_table_foreach_remove(model->icon_requests, cancel_icon_request, NULL);
+        g_hash_table_destroy(model->icon_requests);
+        model->icon_requests = NULL;
+    }
+}
+
+static void on_icon_loaded(FmIcon* icon, int size, GdkPixbuf* pix, gpointer user_data)
+{
+    IconRequest* req = (IconRequest*)user_data;
+    FmFolderModel* model = req->model;
+    GSList *l;
+    GtkTreeIter it;
+
+    g_hash_table_remove(model->icon_requests, req);
+    GDK_THREADS_ENTER();
+    for(l = req->waiting; l; l = l->next)
+    {
+        GSequenceIter* seq_it = info2iter(model, l->data);
+        FmFolderItem* item;
+        GtkTreePath* tp;
+
+        if(!seq_it) /* it was removed or hidden meanwhile */
+            continue;
+        item = (FmFolderItem*)g_sequence_get(seq_it);
+        if(!item->icon_loading)
+            continue;
+        item->icon_loading = FALSE;
+        if(pix == NULL)
+            /* don't request it again on each redraw of the row */
+            item->icon_failed = TRUE;
+        else if(item->icon == NULL)
+        {
+            item->icon = g_object_ref(pix);
+            it.stamp = model->stamp;
+            it.user_data = seq_it;
+            tp = fm_folder_model_get_path(GTK_TREE_MODEL(model), &it);
+            gtk_tree_model_row_changed(GTK_TREE_MODEL(model), tp, &it);
+            gtk_tree_path_free(tp);
+        }
+    }
+    GDK_THREADS_LEAVE();
+    icon_request_free(req);
+}
+
 static void reload_icons(FmFolderModel* model, enum ReloadFlags flags)
 {
     /* reload icons */
     GSequenceIter* it = g_sequence_get_begin_iter(model->items);
     GtkTreePath* tp = gtk_tree_path_new_from_indices(0, -1);
 
+    if(flags & RELOAD_ICONS)
+        cancel_icon_requests(model);
+
     if(model->thumbnail_requests)
     {
         g_list_foreach(model->thumbnail_requests, (GFunc)fm_thumbnail_request_cancel, NULL);
@@ -1496,6 +1631,8 @@ static void reload_icons(FmFolderModel* model, enum ReloadFlags flags)
     for( ; !g_sequence_iter_is_end(it); it = g_sequence_iter_next(it) )
     {
         FmFolderItem* item = (FmFolderItem*)g_sequence_get(it);
+        if(flags & RELOAD_ICONS)
+            item->icon_failed = FALSE;
         if(item->icon)
         {
             GtkTreeIter tree_it;
@@ -1519,6 +1656,8 @@ static void reload_icons(FmFolderModel* model, enum ReloadFlags flags)
     for( ; !g_sequence_iter_is_end(it); it = g_sequence_iter_next(it) )
     {
         FmFolderItem* item = (FmFolderItem*)g_sequence_get(it);
+        if(flags & RELOAD_ICONS)
+            item->icon_failed = FALSE;
         if(item->icon)
         {
             g_object_unref(item->icon);
@@ -1766,8 +1766,8 @@ void fm_folder_view_item_clicked(FmFolderView* fv, GtkTreePath* path,
             files = fm_file_info_list_new();
             fm_file_info_list_push_tail(files, fi);
         }
-        fm_launch_files_simple(win, NULL, fm_file_info_list_peek_head_link(files),
-                               open_folders, win);
+        fm_launch_files_simple_async(win, NULL, fm_file_info_list_peek_head_link(files),
+                                     open_folders, win);
         fm_file_info_list_unref(files);
         break;
     case FM_FV_CONTEXT_MENU:
@@ -1814,6 +1814,19 @@ void fm_folder_view_sel_changed(GObject* obj, FmFolderView* fv)
 
         /* emit a selection changed notification to the world. */
         g_signal_emit(fv, signals[SEL_CHANGED], 0, files);
+
+        /* single selected folder is likely to be opened next; the
+           selection is counted only if somebody listens, as browsers do */
+        if(files == 1)
+        {
+            FmFileInfoList* sel = iface->dup_selected_files(fv);
+            FmFileInfo* fi = sel ? fm_file_info_list_peek_head(sel) : NULL;
+
+            if(fi && fm_file_info_is_dir(fi))
+                fm_folder_prefetch(fm_file_info_get_path(fi));
+            if(sel)
+                fm_file_info_list_unref(sel);
+        }
     }
 }
 
@@ -64,6 +64,7 @@ struct _LaunchData
     GtkWindow* parent;
     FmLaunchFolderFunc folder_func;
     gpointer user_data;
+    GCancellable* cancellable; /* used only by fm_launch_*_simple_async() */
 };
 
 static GAppInfo* choose_app(GList* file_infos, FmMimeType* mime_type, gpointer user_data, GError** err)
@@ -176,6 +177,8 @@ static FmFileLauncherExecAction on_exec_file(FmFileInfo* file, gpointer user_dat
  * then new context on the same screen as @parent will be created for
  * launching.
  *
+ * See also: fm_launch_files_simple_async().
+ *
  * Returns: %TRUE if launch was succesful.
  *
  * Since: 0.1.0
@@ -222,6 +225,8 @@ gboolean fm_launch_files_simple(GtkWindow* parent, GAppLaunchContext* ctx, GList
  * then new context on the same screen as @parent will be created for
  * launching.
  *
+ * See also: fm_launch_paths_simple_async().
+ *
  * Returns: %TRUE if launch was succesful.
  *
  * Since: 0.1.0
@@ -252,6 +257,121 @@ gboolean fm_launch_paths_simple(GtkWindow* parent, GAppLaunchContext* ctx, GList
     return ret;
 }
 
+static void launch_data_free(gpointer user_data)
+{
+    LaunchData* data = (LaunchData*)user_data;
+
+    if (data->parent)
+    {
+        g_signal_handlers_disconnect_by_func(data->parent, g_cancellable_cancel,
+                                             data->cancellable);
+        g_object_remove_weak_pointer(G_OBJECT(data->parent), (gpointer*)&data->parent);
+    }
+    g_object_unref(data->cancellable);
+    g_slice_free(LaunchData, data);
+}
+
+static LaunchData* launch_data_new_async(GtkWindow* parent, GAppLaunchContext** ctx,
+                                         FmLaunchFolderFunc func, gpointer user_data)
+{
+    LaunchData* data = g_slice_new(LaunchData);
+
+    data->parent = parent;
+    data->folder_func = func;
+    data->user_data = user_data;
+    data->cancellable = g_cancellable_new();
+    if (parent)
+    {
+        g_object_add_weak_pointer(G_OBJECT(parent), (gpointer*)&data->parent);
+        g_signal_connect_swapped(parent, "destroy",
+                                 G_CALLBACK(g_cancellable_cancel), data->cancellable);
+    }
+    if(*ctx == NULL)
+    {
+        GdkAppLaunchContext* _ctx = gdk_display_get_app_launch_context(gdk_display_get_default());
+        gdk_app_launch_context_set_screen(_ctx, parent ? gtk_widget_get_screen(GTK_WIDGET(parent)) : gdk_screen_get_default());
+        gdk_app_launch_context_set_timestamp(_ctx, gtk_get_current_event_time());
+        /* FIXME: how to handle gdk_app_launch_context_set_icon? */
+        *ctx = G_APP_LAUNCH_CONTEXT(_ctx);
+    }
+    else
+        g_object_ref(*ctx);
+    return data;
+}
+
+/**
+ * fm_launch_files_simple_async
+ * @parent: (allow-none): window to determine launch screen
+ * @ctx: (allow-none): launch context
+ * @file_infos: (element-type FmFileInfo): files to launch
+ * @func: callback to launch folder
+ * @user_data: data supplied for @func
+ *
+ * Does the same as fm_launch_files_simple() but information about
+ * shortcut targets is retrieved in background, so @func may be called
+ * after this function returned. If @parent is destroyed before that then
+ * launch is cancelled, so @user_data should be valid while @parent exists.
+ *
+ * Returns: %TRUE if launch was succesfully started.
+ *
+ * Since: 1.3.0
+ */
+gboolean fm_launch_files_simple_async(GtkWindow* parent, GAppLaunchContext* ctx, GList* file_infos, FmLaunchFolderFunc func, gpointer user_data)
+{
+    FmFileLauncher launcher = {
+        .get_app = choose_app,
+        .open_folder = on_open_folder,
+        .exec_file = on_exec_file,
+        .error = on_launch_error,
+        .ask = on_launch_ask
+    };
+    LaunchData* data;
+    gboolean ret;
+
+    if (!func)
+        launcher.open_folder = NULL;
+    data = launch_data_new_async(parent, &ctx, func, user_data);
+    ret = fm_launch_files_async(ctx, file_infos, &launcher, data, launch_data_free,
+                                data->cancellable);
+    g_object_unref(ctx);
+    return ret;
+}
+
+/**
+ * fm_launch_paths_simple_async
+ * @parent: (allow-none): window to determine launch screen
+ * @ctx: (allow-none): launch context
+ * @paths: (element-type FmPath): files to launch
+ * @func: callback to launch folder
+ * @user_data: data supplied for @func
+ *
+ * Does the same as fm_launch_paths_simple() but information about files
+ * is retrieved in background, so @func may be called after this function
+ * returned. If @parent is destroyed before that then launch is cancelled,
+ * so @user_data should be valid while @parent exists.
+ *
+ * Returns: %TRUE if launch was succesfully started.
+ *
+ * Since: 1.3.0
+ */
+gboolean fm_launch_paths_simple_async(GtkWindow* parent, GAppLaunchContext* ctx, GList* paths, FmLaunchFolderFunc func, gpointer user_data)
+{
+    FmFileLauncher launcher = {
+        .get_app = choose_app,
+        .open_folder = on_open_folder,
+        .exec_file = on_exec_file,
+        .error = on_launch_error,
+        .ask = on_launch_ask
+    };
+    LaunchData* data = launch_data_new_async(parent, &ctx, func, user_data);
+    gboolean ret;
+
+    ret = fm_launch_paths_async(ctx, paths, &launcher, data, launch_data_free,
+                                data->cancellable);
+    g_object_unref(ctx);
+    return ret;
+}
+
 /**
  * fm_launch_file_simple
  * @parent: (allow-none): window to determine launch screen
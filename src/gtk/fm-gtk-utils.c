@@ -857,6 +857,7 @@ void fm_copy_files(GtkWindow* parent, FmPathList* files, FmPath* dest_dir)
 {
     FmFileOpsJob* job = fm_file_ops_job_new(FM_FILE_OP_COPY, files);
     fm_file_ops_job_set_dest(job, dest_dir);
+    fm_file_ops_job_set_defer_conflicts(job, fm_config->defer_conflicts);
     fm_file_ops_job_run_with_progress(parent, job); /* it eats reference! */
 }
 
@@ -876,6 +877,7 @@ void fm_move_files(GtkWindow* parent, FmPathList* files, FmPath* dest_dir)
 {
     FmFileOpsJob* job = fm_file_ops_job_new(FM_FILE_OP_MOVE, files);
     fm_file_ops_job_set_dest(job, dest_dir);
+    fm_file_ops_job_set_defer_conflicts(job, fm_config->defer_conflicts);
     fm_file_ops_job_run_with_progress(parent, job); /* it eats reference! */
 }
 
@@ -33,12 +33,46 @@
 
 static guint changed_handler = 0;
 
+/* cached pixbufs are attached to FmIcon as a list of PixEntry and also
+   are linked into single LRU queue so least recently used ones can be
+   unloaded when cache grows over its budget; the budget is enough for
+   so many images of each icon size set in config */
+#define PIXBUF_CACHE_ICONS_PER_SIZE 256
+
 typedef struct _PixEntry
 {
     int size;
     GdkPixbuf* pix;
+    FmIcon* icon; /* not referenced, FmIcon objects are never freed */
+    gsize mem_size;
+    GList lru; /* link in pixbuf_lru, data points to the entry */
 }PixEntry;
 
+static GQueue pixbuf_lru = G_QUEUE_INIT; /* head is most recently used */
+static gsize pixbuf_cache_size = 0;
+
+/* incremented when icon theme is changed, images loaded for an older
+   theme are dropped when they arrive */
+static guint theme_generation = 0;
+
+/* pending async requests, see fm_pixbuf_from_icon_async() */
+typedef struct
+{
+    FmIcon* icon;
+    int size;
+    char* fallback;
+    GtkIconInfo* ii;
+    GdkPixbuf* pix;
+    FmPixbufReadyFunc func;
+    gpointer user_data;
+    guint generation; /* theme_generation at time of lookup */
+    guint idle_handler;
+    gboolean cancelled;
+}PixRequest;
+
+static GThreadPool* load_pool = NULL;
+static GList* pending_requests = NULL;
+
 static void destroy_pixbufs(gpointer data)
 {
     GSList* pixs = (GSList*)data;
@@ -46,6 +80,8 @@ static void destroy_pixbufs(gpointer data)
     for(l = pixs; l; l=l->next)
     {
         PixEntry* ent = (PixEntry*)l->data;
+        g_queue_unlink(&pixbuf_lru, &ent->lru);
+        pixbuf_cache_size -= ent->mem_size;
         if(G_LIKELY(ent->pix))
             g_object_unref(ent->pix);
         g_slice_free(PixEntry, ent);
@@ -53,6 +89,98 @@ static void destroy_pixbufs(gpointer data)
     g_slist_free(pixs);
 }
 
+static PixEntry* cache_lookup(FmIcon* icon, int size)
+{
+    GSList* l = (GSList*)g_object_get_qdata(G_OBJECT(icon), fm_qdata_id);
+    /* FIXME:
+        1) get/add GQuark for emblem type: no emblem is fm_qdata_id
+        2) get/add GQuark by GQuark in the theme to support multi GdkScreen */
+    for( ; l; l=l->next )
+    {
+        PixEntry* ent = (PixEntry*)l->data;
+        if(ent->size == size)
+        {
+            /* move it to head of LRU */
+            g_queue_unlink(&pixbuf_lru, &ent->lru);
+            g_queue_push_head_link(&pixbuf_lru, &ent->lru);
+            return ent;
+        }
+    }
+    return NULL;
+}
+
+static gsize cache_max_size(void)
+{
+    int sizes[4] = { fm_config->big_icon_size, fm_config->small_icon_size,
+                     fm_config->pane_icon_size, fm_config->thumbnail_size };
+    gsize max_size = 0;
+    guint i;
+
+    /* 4 bytes per pixel, the same size may be counted twice but that's ok */
+    for(i = 0; i < G_N_ELEMENTS(sizes); i++)
+        max_size += (gsize)sizes[i] * sizes[i] * 4 * PIXBUF_CACHE_ICONS_PER_SIZE;
+    return max_size;
+}
+
+/* unload least recently used pixbufs until cache fits into its budget */
+static void cache_trim(void)
+{
+    gsize max_size = cache_max_size();
+
+    while(pixbuf_cache_size > max_size && pixbuf_lru.length > 1)
+    {
+        PixEntry* ent = (PixEntry*)g_queue_peek_tail(&pixbuf_lru);
+        GSList* pixs = (GSList*)g_object_steal_qdata(G_OBJECT(ent->icon), fm_qdata_id);
+
+        pixs = g_slist_remove(pixs, ent);
+        if(pixs)
+            g_object_set_qdata_full(G_OBJECT(ent->icon), fm_qdata_id, pixs, destroy_pixbufs);
+        g_queue_unlink(&pixbuf_lru, &ent->lru);
+        pixbuf_cache_size -= ent->mem_size;
+        if(G_LIKELY(ent->pix))
+            g_object_unref(ent->pix);
+        g_slice_free(PixEntry, ent);
+    }
+}
+
+static void cache_add(FmIcon* icon, int size, GdkPixbuf* pix)
+{
+    PixEntry* ent = g_slice_new(PixEntry);
+    GSList* pixs;
+
+    ent->size = size;
+    /* keep a reference on the pixbuf in memory even when no one is using it */
+    ent->pix = pix ? GDK_PIXBUF(g_object_ref(pix)) : NULL;
+    ent->icon = icon;
+    ent->mem_size = sizeof(PixEntry);
+    if(pix)
+        ent->mem_size += gdk_pixbuf_get_rowstride(pix) * gdk_pixbuf_get_height(pix);
+    ent->lru.data = ent;
+    ent->lru.prev = ent->lru.next = NULL;
+    pixs = (GSList*)g_object_steal_qdata(G_OBJECT(icon), fm_qdata_id);
+    pixs = g_slist_prepend(pixs, ent);
+    g_object_set_qdata_full(G_OBJECT(icon), fm_qdata_id, pixs, destroy_pixbufs);
+    g_queue_push_head_link(&pixbuf_lru, &ent->lru);
+    pixbuf_cache_size += ent->mem_size;
+    cache_trim();
+}
+
+static GdkPixbuf* load_fallback(FmIcon* icon, int size, const char *fallback)
+{
+    GdkPixbuf* pix = NULL;
+    char* str = g_icon_to_string(G_ICON(icon));
+
+    g_debug("unable to load icon %s", str);
+    if(fallback)
+        pix = gtk_icon_theme_load_icon(gtk_icon_theme_get_default(), fallback,
+                size, GTK_ICON_LOOKUP_USE_BUILTIN|GTK_ICON_LOOKUP_FORCE_SIZE, NULL);
+    if(pix == NULL) /* still unloadable */
+        pix = gtk_icon_theme_load_icon(gtk_icon_theme_get_default(), "unknown",
+                size, GTK_ICON_LOOKUP_USE_BUILTIN|GTK_ICON_LOOKUP_FORCE_SIZE, NULL);
+    g_free(str);
+    return pix;
+}
+
 /**
  * fm_pixbuf_from_icon
  * @icon: icon descriptor
@@ -80,6 +208,9 @@ GdkPixbuf* fm_pixbuf_from_icon(FmIcon* icon, int size)
  * Creates a #GdkPixbuf and draws icon there. If icon cannot be found then
  * icon with name @fallback will be loaded instead.
  *
+ * Since 1.3.0 loaded images are kept in a cache of limited size and least
+ * recently used ones are unloaded when cache is full.
+ *
  * Returns: (transfer full): an image.
  *
  * Since: 1.2.0
@@ -88,23 +219,11 @@ GdkPixbuf* fm_pixbuf_from_icon_with_fallback(FmIcon* icon, int size, const char
 {
     GtkIconInfo* ii;
     GdkPixbuf* pix = NULL;
-    GSList *pixs, *l;
     PixEntry* ent;
 
-    /* FIXME:
-        1) get/add GQuark for emblem type: no emblem is fm_qdata_id
-        2) get/add GQuark by GQuark in the theme to support multi GdkScreen */
-    pixs = (GSList*)g_object_steal_qdata(G_OBJECT(icon), fm_qdata_id);
-    for( l = pixs; l; l=l->next )
-    {
-        ent = (PixEntry*)l->data;
-        if(ent->size == size) /* cached pixbuf is found! */
-        {
-            /* return stealed data back */
-            g_object_set_qdata_full(G_OBJECT(icon), fm_qdata_id, pixs, destroy_pixbufs);
-            return ent->pix ? GDK_PIXBUF(g_object_ref(ent->pix)) : NULL;
-        }
-    }
+    ent = cache_lookup(icon, size);
+    if(ent) /* cached pixbuf is found! */
+        return ent->pix ? GDK_PIXBUF(g_object_ref(ent->pix)) : NULL;
 
     /* not found! load the icon from disk */
     ii = gtk_icon_theme_lookup_by_gicon(gtk_icon_theme_get_default(), G_ICON(icon), size, GTK_ICON_LOOKUP_FORCE_SIZE);
@@ -112,43 +231,157 @@ GdkPixbuf* fm_pixbuf_from_icon_with_fallback(FmIcon* icon, int size, const char
     {
         pix = gtk_icon_info_load_icon(ii, NULL);
         gtk_icon_info_free(ii);
-
-        /* increase ref_count to keep this pixbuf in memory
-           even when no one is using it. */
-        if(pix)
-            g_object_ref(pix);
     }
     if (pix == NULL)
+        pix = load_fallback(icon, size, fallback);
+
+    /* cache this! */
+    cache_add(icon, size, pix);
+
+    return pix;
+}
+
+static void pix_request_free(PixRequest* req)
+{
+    g_object_unref(req->icon);
+    g_free(req->fallback);
+    if(req->ii)
+        gtk_icon_info_free(req->ii);
+    if(req->pix)
+        g_object_unref(req->pix);
+    g_slice_free(PixRequest, req);
+}
+
+static gboolean on_pixbuf_loaded(gpointer user_data)
+{
+    /* this callback is called from the main thread */
+    PixRequest* req = (PixRequest*)user_data;
+    PixEntry* ent;
+    GdkPixbuf* pix;
+
+    pending_requests = g_list_remove(pending_requests, req);
+    if(req->cancelled)
     {
-        char* str = g_icon_to_string(G_ICON(icon));
-        g_debug("unable to load icon %s", str);
-        if(fallback)
-            pix = gtk_icon_theme_load_icon(gtk_icon_theme_get_default(), fallback,
-                    size, GTK_ICON_LOOKUP_USE_BUILTIN|GTK_ICON_LOOKUP_FORCE_SIZE, NULL);
-        if(pix == NULL) /* still unloadable */
-            pix = gtk_icon_theme_load_icon(gtk_icon_theme_get_default(), "unknown",
-                    size, GTK_ICON_LOOKUP_USE_BUILTIN|GTK_ICON_LOOKUP_FORCE_SIZE, NULL);
-        if(G_LIKELY(pix))
-            g_object_ref(pix);
-        g_free(str);
+        pix_request_free(req);
+        return FALSE;
     }
+    /* some other request might load it already */
+    ent = cache_lookup(req->icon, req->size);
+    if(ent)
+        pix = ent->pix ? GDK_PIXBUF(g_object_ref(ent->pix)) : NULL;
+    else if(req->generation != theme_generation)
+        /* the theme was changed while loading, the image is obsolete */
+        pix = fm_pixbuf_from_icon_with_fallback(req->icon, req->size, req->fallback);
+    else
+    {
+        pix = req->pix;
+        req->pix = NULL;
+        if(pix == NULL)
+            pix = load_fallback(req->icon, req->size, req->fallback);
+        cache_add(req->icon, req->size, pix);
+    }
+    req->func(req->icon, req->size, pix, req->user_data);
+    if(pix)
+        g_object_unref(pix);
+    pix_request_free(req);
+    return FALSE;
+}
 
-    /* cache this! */
-    ent = g_slice_new(PixEntry);
-    ent->size = size;
-    ent->pix = pix;
+static void load_pixbuf_thread(gpointer data, gpointer unused)
+{
+    PixRequest* req = (PixRequest*)data;
 
-    /* FIXME: maybe we should unload icons that nobody is using to reduce memory usage. */
-    /* g_object_weak_ref(); */
-    pixs = g_slist_prepend(pixs, ent);
-    g_object_set_qdata_full(G_OBJECT(icon), fm_qdata_id, pixs, destroy_pixbufs);
+    /* decoding and scaling image is the most expensive part of the work;
+       GtkIconInfo holds a copy of the theme lookup result so loading it
+       doesn't touch the theme, GTK does the same in its own async loader */
+    if(!req->cancelled)
+        req->pix = gtk_icon_info_load_icon(req->ii, NULL);
+    req->idle_handler = g_idle_add_full(G_PRIORITY_LOW, on_pixbuf_loaded, req, NULL);
+}
 
-    return pix;
+/**
+ * fm_pixbuf_from_icon_async
+ * @icon: icon descriptor
+ * @size: size in pixels
+ * @fallback: (allow-none): name of fallback icon
+ * @func: callback to call when image is loaded
+ * @user_data: data to pass to @func
+ *
+ * Retrieves an image for @icon if it is cached already. Otherwise starts
+ * loading the image in background and returns %NULL, the caller may show
+ * some placeholder until @func is called with loaded image. If image for
+ * @icon cannot be loaded then icon with name @fallback is used instead.
+ * All pending calls for @func and @user_data can be cancelled using
+ * fm_pixbuf_cancel_async().
+ *
+ * Returns: (transfer full): an image or %NULL if it is being loaded.
+ *
+ * Since: 1.3.0
+ */
+GdkPixbuf* fm_pixbuf_from_icon_async(FmIcon* icon, int size, const char *fallback,
+                                     FmPixbufReadyFunc func, gpointer user_data)
+{
+    GtkIconInfo* ii = NULL;
+    PixEntry* ent;
+    PixRequest* req;
+
+    ent = cache_lookup(icon, size);
+    if(ent && ent->pix)
+        return GDK_PIXBUF(g_object_ref(ent->pix));
+
+    if(ent == NULL)
+    {
+        /* theme lookup is a fast index search, only loading is done in thread */
+        ii = gtk_icon_theme_lookup_by_gicon(gtk_icon_theme_get_default(), G_ICON(icon), size, GTK_ICON_LOOKUP_FORCE_SIZE);
+        if(ii == NULL || gtk_icon_info_get_filename(ii) == NULL || load_pool == NULL)
+        {
+            /* builtin or missing icon, load it right now */
+            if(ii)
+                gtk_icon_info_free(ii);
+            return fm_pixbuf_from_icon_with_fallback(icon, size, fallback);
+        }
+    }
+    req = g_slice_new0(PixRequest);
+    req->icon = g_object_ref(icon);
+    req->size = size;
+    req->fallback = g_strdup(fallback);
+    req->ii = ii;
+    req->func = func;
+    req->user_data = user_data;
+    req->generation = theme_generation;
+    pending_requests = g_list_prepend(pending_requests, req);
+    if(ii)
+        g_thread_pool_push(load_pool, req, NULL);
+    else /* known to be unloadable, report it as promised */
+        req->idle_handler = g_idle_add_full(G_PRIORITY_LOW, on_pixbuf_loaded, req, NULL);
+    return NULL;
+}
+
+/**
+ * fm_pixbuf_cancel_async
+ * @func: callback which was passed to fm_pixbuf_from_icon_async()
+ * @user_data: data which was passed to fm_pixbuf_from_icon_async()
+ *
+ * Cancels all pending image requests made with @func and @user_data.
+ *
+ * Since: 1.3.0
+ */
+void fm_pixbuf_cancel_async(FmPixbufReadyFunc func, gpointer user_data)
+{
+    GList* l;
+
+    for(l = pending_requests; l; l = l->next)
+    {
+        PixRequest* req = (PixRequest*)l->data;
+        if(req->func == func && req->user_data == user_data)
+            req->cancelled = TRUE;
+    }
 }
 
 static void on_icon_theme_changed(GtkIconTheme* theme, gpointer user_data)
 {
     g_debug("icon theme changed!");
+    theme_generation++;
     /* unload pixbufs cached in FmIcon's hash table. */
     fm_icon_reset_user_data_cache(fm_qdata_id);
     /* FIXME: gtk_icon_theme_has_icon()+gtk_icon_theme_add_builtin_icon() for symlink emblem */
@@ -159,10 +392,33 @@ void _fm_icon_pixbuf_init()
     /* FIXME: GtkIconTheme object is different on different GdkScreen */
     GtkIconTheme* theme = gtk_icon_theme_get_default();
     changed_handler = g_signal_connect(theme, "changed", G_CALLBACK(on_icon_theme_changed), NULL);
+    load_pool = g_thread_pool_new(load_pixbuf_thread, NULL, 2, FALSE, NULL);
 }
 
 void _fm_icon_pixbuf_finalize()
 {
     GtkIconTheme* theme = gtk_icon_theme_get_default();
+    GList* l;
+
     g_signal_handler_disconnect(theme, changed_handler);
+    /* let threads skip loading and wait for them */
+    for(l = pending_requests; l; l = l->next)
+        ((PixRequest*)l->data)->cancelled = TRUE;
+    g_thread_pool_free(load_pool, FALSE, TRUE);
+    load_pool = NULL;
+    /* all requests left are queued in idle handlers now */
+    for(l = pending_requests; l; l = l->next)
+    {
+        PixRequest* req = (PixRequest*)l->data;
+        g_source_remove(req->idle_handler);
+        pix_request_free(req);
+    }
+    g_list_free(pending_requests);
+    pending_requests = NULL;
+}
+
+void _fm_icon_pixbuf_get_stats(guint *n, gsize *size)
+{
+    *n = pixbuf_lru.length;
+    *size = pixbuf_cache_size;
 }
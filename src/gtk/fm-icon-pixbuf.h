@@ -30,10 +30,29 @@ G_BEGIN_DECLS
 
 void _fm_icon_pixbuf_init();
 void _fm_icon_pixbuf_finalize();
+void _fm_icon_pixbuf_get_stats(guint *n, gsize *size);
 
 GdkPixbuf* fm_pixbuf_from_icon(FmIcon* icon, int size);
 GdkPixbuf* fm_pixbuf_from_icon_with_fallback(FmIcon* icon, int size, const char *fallback);
 
+/**
+ * FmPixbufReadyFunc
+ * @icon: icon descriptor
+ * @size: size in pixels
+ * @pix: (allow-none): loaded image
+ * @user_data: data passed to fm_pixbuf_from_icon_async()
+ *
+ * Callback which is called in main thread when image requested by
+ * fm_pixbuf_from_icon_async() is loaded.
+ *
+ * Since: 1.3.0
+ */
+typedef void (*FmPixbufReadyFunc)(FmIcon *icon, int size, GdkPixbuf *pix, gpointer user_data);
+
+GdkPixbuf* fm_pixbuf_from_icon_async(FmIcon* icon, int size, const char *fallback,
+                                     FmPixbufReadyFunc func, gpointer user_data);
+void fm_pixbuf_cancel_async(FmPixbufReadyFunc func, gpointer user_data);
+
 G_END_DECLS
 
 #endif /* __FM_ICON_PIXBUF_H__ */
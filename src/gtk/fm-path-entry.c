@@ -48,8 +48,12 @@
 #include "fm-folder-model.h"
 #include "fm-file.h"
 #include "fm-utils.h"
+#include "fm-folder.h"
+#include "fm-monitor.h"
+#include "fm-dummy-monitor.h"
 
 #include <string.h>
+#include <time.h>
 #include <gio/gio.h>
 #include <gdk/gdkkeysyms.h>
 
@@ -76,6 +80,18 @@ typedef struct _FmPathEntryModel FmPathEntryModel;
 
 typedef struct _FmPathEntryPrivate FmPathEntryPrivate;
 
+/* sorted list of subdirectories of some directory, shared among entries */
+typedef struct
+{
+    FmPath* dir;
+    char** names; /* sorted by strcmp() so names with the same prefix are together */
+    guint n_names;
+    GFileMonitor* mon;
+    time_t expires; /* for directories which cannot be monitored */
+    gint n_ref; /* used only in main thread */
+    gboolean stale; /* directory was changed, entries should list it again */
+}SubDirList;
+
 struct _FmPathEntryPrivate
 {
     FmPath* path;
@@ -99,16 +115,29 @@ struct _FmPathEntryPrivate
 
     /* length of basename typed by the user */
     gint typed_basename_len;
+
+    /* subdirectories of parent dir, NULL if not loaded yet */
+    SubDirList* subdirs;
 };
 
 typedef struct
 {
     FmPathEntry* entry;
+    FmPath* path;
     GFile* dir;
     GList* subdirs;
     GCancellable* cancellable;
 }ListSubDirNames;
 
+/* cache of recently listed directories */
+#define SUB_DIR_CACHE_SIZE 8
+/* how long to keep list of directory which cannot be monitored, in seconds */
+#define SUB_DIR_CACHE_TTL 30
+
+static GQueue sub_dir_cache = G_QUEUE_INIT; /* head is most recently used */
+
+static inline void update_inline_completion(FmPathEntryPrivate* priv);
+
 //static gboolean  fm_path_entry_grab_focus(GtkWidget *widget);
 static gboolean  fm_path_entry_focus_in_event(GtkWidget *widget, GdkEventFocus *event);
 static gboolean  fm_path_entry_focus_out_event(GtkWidget *widget, GdkEventFocus *event);
@@ -200,6 +229,144 @@ static void fm_path_entry_dispatch_properties_changed(GObject *object,
 }
 #endif
 
+static void sub_dir_list_unref(SubDirList* list)
+{
+    if(--list->n_ref > 0)
+        return;
+    fm_path_unref(list->dir);
+    g_strfreev(list->names);
+    g_slice_free(SubDirList, list);
+}
+
+static void sub_dir_cache_remove(SubDirList* list)
+{
+    g_queue_remove(&sub_dir_cache, list);
+    if(list->mon)
+    {
+        g_signal_handlers_disconnect_matched(list->mon, G_SIGNAL_MATCH_DATA,
+                                             0, 0, NULL, NULL, list);
+        g_object_unref(list->mon);
+        list->mon = NULL;
+    }
+    sub_dir_list_unref(list);
+}
+
+static void on_sub_dir_changed(GFileMonitor* mon, GFile* gf, GFile* other,
+                               GFileMonitorEvent evt, SubDirList* list)
+{
+    /* any directory created or removed invalidates the list */
+    if(evt == G_FILE_MONITOR_EVENT_CREATED || evt == G_FILE_MONITOR_EVENT_DELETED)
+    {
+        list->stale = TRUE;
+        sub_dir_cache_remove(list);
+    }
+}
+
+static gint compare_names(gconstpointer a, gconstpointer b)
+{
+    return strcmp(*(char**)a, *(char**)b);
+}
+
+/* takes ownership on array of names, returns new reference */
+static SubDirList* sub_dir_cache_add(FmPath* dir, GPtrArray* names)
+{
+    SubDirList* list = g_slice_new0(SubDirList);
+    GFile* gf;
+
+    g_ptr_array_sort(names, compare_names);
+    list->n_names = names->len;
+    g_ptr_array_add(names, NULL);
+    list->names = (char**)g_ptr_array_free(names, FALSE);
+    list->dir = fm_path_ref(dir);
+    list->n_ref = 2; /* one for the cache and one for the caller */
+    gf = fm_path_to_gfile(dir);
+    list->mon = fm_monitor_directory(gf, NULL);
+    g_object_unref(gf);
+    if(list->mon && !FM_IS_DUMMY_MONITOR(list->mon))
+        g_signal_connect(list->mon, "changed", G_CALLBACK(on_sub_dir_changed), list);
+    else
+        list->expires = time(NULL) + SUB_DIR_CACHE_TTL;
+    g_queue_push_head(&sub_dir_cache, list);
+    if(g_queue_get_length(&sub_dir_cache) > SUB_DIR_CACHE_SIZE)
+        sub_dir_cache_remove(g_queue_peek_tail(&sub_dir_cache));
+    return list;
+}
+
+/* returns new reference or NULL */
+static SubDirList* sub_dir_cache_lookup(FmPath* dir)
+{
+    GList* l;
+    FmFolder* folder;
+
+    for(l = sub_dir_cache.head; l; l = l->next)
+    {
+        SubDirList* list = l->data;
+        /* FmPath objects are unique so can be compared as pointers */
+        if(list->dir != dir)
+            continue;
+        if(list->expires && list->expires < time(NULL))
+        {
+            list->stale = TRUE;
+            sub_dir_cache_remove(list);
+            break;
+        }
+        g_queue_unlink(&sub_dir_cache, l);
+        g_queue_push_head_link(&sub_dir_cache, l);
+        list->n_ref++;
+        return list;
+    }
+    /* the folder may be loaded already by some view, folders which are
+       only kept in cache aren't returned as their listing may be stale */
+    folder = fm_folder_find_by_path(dir);
+    if(folder)
+    {
+        SubDirList* list = NULL;
+        if(fm_folder_is_loaded(folder) && fm_folder_is_valid(folder))
+        {
+            GPtrArray* names = g_ptr_array_new();
+            GList* fl;
+            for(fl = fm_file_info_list_peek_head_link(fm_folder_get_files(folder));
+                fl; fl = fl->next)
+                /* use the same name as list_sub_dirs() gets from GIO */
+                if(fm_file_info_is_dir(fl->data))
+                    g_ptr_array_add(names, fm_path_display_basename(fm_file_info_get_path(fl->data)));
+            list = sub_dir_cache_add(dir, names);
+        }
+        g_object_unref(folder);
+        return list;
+    }
+    return NULL;
+}
+
+/* fills model with all subdirectories once per directory, the match
+   function filters them while the user types */
+static void fill_completion_model(FmPathEntryPrivate* priv)
+{
+    SubDirList* list = priv->subdirs;
+    FmPathEntryModel* new_model;
+    guint i;
+
+    new_model = fm_path_entry_model_new(priv->parent_dir);
+    for(i = 0; i < list->n_names; i++)
+        gtk_list_store_insert_with_values((GtkListStore*)new_model, NULL,
+                                          -1, COL_BASENAME, list->names[i], -1);
+    /* the model is filled before it is attached, so completion doesn't
+       refilter it on each inserted row */
+    gtk_entry_completion_set_model(priv->completion, GTK_TREE_MODEL(new_model));
+    if(priv->model)
+        g_object_unref(priv->model);
+    priv->model = new_model;
+}
+
+static void set_sub_dirs(FmPathEntryPrivate* priv, SubDirList* list)
+{
+    priv->subdirs = list;
+    priv->folder_loaded = TRUE;
+    priv->long_list = (list->n_names > 40);
+    fill_completion_model(priv);
+    update_inline_completion(priv);
+}
+
 static gboolean _path_entry_is_single_match(FmPathEntry *entry, FmPathEntryPrivate *priv)
 {
     GtkTreeModel *model = GTK_TREE_MODEL(priv->model);
@@ -363,6 +530,11 @@ static void clear_completion(FmPathEntryPrivate* priv)
         gtk_list_store_clear(GTK_LIST_STORE(priv->model));
         update_inline_completion(priv);
     }
+    if(priv->subdirs)
+    {
+        sub_dir_list_unref(priv->subdirs);
+        priv->subdirs = NULL;
+    }
     priv->typed_basename_len = 0;
 }
 
@@ -410,7 +582,7 @@ static gboolean on_dir_list_finished(gpointer user_data)
     FmPathEntry* entry = data->entry;
     FmPathEntryPrivate *priv  = FM_PATH_ENTRY_GET_PRIVATE(entry);
     GList* l;
-    FmPathEntryModel* new_model;
+    GPtrArray* names;
 
     /* final chance to check cancellable */
     if(g_cancellable_is_cancelled(data->cancellable))
@@ -421,25 +593,17 @@ static gboolean on_dir_list_finished(gpointer user_data)
 #endif
     /* FIXME: check errors! */
 
-    new_model = fm_path_entry_model_new(priv->parent_dir);
     /* g_debug("dir list is finished!"); */
 
-    /* update the model */
+    /* move the names into the cache */
+    names = g_ptr_array_new();
     for(l = data->subdirs; l; l=l->next)
-    {
-        char* name = l->data;
-        gtk_list_store_insert_with_values((GtkListStore*)new_model, NULL, -1, COL_BASENAME, name, -1);
-    }
-    priv->folder_loaded = TRUE;
-    priv->long_list = (g_list_length(data->subdirs) > 40);
-
-    gtk_entry_completion_set_model(priv->completion, GTK_TREE_MODEL(new_model));
-    if(priv->model)
-        g_object_unref(priv->model);
-    priv->model = new_model;
+        g_ptr_array_add(names, l->data);
+    g_list_free(data->subdirs);
+    data->subdirs = NULL;
+    set_sub_dirs(priv, sub_dir_cache_add(data->path, names));
     //if(entry->complete_on_load)
         //explicitly_complete(entry);
-    update_inline_completion(priv);
     gtk_entry_completion_insert_prefix(priv->completion);
     gtk_entry_completion_complete(priv->completion);
 
@@ -518,6 +682,7 @@ static gboolean list_sub_dirs(GIOSchedulerJob *job, GCancellable *cancellable, g
 static void list_sub_dir_names_free(gpointer user_data)
 {
     ListSubDirNames* data = (ListSubDirNames*)user_data;
+    fm_path_unref(data->path);
     g_object_unref(data->dir);
     g_object_unref(data->cancellable);
     g_list_foreach(data->subdirs, (GFunc)g_free, NULL);
@@ -530,6 +695,9 @@ static void fm_path_entry_changed(GtkEditable *editable, gpointer user_data)
     FmPathEntry *entry = FM_PATH_ENTRY(editable);
     FmPathEntryPrivate *priv  = FM_PATH_ENTRY_GET_PRIVATE(entry);
     const gchar *path_str, *sep;
+    SubDirList* list;
+    FmPath* path;
+    GFile* gf;
 #if GLIB_CHECK_VERSION(2, 36, 0)
     GTask *task;
 #endif
@@ -544,10 +712,11 @@ static void fm_path_entry_changed(GtkEditable *editable, gpointer user_data)
         int parent_len = (sep - path_str) + 1; /* includes the dir separator / */
         if(!priv->parent_dir
            || priv->parent_len != parent_len
-           || strncmp(priv->parent_dir, path_str, parent_len ))
+           || strncmp(priv->parent_dir, path_str, parent_len )
+           || (priv->subdirs && priv->subdirs->stale))
         {
             /* parent dir has been changed, reload dir list */
-            ListSubDirNames* data = g_slice_new0(ListSubDirNames);
+            ListSubDirNames* data;
             priv->folder_loaded = FALSE;
             clear_completion(priv);
             priv->parent_dir = g_strndup(path_str, parent_len);
@@ -556,20 +725,34 @@ static void fm_path_entry_changed(GtkEditable *editable, gpointer user_data)
             /* g_debug("parent dir is changed to %s", priv->parent_dir); */
 
             /* FIXME: convert utf-8 encoded path to on-disk encoding. */
-            data->entry = entry;
             if(priv->parent_dir[0] == '~') /* special case for home dir */
             {
                 char* expand = g_strconcat(fm_get_home_dir(), priv->parent_dir + 1, NULL);
-                data->dir = fm_file_new_for_commandline_arg(expand);
+                gf = fm_file_new_for_commandline_arg(expand);
+                path = fm_path_new_for_gfile(gf);
                 g_free(expand);
             }
             else
             {
-                FmPath *p = fm_path_new_for_display_name(priv->parent_dir);
-                data->dir = fm_path_to_gfile(p);
-                fm_path_unref(p);
+                path = fm_path_new_for_display_name(priv->parent_dir);
+                gf = fm_path_to_gfile(path);
             }
 
+            /* try recently listed directories first */
+            list = sub_dir_cache_lookup(path);
+            if(list)
+            {
+                priv->typed_basename_len = strlen(sep + 1);
+                set_sub_dirs(priv, list);
+                fm_path_unref(path);
+                g_object_unref(gf);
+                return;
+            }
+            data = g_slice_new0(ListSubDirNames);
+            data->entry = entry;
+            data->path = path;
+            data->dir = gf;
+
             /* launch a new job to do dir listing */
             if (G_LIKELY(priv->cancellable == NULL))
                 priv->cancellable = g_cancellable_new();
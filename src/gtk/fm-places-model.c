@@ -63,6 +63,8 @@ struct _FmPlacesItem
 {
     FmPlacesType type;
     gboolean mounted : 1; /* used if type == FM_PLACES_ITEM_VOLUME */
+    gboolean stale : 1; /* info wasn't retrieved in time or target failed */
+    gboolean known : 1; /* fi was retrieved by a probe */
     FmPlacesOrder id : 4; /* used if type == FM_PLACES_ITEM_PATH */
     FmIcon* icon;
     FmFileInfo* fi;
@@ -83,6 +85,8 @@ struct _FmPlacesModel
     GtkTreeRowReference* separator;
     GtkTreeRowReference* trash;
     GFileMonitor* trash_monitor;
+    GCancellable* trash_cancellable; /* trash:/// is being queried */
+    gint trash_count; /* maintained from monitor events, -1 if unknown */
     guint trash_idle_handler;
     guint theme_change_handler;
     guint use_trash_change_handler;
@@ -97,9 +101,22 @@ struct _FmPlacesModel
     guint places_unmounted_change_handler;
     GdkPixbuf* eject_icon;
 
-    GSList* jobs;
+    GSList* probes;
 };
 
+/* each path is probed by separate job so unreachable one don't delay
+   other items; if a probe takes too long the item is marked stale */
+typedef struct
+{
+    FmPlacesModel* model;
+    FmFileInfoJob* job;
+    FmPath* path;
+    guint timeout_handler;
+} PlacesProbe;
+
+/* all existing models, their items are looked for last known infos */
+static GSList* all_models = NULL;
+
 struct _FmPlacesModelClass
 {
     GtkListStoreClass parent_class;
@@ -132,84 +149,154 @@ static void place_item_free(FmPlacesItem* item)
     g_slice_free(FmPlacesItem, item);
 }
 
-static void on_file_info_job_finished(FmFileInfoJob* job, gpointer user_data)
+/* sets new file info for the row, updating icon of standard items */
+static void set_item_info(FmPlacesModel* model, GtkTreeIter* it,
+                          FmPlacesItem* item, FmFileInfo* fi)
 {
-    FmPlacesModel* model = FM_PLACES_MODEL(user_data);
-    GList* l;
-    GtkTreeIter it;
-    FmPlacesItem* item;
-    FmFileInfo* fi;
-    FmPath* path;
     FmIcon* icon;
     GdkPixbuf* pix;
 
-    /* g_debug("file info job finished"); */
-    model->jobs = g_slist_remove(model->jobs, job);
-    g_signal_handlers_disconnect_by_func(job, on_file_info_job_finished, model);
-
-    if(!gtk_tree_model_get_iter_first(GTK_TREE_MODEL(model), &it))
-        goto finished;
+    if(item->fi != fi)
+    {
+        fm_file_info_unref(item->fi);
+        item->fi = fm_file_info_ref(fi);
+    }
+    item->known = TRUE;
+    /* only update the icon if the item is not a volume or mount.
+       trash icon depends on trash_count so it's handled separately */
+    if(item->type != FM_PLACES_ITEM_PATH || item->id == FM_PLACES_ID_TRASH)
+        return;
+    icon = fm_file_info_get_icon(fi);
+    /* replace the icon with updated data */
+    if(icon && icon != item->icon)
+    {
+        g_object_unref(item->icon);
+        item->icon = g_object_ref(icon);
+        pix = fm_pixbuf_from_icon(icon, fm_config->pane_icon_size);
+        gtk_list_store_set(GTK_LIST_STORE(model), it,
+                           FM_PLACES_MODEL_COL_ICON, pix, -1);
+        g_object_unref(pix);
+    }
+}
 
-    if(fm_file_info_list_is_empty(job->file_infos))
-        goto finished;
+/* uses info of another row with the same path, in this or another
+   model, for the new row so it looks right from start */
+static void set_last_known_info(FmPlacesModel* model, GtkTreeIter* it,
+                                FmPlacesItem* item, FmPath* path)
+{
+    GSList* l;
+    GtkTreeIter it2;
+    FmPlacesItem* item2;
 
-    /* optimize for one file case */
-    if(fm_file_info_list_get_length(job->file_infos) == 1)
+    for(l = all_models; l; l = l->next)
     {
-        fi = fm_file_info_list_peek_head(job->file_infos);
+        if(!gtk_tree_model_get_iter_first(l->data, &it2))
+            continue;
         do {
-            item = NULL;
-            gtk_tree_model_get(GTK_TREE_MODEL(model), &it, FM_PLACES_MODEL_COL_INFO, &item, -1);
-            if( item && item->fi && (path = fm_file_info_get_path(item->fi)) && fm_path_equal(path, fm_file_info_get_path(fi)) )
+            item2 = NULL;
+            gtk_tree_model_get(l->data, &it2, FM_PLACES_MODEL_COL_INFO, &item2, -1);
+            if(item2 && item2 != item && item2->known &&
+               fm_path_equal(fm_file_info_get_path(item2->fi), path))
             {
-                fm_file_info_unref(item->fi);
-                item->fi = fm_file_info_ref(fi);
-                break;
+                set_item_info(model, it, item, item2->fi);
+                return;
             }
-        }while(gtk_tree_model_iter_next(GTK_TREE_MODEL(model), &it));
+        } while(gtk_tree_model_iter_next(l->data, &it2));
     }
-    else
-    {
-        do {
-            item = NULL;
-            gtk_tree_model_get(GTK_TREE_MODEL(model), &it, FM_PLACES_MODEL_COL_INFO, &item, -1);
-            if( item && item->fi && (path = fm_file_info_get_path(item->fi)) )
-            {
-                for(l = fm_file_info_list_peek_head_link(job->file_infos); l; l = l->next )
-                {
-                    fi = FM_FILE_INFO(l->data);
-                    if(fm_path_equal(path, fm_file_info_get_path(fi)))
-                    {
-                        fm_file_info_unref(item->fi);
-                        item->fi = fm_file_info_ref(fi);
-                        /* only update the icon if the item is not a volume or mount. */
-                        if(item->type == FM_PLACES_ITEM_PATH)
-                        {
-                            icon = fm_file_info_get_icon(fi);
-                            /* replace the icon with updated data */
-                            if(icon && icon != item->icon)
-                            {
-                                g_object_unref(item->icon);
-                                item->icon = g_object_ref(icon);
-                                pix = fm_pixbuf_from_icon(icon, fm_config->pane_icon_size);
-                                gtk_list_store_set(GTK_LIST_STORE(model), &it,
-                                                   FM_PLACES_MODEL_COL_ICON, pix, -1);
-                            }
-                        }
-                        /* remove the file from list to speed up further loading.
-                         * This won't cause problem since nobody else if using the list. */
-                        fm_file_info_list_delete_link(job->file_infos, l);
-                        break;
-                    }
-                }
-            }
-        }while(gtk_tree_model_iter_next(GTK_TREE_MODEL(model), &it));
+}
+
+/* updates every row which shows the path, fi may be NULL if failed */
+static void update_path_state(FmPlacesModel* model, FmPath* path,
+                              FmFileInfo* fi, gboolean stale)
+{
+    GtkTreeIter it;
+    GtkTreePath* tp;
+    FmPlacesItem* item;
+    FmPath* item_path;
+
+    if(!gtk_tree_model_get_iter_first(GTK_TREE_MODEL(model), &it))
+        return;
+    do {
+        item = NULL;
+        gtk_tree_model_get(GTK_TREE_MODEL(model), &it, FM_PLACES_MODEL_COL_INFO, &item, -1);
+        if(!item || !item->fi || !(item_path = fm_file_info_get_path(item->fi)) ||
+           !fm_path_equal(item_path, path))
+            continue;
+        if(fi)
+            set_item_info(model, &it, item, fi);
+        if(item->stale != stale)
+        {
+            item->stale = stale;
+            tp = gtk_tree_model_get_path(GTK_TREE_MODEL(model), &it);
+            gtk_tree_model_row_changed(GTK_TREE_MODEL(model), tp, &it);
+            gtk_tree_path_free(tp);
+        }
+    } while(gtk_tree_model_iter_next(GTK_TREE_MODEL(model), &it));
+}
+
+static void on_probe_finished(FmFileInfoJob* job, PlacesProbe* probe);
+
+static void places_probe_free(PlacesProbe* probe)
+{
+    if(probe->timeout_handler)
+        g_source_remove(probe->timeout_handler);
+    g_signal_handlers_disconnect_by_func(probe->job, on_probe_finished, probe);
+    g_object_unref(probe->job);
+    fm_path_unref(probe->path);
+    g_slice_free(PlacesProbe, probe);
+}
+
+static void on_probe_finished(FmFileInfoJob* job, PlacesProbe* probe)
+{
+    FmPlacesModel* model = probe->model;
+    FmFileInfo* fi = fm_file_info_list_peek_head(job->file_infos);
+
+    /* g_debug("file info job finished"); */
+    model->probes = g_slist_remove(model->probes, probe);
+    /* failed target is shown stale until it's probed again */
+    update_path_state(model, probe->path, fi, fi == NULL);
+    places_probe_free(probe);
+}
+
+static gboolean on_probe_timeout(gpointer user_data)
+{
+    PlacesProbe* probe = (PlacesProbe*)user_data;
+
+    if(g_source_is_destroyed(g_main_current_source()))
+        return FALSE;
+    probe->timeout_handler = 0;
+    /* let the job finish anyway, the item will be updated then */
+    update_path_state(probe->model, probe->path, NULL, TRUE);
+    return FALSE;
+}
+
+static void probe_path(FmPlacesModel* model, FmPath* path)
+{
+    PlacesProbe* probe;
+    GSList* l;
+
+    for(l = model->probes; l; l = l->next)
+        if(fm_path_equal(((PlacesProbe*)l->data)->path, path))
+            return; /* already in progress */
+    probe = g_slice_new0(PlacesProbe);
+    probe->model = model;
+    probe->path = fm_path_ref(path);
+    probe->job = fm_file_info_job_new(NULL, FM_FILE_INFO_JOB_FOLLOW_SYMLINK);
+    fm_file_info_job_add(probe->job, path);
+    g_signal_connect(probe->job, "finished", G_CALLBACK(on_probe_finished), probe);
+    if (!fm_job_run_async(FM_JOB(probe->job)))
+    {
+        places_probe_free(probe);
+        g_critical("fm_job_run_async() failed on places item update");
+        return;
     }
-finished:
-    g_object_unref(job);
+    model->probes = g_slist_prepend(model->probes, probe);
+    if(fm_config->places_probe_timeout > 0)
+        probe->timeout_handler = gdk_threads_add_timeout_seconds(fm_config->places_probe_timeout,
+                                                                 on_probe_timeout, probe);
 }
 
-static void update_volume_or_mount(FmPlacesModel* model, FmPlacesItem* item, GtkTreeIter* it, FmFileInfoJob* job)
+static void update_volume_or_mount(FmPlacesModel* model, FmPlacesItem* item, GtkTreeIter* it)
 {
     GIcon* gicon;
     char* name;
@@ -253,24 +340,17 @@ static void update_volume_or_mount(FmPlacesModel* model, FmPlacesItem* item, Gtk
 
     if(!fm_path_equal(fm_file_info_get_path(item->fi), path))
     {
+        if(item->known) /* info may be shared with other rows */
+        {
+            fm_file_info_unref(item->fi);
+            item->fi = fm_file_info_new();
+            item->known = FALSE;
+        }
         fm_file_info_set_path(item->fi, path);
         if(path)
         {
-            if(job)
-                fm_file_info_job_add(job, path);
-            else
-            {
-                job = fm_file_info_job_new(NULL, FM_FILE_INFO_JOB_FOLLOW_SYMLINK);
-                fm_file_info_job_add(job, path);
-                model->jobs = g_slist_prepend(model->jobs, job);
-                g_signal_connect(job, "finished", G_CALLBACK(on_file_info_job_finished), model);
-                if (!fm_job_run_async(FM_JOB(job)))
-                {
-                    model->jobs = g_slist_remove(model->jobs, job);
-                    g_object_unref(job);
-                    g_critical("fm_job_run_async() failed on mount update");
-                }
-            }
+            set_last_known_info(model, it, item, path);
+            probe_path(model, path);
             fm_path_unref(path);
         }
         else /* we might get it just unmounted so just reset file info */
@@ -307,8 +387,7 @@ static inline FmPlacesItem* add_new_item(GtkListStore* model, FmPlacesType type,
 
 static FmPlacesItem* new_path_item(GtkListStore* model, GtkTreeIter* it,
                                    FmPath* path, FmPlacesOrder id,
-                                   const char* label, const char* icon_name,
-                                   FmFileInfoJob* job)
+                                   const char* label, const char* icon_name)
 {
     FmPlacesItem* item = g_slice_new0(FmPlacesItem);
     FmPlacesItem* tst;
@@ -345,22 +424,8 @@ _added:
                        FM_PLACES_MODEL_COL_ICON, pix, -1);
     g_object_unref(pix);
     fm_file_info_set_path(item->fi, path);
-    if(job)
-        fm_file_info_job_add(job, path);
-    else
-    {
-        FmPlacesModel* self = FM_PLACES_MODEL(model);
-        job = fm_file_info_job_new(NULL, FM_FILE_INFO_JOB_FOLLOW_SYMLINK);
-        fm_file_info_job_add(job, path);
-        g_signal_connect(job, "finished", G_CALLBACK(on_file_info_job_finished), model);
-        self->jobs = g_slist_prepend(self->jobs, job);
-        if (!fm_job_run_async(FM_JOB(job)))
-        {
-            self->jobs = g_slist_remove(self->jobs, job);
-            g_object_unref(job);
-            g_critical("fm_job_run_async() failed on update '%s'", label);
-        }
-    }
+    set_last_known_info(FM_PLACES_MODEL(model), it, item, path);
+    probe_path(FM_PLACES_MODEL(model), path);
     return item;
 }
 
@@ -384,7 +449,7 @@ static void remove_path_item(GtkListStore* model, FmPlacesOrder id)
     } while(gtk_tree_model_iter_next(GTK_TREE_MODEL(model), &it));
 }
 
-static void add_volume_or_mount(FmPlacesModel* model, GObject* volume_or_mount, FmFileInfoJob* job)
+static void add_volume_or_mount(FmPlacesModel* model, GObject* volume_or_mount)
 {
     FmPlacesItem* item;
     GtkTreePath* tp;
@@ -408,7 +473,7 @@ static void add_volume_or_mount(FmPlacesModel* model, GObject* volume_or_mount,
         /* NOTE: this is impossible, unless a bug exists */
         return;
     }
-    update_volume_or_mount(model, item, &it, job);
+    update_volume_or_mount(model, item, &it);
 }
 
 static FmPlacesItem* find_volume(FmPlacesModel* model, GVolume* volume, GtkTreeIter* _it)
@@ -479,13 +544,13 @@ static void on_volume_added(GVolumeMonitor* vm, GVolume* volume, gpointer user_d
                 g_object_unref(item->mount);
                 item->type = FM_PLACES_ITEM_VOLUME;
                 item->volume = g_object_ref(volume);
-                update_volume_or_mount(model, item, &it, NULL);
+                update_volume_or_mount(model, item, &it);
             }
             g_object_unref(mount);
         }
     }
     if(!item)
-        add_volume_or_mount(model, G_OBJECT(volume), NULL);
+        add_volume_or_mount(model, G_OBJECT(volume));
 }
 
 static void on_volume_removed(GVolumeMonitor* vm, GVolume* volume, gpointer user_data)
@@ -509,7 +574,7 @@ static void on_volume_changed(GVolumeMonitor* vm, GVolume* volume, gpointer user
     /* g_debug("vol-changed"); */
     item = find_volume(model, volume, &it);
     if(item)
-        update_volume_or_mount(model, item, &it, NULL);
+        update_volume_or_mount(model, item, &it);
 }
 
 static void on_mount_added(GVolumeMonitor* vm, GMount* mount, gpointer user_data)
@@ -532,7 +597,7 @@ static void on_mount_added(GVolumeMonitor* vm, GMount* mount, gpointer user_data
             GtkTreePath* tp;
 
             /* we need full update for it to get adequate context menu */
-            update_volume_or_mount(model, item, &it, NULL);
+            update_volume_or_mount(model, item, &it);
             /* inform the view to update mount indicator */
             tp = gtk_tree_model_get_path(GTK_TREE_MODEL(model), &it);
             gtk_tree_model_row_changed(GTK_TREE_MODEL(model), tp, &it);
@@ -540,7 +605,7 @@ static void on_mount_added(GVolumeMonitor* vm, GMount* mount, gpointer user_data
         }
         else if (!item)
             /* we might not get volume for it yet or ignored it before */
-            add_volume_or_mount(model, G_OBJECT(mount), NULL);
+            add_volume_or_mount(model, G_OBJECT(mount));
         g_object_unref(vol);
     }
     else /* network mounts and others */
@@ -551,7 +616,7 @@ static void on_mount_added(GVolumeMonitor* vm, GMount* mount, gpointer user_data
          * signals and added a device more than one. So, make a sanity check here. */
         item = find_mount(model,  mount, &it);
         if(!item)
-            add_volume_or_mount(model, G_OBJECT(mount), NULL);
+            add_volume_or_mount(model, G_OBJECT(mount));
     }
 }
 
@@ -562,7 +627,7 @@ static void on_mount_changed(GVolumeMonitor* vm, GMount* mount, gpointer user_da
     GtkTreeIter it;
     item = find_mount(model, mount, &it);
     if(item)
-        update_volume_or_mount(model, item, &it, NULL);
+        update_volume_or_mount(model, item, &it);
 }
 
 static void on_mount_removed(GVolumeMonitor* vm, GMount* mount, gpointer user_data)
@@ -583,7 +648,7 @@ static void on_mount_removed(GVolumeMonitor* vm, GMount* mount, gpointer user_da
     }
 }
 
-static void add_bookmarks(FmPlacesModel* model, FmFileInfoJob* job)
+static void add_bookmarks(FmPlacesModel* model)
 {
     FmPlacesItem* item;
     GList *bms, *l;
@@ -601,7 +666,6 @@ static void add_bookmarks(FmPlacesModel* model, FmFileInfoJob* job)
 
         item = add_new_item(GTK_LIST_STORE(model), FM_PLACES_ITEM_PATH, &it, NULL);
         fm_file_info_set_path(item->fi, path);
-        fm_file_info_job_add(job, path);
         if(fm_path_is_native(path))
         {
             item->icon = g_object_ref(icon);
@@ -622,6 +686,8 @@ static void add_bookmarks(FmPlacesModel* model, FmFileInfoJob* job)
         gtk_list_store_set(GTK_LIST_STORE(model), &it,
                            FM_PLACES_MODEL_COL_ICON, pix,
                            FM_PLACES_MODEL_COL_LABEL, bm->name, -1);
+        set_last_known_info(model, &it, item, path);
+        probe_path(model, path);
     }
     g_list_free(bms);
     g_object_unref(folder_pix);
@@ -637,7 +703,6 @@ static void add_bookmarks(FmPlacesModel* model, FmFileInfoJob* job)
 static void on_bookmarks_changed(FmBookmarks* bm, gpointer user_data)
 {
     FmPlacesModel* model = FM_PLACES_MODEL(user_data);
-    FmFileInfoJob* job = fm_file_info_job_new(NULL, FM_FILE_INFO_JOB_FOLLOW_SYMLINK);
     GtkTreePath* tp = gtk_tree_row_reference_get_path(model->separator);
     GtkTreeIter it;
 
@@ -649,63 +714,170 @@ static void on_bookmarks_changed(FmBookmarks* bm, gpointer user_data)
         while(gtk_list_store_remove(GTK_LIST_STORE(model), &it))
             continue;
     }
-    add_bookmarks(model, job);
+    add_bookmarks(model);
+}
+
+static void update_trash_icon(FmPlacesModel* model)
+{
+    FmIcon* icon;
+    FmPlacesItem* item = NULL;
+    GdkPixbuf* pix;
+    GtkTreePath* tp;
+    GtkTreeIter it;
+
+    if(model->trash == NULL || model->trash_count < 0)
+        return;
+    tp = gtk_tree_row_reference_get_path(model->trash);
+    if(tp == NULL)
+        return;
+    icon = fm_icon_from_name(model->trash_count > 0 ? "user-trash-full" : "user-trash");
+    gtk_tree_model_get_iter(GTK_TREE_MODEL(model), &it, tp);
+    gtk_tree_path_free(tp);
+    gtk_tree_model_get(GTK_TREE_MODEL(model), &it, FM_PLACES_MODEL_COL_INFO, &item, -1);
+    if(item->icon == icon)
+    {
+        g_object_unref(icon);
+        return;
+    }
+    if(item->icon)
+        g_object_unref(item->icon);
+    item->icon = icon;
+    /* update the icon */
+    pix = fm_pixbuf_from_icon(item->icon, fm_config->pane_icon_size);
+    gtk_list_store_set(GTK_LIST_STORE(model), &it, FM_PLACES_MODEL_COL_ICON, pix, -1);
+    g_object_unref(pix);
+}
+
+static void on_trash_changed(GFileMonitor *monitor, GFile *gf, GFile *other, GFileMonitorEvent evt, gpointer user_data);
+
+static void add_trash_item(FmPlacesModel* model)
+{
+    GtkTreeIter it;
+    GtkTreePath* trash_path;
+    GFile* gf;
+
+    gf = fm_file_new_for_uri("trash:///");
+    model->trash_monitor = fm_monitor_directory(gf, NULL);
+    if(model->trash_monitor)
+        g_signal_connect(model->trash_monitor, "changed", G_CALLBACK(on_trash_changed), model);
+    g_object_unref(gf);
+
+    new_path_item(GTK_LIST_STORE(model), &it, fm_path_get_trash(),
+                  FM_PLACES_ID_TRASH, _("Trash Can"), "user-trash");
+    trash_path = gtk_tree_model_get_path(GTK_TREE_MODEL(model), &it);
+    model->trash = gtk_tree_row_reference_new(GTK_TREE_MODEL(model), trash_path);
+    gtk_tree_path_free(trash_path);
+}
+
+static void on_trash_info_ready(GObject* src, GAsyncResult* res, gpointer user_data)
+{
+    FmPlacesModel* model;
+    GError* err = NULL;
+    GFileInfo* inf = g_file_query_info_finish(G_FILE(src), res, &err);
+
+    if(inf == NULL)
+    {
+        gboolean cancelled = (err->domain == G_IO_ERROR && err->code == G_IO_ERROR_CANCELLED);
+        g_error_free(err);
+        if(cancelled) /* model may be already destroyed */
+            return;
+    }
+    model = FM_PLACES_MODEL(user_data);
+    g_object_unref(model->trash_cancellable);
+    model->trash_cancellable = NULL;
+    if(inf == NULL) /* trash isn't supported, or count will be updated later */
+        return;
+    model->trash_count = g_file_info_get_attribute_uint32(inf, G_FILE_ATTRIBUTE_TRASH_ITEM_COUNT);
+    g_object_unref(inf);
+    if(model->trash == NULL && fm_config->use_trash && fm_config->places_trash)
+        add_trash_item(model);
+    update_trash_icon(model);
+}
 
-    g_signal_connect(job, "finished", G_CALLBACK(on_file_info_job_finished), model);
-    model->jobs = g_slist_prepend(model->jobs, job);
-    if (!fm_job_run_async(FM_JOB(job)))
+/* (re)queries trash:/// in background, trash item is added on success */
+static void query_trash(FmPlacesModel* model)
+{
+    GFile* gf;
+
+    if(model->trash_cancellable)
     {
-        model->jobs = g_slist_remove(model->jobs, job);
-        g_object_unref(job);
-        g_critical("fm_job_run_async() failed for bookmark update");
+        g_cancellable_cancel(model->trash_cancellable);
+        g_object_unref(model->trash_cancellable);
     }
+    model->trash_cancellable = g_cancellable_new();
+    gf = fm_file_new_for_uri("trash:///");
+    g_file_query_info_async(gf, G_FILE_ATTRIBUTE_TRASH_ITEM_COUNT, 0,
+                            G_PRIORITY_LOW, model->trash_cancellable,
+                            on_trash_info_ready, model);
+    g_object_unref(gf);
 }
 
-static gboolean update_trash_item(gpointer user_data)
+static gboolean on_trash_requery_idle(gpointer user_data)
 {
     FmPlacesModel* model = FM_PLACES_MODEL(user_data);
-    if(!g_source_is_destroyed(g_main_current_source()) &&
-       fm_config->use_trash && model->trash)
+    if(!g_source_is_destroyed(g_main_current_source()))
     {
-        GFile* gf = fm_file_new_for_uri("trash:///");
-        GFileInfo* inf = g_file_query_info(gf, G_FILE_ATTRIBUTE_TRASH_ITEM_COUNT, 0, NULL, NULL);
-        g_object_unref(gf);
-        if(inf)
-        {
-            FmIcon* icon;
-            const char* icon_name;
-            FmPlacesItem* item = NULL;
-            GdkPixbuf* pix;
-            GtkTreePath* tp = gtk_tree_row_reference_get_path(model->trash);
-            GtkTreeIter it;
-            guint32 n = g_file_info_get_attribute_uint32(inf, G_FILE_ATTRIBUTE_TRASH_ITEM_COUNT);
-
-            g_object_unref(inf);
-            g_assert(tp != NULL); /* FIXME: how can tp be invalid here? */
-            icon_name = n > 0 ? "user-trash-full" : "user-trash";
-            icon = fm_icon_from_name(icon_name);
-            gtk_tree_model_get_iter(GTK_TREE_MODEL(model), &it, tp);
-            gtk_tree_model_get(GTK_TREE_MODEL(model), &it, FM_PLACES_MODEL_COL_INFO, &item, -1);
-            if(item->icon)
-                g_object_unref(item->icon);
-            item->icon = icon;
-            /* update the icon */
-            pix = fm_pixbuf_from_icon(item->icon, fm_config->pane_icon_size);
-            gtk_list_store_set(GTK_LIST_STORE(model), &it, FM_PLACES_MODEL_COL_ICON, pix, -1);
-            g_object_unref(pix);
-            gtk_tree_path_free(tp);
-        }
+        model->trash_idle_handler = 0;
+        query_trash(model);
     }
     return FALSE;
 }
 
-
 static void on_trash_changed(GFileMonitor *monitor, GFile *gf, GFile *other, GFileMonitorEvent evt, gpointer user_data)
 {
     FmPlacesModel* model = FM_PLACES_MODEL(user_data);
+    GFile* root;
+    gboolean is_item;
+    gint delta;
+
+    /* maintain item count from events on direct trash items, other
+       events or unknown count require the trash to be queried again */
+    switch(evt)
+    {
+    case G_FILE_MONITOR_EVENT_CREATED:
+#if GLIB_CHECK_VERSION(2, 46, 0)
+    case G_FILE_MONITOR_EVENT_MOVED_IN:
+#endif
+        delta = 1;
+        break;
+    case G_FILE_MONITOR_EVENT_DELETED:
+#if GLIB_CHECK_VERSION(2, 46, 0)
+    case G_FILE_MONITOR_EVENT_MOVED_OUT:
+#endif
+        delta = -1;
+        break;
+    case G_FILE_MONITOR_EVENT_CHANGED:
+    case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+    case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+        delta = 0;
+        break;
+    default:
+        delta = G_MININT;
+    }
+    if(delta == 0)
+        return;
+    if(delta != G_MININT)
+    {
+        /* only items in trash:/// itself are counted, not their content */
+        root = fm_file_new_for_uri("trash:///");
+        is_item = g_file_has_parent(gf, root);
+        g_object_unref(root);
+        if(!is_item)
+            return;
+    }
+    if(delta != G_MININT && model->trash_count >= 0)
+    {
+        model->trash_count += delta;
+        /* verify the trash is empty indeed before showing it so */
+        if(model->trash_count > 0)
+        {
+            update_trash_icon(model);
+            return;
+        }
+    }
     if(model->trash_idle_handler)
         g_source_remove(model->trash_idle_handler);
-    model->trash_idle_handler = gdk_threads_add_idle(update_trash_item, model);
+    model->trash_idle_handler = gdk_threads_add_idle(on_trash_requery_idle, model);
 }
 
 static void update_icons(FmPlacesModel* model)
@@ -740,7 +912,10 @@ static void on_use_trash_changed(FmConfig* cfg, gpointer user_data)
 {
     FmPlacesModel* model = FM_PLACES_MODEL(user_data);
     if(cfg->use_trash && cfg->places_trash && model->trash == NULL)
-        create_trash_item(model);
+    {
+        if(model->trash_cancellable == NULL)
+            create_trash_item(model);
+    }
     else if((!cfg->use_trash || !cfg->places_trash) && model->trash)
     {
         FmPlacesItem *item = NULL;
@@ -767,6 +942,13 @@ static void on_use_trash_changed(FmConfig* cfg, gpointer user_data)
             model->trash_idle_handler = 0;
         }
     }
+    if((!cfg->use_trash || !cfg->places_trash) && model->trash_cancellable)
+    {
+        /* stop creation of trash item */
+        g_cancellable_cancel(model->trash_cancellable);
+        g_object_unref(model->trash_cancellable);
+        model->trash_cancellable = NULL;
+    }
 }
 
 static void on_places_home_changed(FmConfig* cfg, gpointer user_data)
@@ -778,7 +960,7 @@ static void on_places_home_changed(FmConfig* cfg, gpointer user_data)
         FmPath* path = fm_path_get_home();
 
         new_path_item(model, &it, path, FM_PLACES_ID_HOME,
-                      _("Home Folder"), "user-home", NULL);
+                      _("Home Folder"), "user-home");
     }
     else
     {
@@ -794,7 +976,7 @@ static void on_places_desktop_changed(FmConfig* cfg, gpointer user_data)
        g_file_test(g_get_user_special_dir(G_USER_DIRECTORY_DESKTOP), G_FILE_TEST_IS_DIR))
     {
         new_path_item(model, &it, fm_path_get_desktop(), FM_PLACES_ID_DESKTOP,
-                      _("Desktop"), "user-desktop", NULL);
+                      _("Desktop"), "user-desktop");
     }
     else
     {
@@ -813,7 +995,7 @@ static void on_places_applications_changed(FmConfig* cfg, gpointer user_data)
     {
         new_path_item(model, &it, fm_path_get_apps_menu(),
                       FM_PLACES_ID_APPLICATIONS, _("Applications"),
-                      "system-software-install", NULL);
+                      "system-software-install");
     }
     else
     {
@@ -828,7 +1010,7 @@ static void on_places_root_changed(FmConfig* cfg, gpointer user_data)
     if(cfg->places_root)
     {
         new_path_item(model, &it, fm_path_get_root(), FM_PLACES_ID_ROOT,
-                      _("Filesystem Root"), "drive-harddisk", NULL);
+                      _("Filesystem Root"), "drive-harddisk");
     }
     else
     {
@@ -845,7 +1027,7 @@ static void on_places_computer_changed(FmConfig* cfg, gpointer user_data)
         FmPath* path = fm_path_new_for_uri("computer:///");
 
         new_path_item(model, &it, path, FM_PLACES_ID_COMPUTER,
-                      _("Devices"), "computer", NULL);
+                      _("Devices"), "computer");
         fm_path_unref(path);
     }
     else
@@ -863,7 +1045,7 @@ static void on_places_network_changed(FmConfig* cfg, gpointer user_data)
         FmPath* path = fm_path_new_for_uri("network:///");
 
         new_path_item(model, &it, path, FM_PLACES_ID_NETWORK,
-                      _("Network"), GTK_STOCK_NETWORK, NULL);
+                      _("Network"), GTK_STOCK_NETWORK);
         fm_path_unref(path);
     }
     else
@@ -880,28 +1062,9 @@ static void on_pane_icon_size_changed(FmConfig* cfg, gpointer user_data)
 
 static void create_trash_item(FmPlacesModel* model)
 {
-    GtkTreeIter it;
-    GtkTreePath* trash_path;
-    GFile* gf;
-
-    gf = fm_file_new_for_uri("trash:///");
-    if (!g_file_query_exists(gf, NULL))
-    {
-        g_object_unref(gf);
-        return;
-    }
-    model->trash_monitor = fm_monitor_directory(gf, NULL);
-    g_signal_connect(model->trash_monitor, "changed", G_CALLBACK(on_trash_changed), model);
-    g_object_unref(gf);
-
-    new_path_item(GTK_LIST_STORE(model), &it, fm_path_get_trash(),
-                  FM_PLACES_ID_TRASH, _("Trash Can"), "user-trash", NULL);
-    trash_path = gtk_tree_model_get_path(GTK_TREE_MODEL(model), &it);
-    model->trash = gtk_tree_row_reference_new(GTK_TREE_MODEL(model), trash_path);
-    gtk_tree_path_free(trash_path);
-
-    if(0 == model->trash_idle_handler)
-        model->trash_idle_handler = gdk_threads_add_idle(update_trash_item, model);
+    /* trash:/// may be unsupported or slow so test it in background */
+    model->trash_count = -1;
+    query_trash(model);
 }
 
 static void on_places_unmounted_changed(FmConfig* cfg, gpointer user_data)
@@ -910,11 +1073,8 @@ static void on_places_unmounted_changed(FmConfig* cfg, gpointer user_data)
     GVolume *vol;
     FmPlacesItem *item;
     GList *vols, *l;
-    FmFileInfoJob *job = NULL;
     GtkTreeIter it;
 
-    if (cfg->places_unmounted)
-        job = fm_file_info_job_new(NULL, FM_FILE_INFO_JOB_NONE);
     vols = g_volume_monitor_get_volumes(model->vol_mon);
     for (l = vols; l; l = l->next)
     {
@@ -929,20 +1089,9 @@ static void on_places_unmounted_changed(FmConfig* cfg, gpointer user_data)
             }
         }
         else if (cfg->places_unmounted) /* not found but should be added */
-            add_volume_or_mount(model, G_OBJECT(vol), job);
+            add_volume_or_mount(model, G_OBJECT(vol));
         g_object_unref(vol);
     }
-    if (job)
-    {
-        g_signal_connect(job, "finished", G_CALLBACK(on_file_info_job_finished), model);
-        model->jobs = g_slist_prepend(model->jobs, job);
-        if (!fm_job_run_async(FM_JOB(job)))
-        {
-            model->jobs = g_slist_remove(model->jobs, job);
-            g_object_unref(job);
-            g_critical("fm_job_run_async() failed on volumes update");
-        }
-    }
     g_list_free(vols);
 }
 
@@ -952,12 +1101,12 @@ static void fm_places_model_init(FmPlacesModel *self)
     GtkTreeIter it;
     GList *vols, *l;
     FmIcon *icon;
-    FmFileInfoJob* job = fm_file_info_job_new(NULL, FM_FILE_INFO_JOB_FOLLOW_SYMLINK);
     GtkListStore* model = &self->parent;
     FmPath *path;
     GtkTreePath* tp;
 
     gtk_list_store_set_column_types(&self->parent, FM_PLACES_MODEL_N_COLS, types);
+    all_models = g_slist_prepend(all_models, self);
 
     self->theme_change_handler = g_signal_connect_swapped(gtk_icon_theme_get_default(), "changed",
                                             G_CALLBACK(update_icons), self);
@@ -992,7 +1141,7 @@ static void fm_places_model_init(FmPlacesModel *self)
     {
         path = fm_path_get_home();
         new_path_item(model, &it, path, FM_PLACES_ID_HOME,
-                      _("Home Folder"), "user-home", job);
+                      _("Home Folder"), "user-home");
     }
 
     /* Only show desktop in side pane when the user has a desktop dir. */
@@ -1000,20 +1149,20 @@ static void fm_places_model_init(FmPlacesModel *self)
        g_file_test(g_get_user_special_dir(G_USER_DIRECTORY_DESKTOP), G_FILE_TEST_IS_DIR))
     {
         new_path_item(model, &it, fm_path_get_desktop(), FM_PLACES_ID_DESKTOP,
-                      _("Desktop"), "user-desktop", job);
+                      _("Desktop"), "user-desktop");
     }
 
     if(fm_config->places_root)
     {
         new_path_item(model, &it, fm_path_get_root(), FM_PLACES_ID_ROOT,
-                      _("Filesystem Root"), "drive-harddisk", job);
+                      _("Filesystem Root"), "drive-harddisk");
     }
 
     if(fm_config->places_computer)
     {
         path = fm_path_new_for_uri("computer:///");
         new_path_item(model, &it, path, FM_PLACES_ID_COMPUTER,
-                      _("Devices"), "computer", job);
+                      _("Devices"), "computer");
         fm_path_unref(path);
     }
 
@@ -1021,14 +1170,14 @@ static void fm_places_model_init(FmPlacesModel *self)
     {
         new_path_item(model, &it, fm_path_get_apps_menu(),
                       FM_PLACES_ID_APPLICATIONS, _("Applications"),
-                      "system-software-install", job);
+                      "system-software-install");
     }
 
     if(fm_config->places_network)
     {
         path = fm_path_new_for_uri("network:///");
         new_path_item(model, &it, path, FM_PLACES_ID_NETWORK,
-                      _("Network"), GTK_STOCK_NETWORK, job);
+                      _("Network"), GTK_STOCK_NETWORK);
         fm_path_unref(path);
     }
 
@@ -1062,7 +1211,7 @@ static void fm_places_model_init(FmPlacesModel *self)
         for(l=vols;l;l=l->next)
         {
             GVolume* vol = G_VOLUME(l->data);
-            add_volume_or_mount(self, G_OBJECT(vol), job);
+            add_volume_or_mount(self, G_OBJECT(vol));
             g_object_unref(vol);
         }
         g_list_free(vols);
@@ -1077,7 +1226,7 @@ static void fm_places_model_init(FmPlacesModel *self)
         if(volume)
             g_object_unref(volume);
         else /* network mounts or others */
-            add_volume_or_mount(self, G_OBJECT(mount), job);
+            add_volume_or_mount(self, G_OBJECT(mount));
         g_object_unref(mount);
     }
     g_list_free(vols);
@@ -1087,16 +1236,7 @@ static void fm_places_model_init(FmPlacesModel *self)
         g_signal_connect(self->bookmarks, "changed", G_CALLBACK(on_bookmarks_changed), self);
 
     /* add bookmarks to side pane */
-    add_bookmarks(self, job);
-
-    g_signal_connect(job, "finished", G_CALLBACK(on_file_info_job_finished), self);
-    self->jobs = g_slist_prepend(self->jobs, job);
-    if (!fm_job_run_async(FM_JOB(job)))
-    {
-        self->jobs = g_slist_remove(self->jobs, job);
-        g_object_unref(job);
-        g_critical("fm_job_run_async() failed on places view init");
-    }
+    add_bookmarks(self);
 }
 
 /**
@@ -1253,17 +1393,19 @@ static void fm_places_model_dispose(GObject *object)
     g_return_if_fail(FM_IS_PLACES_MODEL(object));
     self = (FmPlacesModel*)object;
 
-    if(self->jobs)
+    all_models = g_slist_remove(all_models, self);
+
+    if(self->probes)
     {
         GSList* l;
-        for(l = self->jobs; l; l=l->next)
+        for(l = self->probes; l; l=l->next)
         {
-            g_signal_handlers_disconnect_by_func(l->data, on_file_info_job_finished, self);
-            fm_job_cancel(FM_JOB(l->data));
-            g_object_unref(l->data);
+            PlacesProbe* probe = (PlacesProbe*)l->data;
+            fm_job_cancel(FM_JOB(probe->job));
+            places_probe_free(probe);
         }
-        g_slist_free(self->jobs);
-        self->jobs = NULL;
+        g_slist_free(self->probes);
+        self->probes = NULL;
     }
 
     if(gtk_tree_model_get_iter_first(GTK_TREE_MODEL(self), &it))
@@ -1371,6 +1513,13 @@ static void fm_places_model_dispose(GObject *object)
         self->trash_idle_handler = 0;
     }
 
+    if(self->trash_cancellable)
+    {
+        g_cancellable_cancel(self->trash_cancellable);
+        g_object_unref(self->trash_cancellable);
+        self->trash_cancellable = NULL;
+    }
+
     if(self->eject_icon)
         g_object_unref(self->eject_icon);
     self->eject_icon = NULL;
@@ -1492,6 +1641,23 @@ gboolean fm_places_item_is_mounted(FmPlacesItem* item)
     return item->mounted ? TRUE : FALSE;
 }
 
+/**
+ * fm_places_item_is_stale
+ * @item: a places model item
+ *
+ * Checks if information about the row target was not retrieved in time
+ * or retrieving it failed, so the row shows last known state which may
+ * be out of date, and the target may be unreachable.
+ *
+ * Returns: %TRUE if the row target seems unavailable.
+ *
+ * Since: 1.3.0
+ */
+gboolean fm_places_item_is_stale(FmPlacesItem* item)
+{
+    return item->stale ? TRUE : FALSE;
+}
+
 /**
  * fm_places_item_get_icon
  * @item: a places model item
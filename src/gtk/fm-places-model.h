@@ -107,6 +107,8 @@ FmPlacesType fm_places_item_get_type(FmPlacesItem* item);
 
 gboolean fm_places_item_is_mounted(FmPlacesItem* item);
 
+gboolean fm_places_item_is_stale(FmPlacesItem* item);
+
 FmIcon* fm_places_item_get_icon(FmPlacesItem* item);
 
 FmFileInfo* fm_places_item_get_info(FmPlacesItem* item);
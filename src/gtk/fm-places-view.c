@@ -475,6 +475,17 @@ static void fm_places_view_finalize(GObject *object)
     G_OBJECT_CLASS(fm_places_view_parent_class)->finalize(object);
 }
 
+/* unreachable items are shown insensitive */
+static void label_cell_data_func(GtkCellLayout *cell_layout, GtkCellRenderer *render,
+                                 GtkTreeModel *tree_model, GtkTreeIter *it,
+                                 gpointer user_data)
+{
+    FmPlacesItem* item = NULL;
+
+    gtk_tree_model_get(tree_model, it, FM_PLACES_MODEL_COL_INFO, &item, -1);
+    g_object_set(render, "sensitive", !(item && fm_places_item_is_stale(item)), NULL);
+}
+
 static void fm_places_view_init(FmPlacesView *self)
 {
     GtkTreeViewColumn* col;
@@ -511,6 +522,8 @@ static void fm_places_view_init(FmPlacesView *self)
     g_object_set(renderer, "ellipsize", PANGO_ELLIPSIZE_END, NULL);
     gtk_tree_view_column_set_attributes( col, renderer,
                                          "text", FM_PLACES_MODEL_COL_LABEL, NULL );
+    gtk_cell_layout_set_cell_data_func(GTK_CELL_LAYOUT(col), renderer,
+                                       label_cell_data_func, NULL, NULL);
 
     renderer = gtk_cell_renderer_pixbuf_new();
     self->mount_indicator_renderer = GTK_CELL_RENDERER_PIXBUF(renderer);
@@ -38,12 +38,15 @@
 #include <glib/gi18n-lib.h>
 
 #define SHOW_DLG_DELAY  1000
+#define ERRORS_PER_KIND 3 /* more similar errors are summarized */
 
 enum
 {
     RESPONSE_OVERWRITE = 1,
     RESPONSE_RENAME,
-    RESPONSE_SKIP
+    RESPONSE_SKIP,
+    RESPONSE_NEWER,
+    RESPONSE_KEEP_BOTH
 };
 
 struct _FmProgressDisplay
@@ -118,14 +121,18 @@ static FmJobErrorAction on_error(FmFileOpsJob* job, GError* err, FmJobErrorSever
 */
 
     gtk_text_buffer_get_end_iter(data->error_buf, &it);
-    if(data->cur_file == NULL)
-        g_warning("FmProgressDialog on_error: assertion `cur_file != NULL' failed");
-    if(data->cur_file || data->old_cur_file)
+    /* warnings are summaries, not related to the current file, and the
+       error may come after the file was already shown as done */
+    if(severity > FM_JOB_ERROR_WARNING)
     {
-        gtk_text_buffer_insert_with_tags(data->error_buf, &it,
-                                     data->cur_file ? data->cur_file : data->old_cur_file,
-                                     -1, data->bold_tag, NULL);
-        gtk_text_buffer_insert(data->error_buf, &it, _(": "), -1);
+        const char* cur_file = data->cur_file ? data->cur_file : data->old_cur_file;
+
+        if(cur_file)
+        {
+            gtk_text_buffer_insert_with_tags(data->error_buf, &it, cur_file,
+                                             -1, data->bold_tag, NULL);
+            gtk_text_buffer_insert(data->error_buf, &it, _(": "), -1);
+        }
     }
     gtk_text_buffer_insert(data->error_buf, &it, err->message, -1);
     gtk_text_buffer_insert(data->error_buf, &it, "\n", 1);
@@ -174,7 +181,7 @@ static gint on_ask_rename(FmFileOpsJob* job, FmFileInfo* src, FmFileInfo* dest,
     gboolean no_valid_dest;
 
     /* return default operation if the user has set it */
-    if(data->default_opt)
+    if(data->default_opt & fm_file_ops_job_get_options(job))
         return data->default_opt;
 
     no_valid_dest = (fm_file_info_get_desc(dest) == NULL);
@@ -259,6 +266,17 @@ static gint on_ask_rename(FmFileOpsJob* job, FmFileInfo* src, FmFileInfo* dest,
         GtkWidget *widget = GTK_WIDGET(gtk_builder_get_object(builder, "skip"));
         gtk_widget_destroy(widget);
     }
+    /* these are offered only for conflicts deferred to the end of job */
+    if (!(options & FM_FILE_OP_NEWER) || no_valid_dest)
+    {
+        GtkWidget *widget = GTK_WIDGET(gtk_builder_get_object(builder, "newer"));
+        gtk_widget_destroy(widget);
+    }
+    if (!(options & FM_FILE_OP_KEEP_BOTH) || no_valid_dest)
+    {
+        GtkWidget *widget = GTK_WIDGET(gtk_builder_get_object(builder, "keep_both"));
+        gtk_widget_destroy(widget);
+    }
 
     tmp = g_filename_display_name(fm_path_get_basename(path));
     gtk_entry_set_text(filename, tmp);
@@ -280,13 +298,20 @@ static gint on_ask_rename(FmFileOpsJob* job, FmFileInfo* src, FmFileInfo* dest,
     case RESPONSE_SKIP:
         res = FM_FILE_OP_SKIP;
         break;
+    case RESPONSE_NEWER:
+        res = FM_FILE_OP_NEWER;
+        break;
+    case RESPONSE_KEEP_BOTH:
+        res = FM_FILE_OP_KEEP_BOTH;
+        break;
     default:
         res = FM_FILE_OP_CANCEL;
     }
 
     if(gtk_toggle_button_get_active(apply_all))
     {
-        if(res == RESPONSE_OVERWRITE || res == FM_FILE_OP_SKIP)
+        if(res == RESPONSE_OVERWRITE || res == FM_FILE_OP_SKIP ||
+           res == FM_FILE_OP_NEWER || res == FM_FILE_OP_KEEP_BOTH)
             data->default_opt = res;
     }
 
@@ -729,6 +754,7 @@ FmProgressDisplay* fm_file_ops_job_run_with_progress(GtkWindow* parent, FmFileOp
     g_signal_connect(job, "finished", G_CALLBACK(on_finished), data);
     g_signal_connect(job, "cancelled", G_CALLBACK(on_cancelled), data);
 
+    fm_file_ops_job_set_error_limit(job, ERRORS_PER_KIND);
     if (!fm_job_run_async(FM_JOB(job)))
     {
         fm_progress_display_destroy(data);
@@ -44,6 +44,9 @@
 #include "fm-mime-type.h"
 #include "fm-file-info-job.h"
 #include "glib-compat.h"
+#include "fm-trace.h"
+#include "fm-folder-snapshot.h"
+#include "fm-fs-cache.h"
 
 #include "fm-file-info.h"
 
@@ -61,6 +64,21 @@ static gboolean fm_dir_list_job_run(FmJob *job);
 static void fm_dir_list_job_finished(FmJob* job);
 
 static gboolean emit_found_files(gpointer user_data);
+static void add_found_files(FmDirListJob* job, GSList* files);
+
+/* same as gfile_info_query_attribs plus the entity tag of the folder */
+static const char dir_query_attribs[] = "standard::*,unix::*,time::*,access::*,id::filesystem,etag::value";
+
+/* number of files passed to the main thread at once */
+#define DIR_LIST_BATCH_SIZE 256
+
+typedef struct
+{
+    char* etag; /* entity tag of the directory taken before listing */
+} FmDirListJobPrivate;
+
+#define FM_DIR_LIST_JOB_GET_PRIVATE(job) \
+    G_TYPE_INSTANCE_GET_PRIVATE((job), FM_TYPE_DIR_LIST_JOB, FmDirListJobPrivate)
 
 static void fm_dir_list_job_class_init(FmDirListJobClass *klass)
 {
@@ -73,6 +91,8 @@ static void fm_dir_list_job_class_init(FmDirListJobClass *klass)
     job_class->run = fm_dir_list_job_run;
     job_class->finished = fm_dir_list_job_finished;
 
+    g_type_class_add_private(klass, sizeof(FmDirListJobPrivate));
+
     /**
      * FmDirListJob::files-found
      * @job: a job that emitted the signal
@@ -199,6 +219,9 @@ static void fm_dir_list_job_dispose(GObject *object)
         job->files_to_add = NULL;
     }
 
+    g_free(FM_DIR_LIST_JOB_GET_PRIVATE(job)->etag);
+    FM_DIR_LIST_JOB_GET_PRIVATE(job)->etag = NULL;
+
     if (G_OBJECT_CLASS(fm_dir_list_job_parent_class)->dispose)
         (* G_OBJECT_CLASS(fm_dir_list_job_parent_class)->dispose)(object);
 }
@@ -335,11 +358,12 @@ static gboolean fm_dir_list_job_run_gio(FmDirListJob* job)
     GError *err = NULL;
     FmJob* fmjob = FM_JOB(job);
     GFile* gf;
+    FmPath* dir;
     const char* query;
 
     gf = fm_path_to_gfile(job->dir_path);
 _retry:
-    inf = g_file_query_info(gf, gfile_info_query_attribs, 0, fm_job_get_cancellable(fmjob), &err);
+    inf = g_file_query_info(gf, dir_query_attribs, 0, fm_job_get_cancellable(fmjob), &err);
     if(!inf )
     {
         FmJobErrorAction act = fm_job_emit_error(fmjob, err, FM_JOB_ERROR_MODERATE);
@@ -371,9 +395,11 @@ _retry:
     }
 
     /* check if FS is R/O and set attr. into inf */
-    _fm_file_info_job_update_fs_readonly(gf, inf, NULL, NULL);
+    _fm_fs_cache_set_readonly_attr(gf, inf, NULL, NULL);
 
     job->dir_fi = fm_file_info_new_from_g_file_data(gf, inf, job->dir_path);
+    /* the tag is taken before listing so any change made later is seen */
+    FM_DIR_LIST_JOB_GET_PRIVATE(job)->etag = g_strdup(g_file_info_get_etag(inf));
     g_object_unref(inf);
 
     if(G_UNLIKELY(job->flags & FM_DIR_LIST_JOB_DIR_ONLY))
@@ -393,13 +419,26 @@ _retry:
     g_object_unref(gf);
     if(enu)
     {
+        GFileAttributeInfoList *settable = NULL;
+        gboolean is_real, settable_known = FALSE;
+        GSList *found = NULL;
+        guint n_found = 0;
+
+        /* virtual folders may return children not within them */
+        dir = fm_path_new_for_gfile(g_file_enumerator_get_container(enu));
+        is_real = fm_path_equal(job->dir_path, dir);
+        if (is_real)
+        {
+            fm_path_unref(dir);
+            dir = fm_path_ref(job->dir_path);
+        }
         while( ! fm_job_is_cancelled(fmjob) )
         {
             inf = g_file_enumerator_next_file(enu, fm_job_get_cancellable(fmjob), &err);
             if(inf)
             {
-                FmPath *dir, *sub;
-                GFile *child;
+                FmPath *sub;
+                GFile *child = NULL;
                 if(G_UNLIKELY(job->flags & FM_DIR_LIST_JOB_DIR_ONLY))
                 {
                     /* FIXME: handle symlinks */
@@ -410,23 +449,43 @@ _retry:
                     }
                 }
 
-                /* virtual folders may return children not within them */
-                dir = fm_path_new_for_gfile(g_file_enumerator_get_container(enu));
-                if (fm_path_equal(job->dir_path, dir))
-                    sub = fm_path_new_child(job->dir_path, g_file_info_get_name(inf));
-                else
-                    sub = fm_path_new_child(dir, g_file_info_get_name(inf));
-                child = g_file_get_child(g_file_enumerator_get_container(enu),
-                                         g_file_info_get_name(inf));
+                /* build path from the parent, don't parse URI again */
+                sub = fm_path_new_child(dir, g_file_info_get_name(inf));
+                /* all files of real folder are handled by the same backend
+                   so have the same settable attributes, query them once;
+                   GFile of file is needed only for that and for subdirs */
+                if (!is_real || !settable_known ||
+                    g_file_info_get_file_type(inf) == G_FILE_TYPE_DIRECTORY)
+                    child = g_file_get_child(g_file_enumerator_get_container(enu),
+                                             g_file_info_get_name(inf));
                 if (g_file_info_get_file_type(inf) == G_FILE_TYPE_DIRECTORY)
                     /* for dir: check if its FS is R/O and set attr. into inf */
-                    _fm_file_info_job_update_fs_readonly(child, inf, NULL, NULL);
-                fi = fm_file_info_new_from_g_file_data(child, inf, sub);
+                    _fm_fs_cache_set_readonly_attr(child, inf, NULL, NULL);
+                if (is_real)
+                {
+                    if (!settable_known)
+                    {
+                        settable = g_file_query_settable_attributes(child, NULL, NULL);
+                        settable_known = TRUE;
+                    }
+                    fi = _fm_file_info_new_from_g_file_info(sub, inf, settable);
+                }
+                else
+                    fi = fm_file_info_new_from_g_file_data(child, inf, sub);
                 fm_path_unref(sub);
-                fm_path_unref(dir);
-                g_object_unref(child);
-                fm_dir_list_job_add_found_file(job, fi);
-                fm_file_info_unref(fi);
+                if (child)
+                    g_object_unref(child);
+                g_object_unref(inf);
+                found = g_slist_prepend(found, fi);
+                /* pass files to the folder in batches, not one by one */
+                if (++n_found == DIR_LIST_BATCH_SIZE)
+                {
+                    found = g_slist_reverse(found);
+                    add_found_files(job, found);
+                    g_slist_free_full(found, (GDestroyNotify)fm_file_info_unref);
+                    found = NULL;
+                    n_found = 0;
+                }
             }
             else
             {
@@ -434,6 +493,7 @@ _retry:
                 {
                     FmJobErrorAction act = fm_job_emit_error(fmjob, err, FM_JOB_ERROR_MILD);
                     g_error_free(err);
+                    err = NULL;
                     /* FM_JOB_RETRY is not supported. */
                     if(act == FM_JOB_ABORT)
                         fm_job_cancel(fmjob);
@@ -441,12 +501,17 @@ _retry:
                 /* otherwise it's EOL */
                 break;
             }
-            g_object_unref(inf);
         }
+        found = g_slist_reverse(found);
+        add_found_files(job, found);
+        g_slist_free_full(found, (GDestroyNotify)fm_file_info_unref);
+        if (settable)
+            g_file_attribute_info_list_unref(settable);
+        fm_path_unref(dir);
         g_file_enumerator_close(enu, NULL, &err);
         g_object_unref(enu);
     }
-    else
+    if(!enu)
     {
         fm_job_emit_error(fmjob, err, FM_JOB_ERROR_CRITICAL);
         g_error_free(err);
@@ -535,6 +600,12 @@ FmFileInfoList* fm_dir_list_job_get_files(FmDirListJob* job)
     return job->files;
 }
 
+/* returns entity tag of the directory taken before listing, may be NULL */
+const char* _fm_dir_list_job_get_etag(FmDirListJob* job)
+{
+    return FM_DIR_LIST_JOB_GET_PRIVATE(job)->etag;
+}
+
 #ifndef FM_DISABLE_DEPRECATED
 /**
  * fm_dir_dist_job_get_files
@@ -582,6 +653,34 @@ static gpointer queue_add_file(FmJob* fmjob, gpointer user_data)
     return NULL;
 }
 
+static gpointer queue_add_files(FmJob* fmjob, gpointer user_data)
+{
+    FmDirListJob* job = FM_DIR_LIST_JOB(fmjob);
+    GSList* l;
+    /* this callback is called from the main thread */
+    for(l = user_data; l; l = l->next)
+        job->files_to_add = g_slist_prepend(job->files_to_add, fm_file_info_ref(l->data));
+    if(job->delay_add_files_handler == 0)
+        job->delay_add_files_handler = g_timeout_add_seconds_full(G_PRIORITY_LOW,
+                        1, emit_found_files, g_object_ref(job), g_object_unref);
+    return NULL;
+}
+
+/* the same as fm_dir_list_job_add_found_file() but does single call to
+   the main thread for the whole list of files */
+static void add_found_files(FmDirListJob* job, GSList* files)
+{
+    GSList* l;
+
+    if(files == NULL)
+        return;
+    FM_TRACE2(folder__load__batch, job, g_slist_length(files));
+    for(l = files; l; l = l->next)
+        fm_file_info_list_push_tail(job->files, l->data);
+    if(G_UNLIKELY(job->emit_files_found))
+        fm_job_call_main_thread(FM_JOB(job), queue_add_files, files);
+}
+
 /**
  * fm_dir_list_job_add_found_file
  * @job: the job that collected listing
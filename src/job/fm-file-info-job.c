@@ -40,6 +40,7 @@
 #include <errno.h>
 
 #include "fm-file-info.h"
+#include "fm-fs-cache.h"
 
 static void fm_file_info_job_dispose              (GObject *object);
 static gboolean fm_file_info_job_run(FmJob* fmjob);
@@ -242,7 +243,11 @@ static gboolean fm_file_info_job_run(FmJob* fmjob)
             GFile* gf;
 
             gf = fm_path_to_gfile(path);
-            if(!_fm_file_info_job_get_info_for_gfile(fmjob, fi, gf, &err))
+            /* R/O state of the filesystem is taken from cache instead of
+               querying it for each file */
+            if(!_fm_file_info_job_get_info_for_gfile_real(fmjob, fi, gf,
+                                                          _fm_fs_cache_set_readonly_attr,
+                                                          &err))
             {
               if(err->domain == G_IO_ERROR && err->code == G_IO_ERROR_NOT_MOUNTED)
               {
@@ -124,19 +124,31 @@ _fm_file_info_job_update_fs_readonly(GFile *gf, GFileInfo *inf, GCancellable *ca
     return FALSE;
 }
 
+/* update_fs_readonly is called to set filesystem::readonly in the info */
 static inline gboolean
-_fm_file_info_job_get_info_for_gfile(FmJob* job, FmFileInfo* fi, GFile* gf, GError** err)
+_fm_file_info_job_get_info_for_gfile_real(FmJob* job, FmFileInfo* fi, GFile* gf,
+                                          gboolean (*update_fs_readonly)(GFile*, GFileInfo*,
+                                                                         GCancellable*, GError**),
+                                          GError** err)
 {
     GFileInfo *inf;
     inf = g_file_query_info(gf, gfile_info_query_attribs, (GFileQueryInfoFlags)0, fm_job_get_cancellable(job), err);
     if( !inf )
         return FALSE;
-    _fm_file_info_job_update_fs_readonly(gf, inf, NULL, NULL);
+    update_fs_readonly(gf, inf, NULL, NULL);
     fm_file_info_set_from_g_file_data(fi, gf, inf);
     g_object_unref(inf);
 
     return TRUE;
 }
+
+static inline gboolean
+_fm_file_info_job_get_info_for_gfile(FmJob* job, FmFileInfo* fi, GFile* gf, GError** err)
+{
+    return _fm_file_info_job_get_info_for_gfile_real(job, fi, gf,
+                                                     _fm_file_info_job_update_fs_readonly,
+                                                     err);
+}
 #endif /* __GTK_DOC_IGNORE__ */
 
 G_END_DECLS
@@ -30,6 +30,22 @@
 #include "fm-file-ops-job-change-attr.h"
 #include "fm-folder.h"
 
+#if defined(HAVE_FCHMODAT) && defined(HAVE_FCHOWNAT) && defined(HAVE_FDOPENDIR) \
+    && GLIB_CHECK_VERSION(2, 32, 0)
+#define NATIVE_WALK 1
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+#endif
+
 static const char query[] =  G_FILE_ATTRIBUTE_STANDARD_TYPE","
                                G_FILE_ATTRIBUTE_STANDARD_NAME","
                                G_FILE_ATTRIBUTE_UNIX_GID","
@@ -37,6 +53,26 @@ static const char query[] =  G_FILE_ATTRIBUTE_STANDARD_TYPE","
                                G_FILE_ATTRIBUTE_UNIX_MODE","
                                G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME;
 
+static guint32 _fm_file_ops_job_new_mode(FmFileOpsJob* job, guint32 mode,
+                                         gboolean is_dir)
+{
+    mode &= ~job->new_mode_mask;
+    mode |= (job->new_mode & job->new_mode_mask);
+
+    /* FIXME: this behavior should be optional. */
+    /* treat dirs with 'r' as 'rx' */
+    if(is_dir)
+    {
+        if((job->new_mode_mask & S_IRUSR) && (mode & S_IRUSR))
+            mode |= S_IXUSR;
+        if((job->new_mode_mask & S_IRGRP) && (mode & S_IRGRP))
+            mode |= S_IXGRP;
+        if((job->new_mode_mask & S_IROTH) && (mode & S_IROTH))
+            mode |= S_IXOTH;
+    }
+    return mode;
+}
+
 static gboolean _fm_file_ops_job_change_attr_file(FmFileOpsJob* job, GFile* gf,
                                                   GFileInfo* inf, FmFolder *folder)
 {
@@ -48,6 +84,7 @@ static gboolean _fm_file_ops_job_change_attr_file(FmFileOpsJob* job, GFile* gf,
     gboolean ret = TRUE;
     gboolean changed = FALSE;
 
+    _fm_file_ops_job_set_error_file(job, gf);
     if( !inf)
     {
 _retry_query_info:
@@ -108,20 +145,7 @@ _retry_change_group:
     if( !fm_job_is_cancelled(fmjob) && job->new_mode_mask )
     {
         guint32 mode = g_file_info_get_attribute_uint32(inf, G_FILE_ATTRIBUTE_UNIX_MODE);
-        mode &= ~job->new_mode_mask;
-        mode |= (job->new_mode & job->new_mode_mask);
-
-        /* FIXME: this behavior should be optional. */
-        /* treat dirs with 'r' as 'rx' */
-        if(type == G_FILE_TYPE_DIRECTORY)
-        {
-            if((job->new_mode_mask & S_IRUSR) && (mode & S_IRUSR))
-                mode |= S_IXUSR;
-            if((job->new_mode_mask & S_IRGRP) && (mode & S_IRGRP))
-                mode |= S_IXGRP;
-            if((job->new_mode_mask & S_IROTH) && (mode & S_IROTH))
-                mode |= S_IXOTH;
-        }
+        mode = _fm_file_ops_job_new_mode(job, mode, type == G_FILE_TYPE_DIRECTORY);
 
         /* new mode */
 _retry_chmod:
@@ -283,10 +307,412 @@ _retry_enum_children:
     return ret;
 }
 
+#ifdef NATIVE_WALK
+/* Native backend for recursive change of owner and mode on local files.
+ * Directories are read with fdopendir() and their entries are changed
+ * with fchownat() and fchmodat() relative to the directory descriptor,
+ * so no path is resolved again for each file. Subdirectories are passed
+ * to a pool of threads so independent subtrees are processed in parallel,
+ * but when too many descriptors are open then the subdirectory is walked
+ * by the same thread instead. There is no counting pass, the total is
+ * estimated from the average size of directories read so far. */
+
+#define WALK_MAX_THREADS        4
+#define WALK_MAX_OPEN_DIRS      256 /* descriptors held by queued dirs */
+#define WALK_REPORT_INTERVAL    100000 /* microseconds */
+
+typedef struct
+{
+    FmFileOpsJob* job;
+    GThreadPool* pool;
+    GMutex mutex; /* protects all counters and the deferred list */
+    GCond cond;
+    guint n_tasks; /* directories queued or being read by pool */
+    guint n_open; /* descriptors held by queued directories */
+    guint64 n_sources;
+    guint64 n_done; /* files changed */
+    guint64 n_dirs_pending; /* opened but not read yet */
+    guint64 n_dirs_read;
+    guint64 n_entries_read; /* also of directories being read now */
+    GSList* deferred; /* of WalkDeferred */
+    GMutex report_mutex; /* serializes calls into main thread */
+    gint64 last_report;
+} WalkContext;
+
+typedef struct
+{
+    int fd;
+    char* path; /* for error messages */
+    FmPath* fm_path;
+    guint depth;
+} WalkDir;
+
+/* directory which would become inaccessible for us before walking it */
+typedef struct
+{
+    char* path;
+    guint depth;
+    mode_t mode;
+    dev_t dev; /* to test it is still the same directory */
+    ino_t ino;
+} WalkDeferred;
+
+static void walk_dir(WalkContext* ctx, WalkDir* dir);
+
+static void walk_dir_free(WalkDir* dir)
+{
+    g_free(dir->path);
+    fm_path_unref(dir->fm_path);
+    g_slice_free(WalkDir, dir);
+}
+
+/* returns TRUE if the operation should be retried */
+static gboolean walk_error(WalkContext* ctx, int errnum, const char* path)
+{
+    char* disp = g_filename_display_name(path);
+    GError* err = g_error_new(G_IO_ERROR, g_io_error_from_errno(errnum),
+                              "%s: %s", disp, g_strerror(errnum));
+    GFile* gf = g_file_new_for_path(path);
+    FmJobErrorAction act;
+
+    g_free(disp);
+    g_mutex_lock(&ctx->report_mutex);
+    _fm_file_ops_job_set_error_file(ctx->job, gf);
+    act = fm_job_emit_error(FM_JOB(ctx->job), err, FM_JOB_ERROR_MILD);
+    g_mutex_unlock(&ctx->report_mutex);
+    g_object_unref(gf);
+    g_error_free(err);
+    return (act == FM_JOB_RETRY);
+}
+
+/* updates progress but not more often than each WALK_REPORT_INTERVAL */
+static void walk_report(WalkContext* ctx, const char* name)
+{
+    FmFileOpsJob* job = ctx->job;
+    gint64 now = g_get_monotonic_time();
+    char* disp;
+
+    /* if another thread is reporting then skip it */
+    if(!g_mutex_trylock(&ctx->report_mutex))
+        return;
+    if(now - ctx->last_report < WALK_REPORT_INTERVAL)
+    {
+        g_mutex_unlock(&ctx->report_mutex);
+        return;
+    }
+    ctx->last_report = now;
+    g_mutex_lock(&ctx->mutex);
+    job->finished = ctx->n_done;
+    /* every opened directory is expected to be of the average size */
+    job->total = ctx->n_sources + ctx->n_entries_read;
+    if(ctx->n_dirs_read > 0)
+        job->total += ctx->n_dirs_pending * ctx->n_entries_read / ctx->n_dirs_read;
+    if(job->total < job->finished)
+        job->total = job->finished;
+    g_mutex_unlock(&ctx->mutex);
+    disp = g_filename_display_name(name);
+    fm_file_ops_job_emit_cur_file(job, disp);
+    g_free(disp);
+    fm_file_ops_job_emit_percent(job);
+    g_mutex_unlock(&ctx->report_mutex);
+}
+
+/* changes owner and mode of @name in directory @dfd */
+static void walk_change(WalkContext* ctx, int dfd, const char* name,
+                        const char* path, const struct stat* st, guint depth)
+{
+    FmFileOpsJob* job = ctx->job;
+
+    if(job->uid != -1 || job->gid != -1)
+    {
+        while(fchownat(dfd, name, job->uid, job->gid, AT_SYMLINK_NOFOLLOW) < 0)
+            if(!walk_error(ctx, errno, path))
+                break;
+    }
+    /* permissions of symlinks cannot be changed */
+    if(job->new_mode_mask && !S_ISLNK(st->st_mode))
+    {
+        mode_t old_mode = st->st_mode & 07777;
+        mode_t mode = _fm_file_ops_job_new_mode(job, old_mode, S_ISDIR(st->st_mode));
+
+        if(mode == old_mode)
+            return;
+        if(S_ISDIR(st->st_mode) && (mode & (S_IRUSR | S_IXUSR)) != (S_IRUSR | S_IXUSR))
+        {
+            /* we could not walk it after the change, do it at the end */
+            WalkDeferred* item = g_slice_new(WalkDeferred);
+            item->path = g_strdup(path);
+            item->depth = depth;
+            item->mode = mode;
+            item->dev = st->st_dev;
+            item->ino = st->st_ino;
+            g_mutex_lock(&ctx->mutex);
+            ctx->deferred = g_slist_prepend(ctx->deferred, item);
+            g_mutex_unlock(&ctx->mutex);
+            return;
+        }
+        while(fchmodat(dfd, name, mode, 0) < 0)
+            if(!walk_error(ctx, errno, path))
+                break;
+    }
+}
+
+static void walk_thread(gpointer data, gpointer user_data)
+{
+    WalkContext* ctx = (WalkContext*)user_data;
+    WalkDir* dir = (WalkDir*)data;
+
+    g_mutex_lock(&ctx->mutex);
+    ctx->n_open--;
+    g_mutex_unlock(&ctx->mutex);
+    walk_dir(ctx, dir);
+    walk_dir_free(dir);
+    g_mutex_lock(&ctx->mutex);
+    if(--ctx->n_tasks == 0)
+        g_cond_signal(&ctx->cond);
+    g_mutex_unlock(&ctx->mutex);
+}
+
+static void walk_subdir(WalkContext* ctx, WalkDir* parent, int dfd,
+                        const char* name, const char* path)
+{
+    WalkDir* sub;
+    gboolean queued = FALSE;
+    int fd;
+
+    while((fd = openat(dfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC)) < 0)
+        if(!walk_error(ctx, errno, path))
+            return;
+    sub = g_slice_new(WalkDir);
+    sub->fd = fd;
+    sub->path = g_strdup(path);
+    sub->fm_path = fm_path_new_child(parent->fm_path, name);
+    sub->depth = parent->depth + 1;
+    g_mutex_lock(&ctx->mutex);
+    ctx->n_dirs_pending++;
+    if(ctx->n_open < WALK_MAX_OPEN_DIRS)
+    {
+        ctx->n_open++;
+        ctx->n_tasks++;
+        queued = TRUE;
+    }
+    g_mutex_unlock(&ctx->mutex);
+    if(queued)
+        g_thread_pool_push(ctx->pool, sub, NULL);
+    else
+    {
+        walk_dir(ctx, sub);
+        walk_dir_free(sub);
+    }
+}
+
+/* reads directory and changes all its entries, closes dir->fd */
+static void walk_dir(WalkContext* ctx, WalkDir* dir)
+{
+    FmJob* fmjob = FM_JOB(ctx->job);
+    DIR* dirp = fdopendir(dir->fd);
+    struct dirent* de;
+    FmFolder* folder;
+
+    if(dirp == NULL)
+    {
+        walk_error(ctx, errno, dir->path);
+        close(dir->fd);
+        g_mutex_lock(&ctx->mutex);
+        ctx->n_dirs_pending--;
+        g_mutex_unlock(&ctx->mutex);
+        return;
+    }
+    folder = fm_folder_find_by_path(dir->fm_path);
+    while(!fm_job_is_cancelled(fmjob))
+    {
+        struct stat st;
+        char* path;
+
+        errno = 0;
+        de = readdir(dirp);
+        if(de == NULL)
+        {
+            if(errno != 0)
+                walk_error(ctx, errno, dir->path);
+            break;
+        }
+        if(strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)
+            continue;
+        path = g_build_filename(dir->path, de->d_name, NULL);
+        while(fstatat(dirfd(dirp), de->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0)
+            if(!walk_error(ctx, errno, path))
+                goto _next;
+        walk_change(ctx, dirfd(dirp), de->d_name, path, &st, dir->depth + 1);
+        if(folder)
+        {
+            FmPath* sub_path = fm_path_new_child(dir->fm_path, de->d_name);
+            if(!_fm_folder_event_file_changed(folder, sub_path))
+                fm_path_unref(sub_path);
+        }
+        if(S_ISDIR(st.st_mode) && !fm_job_is_cancelled(fmjob))
+            walk_subdir(ctx, dir, dirfd(dirp), de->d_name, path);
+        g_mutex_lock(&ctx->mutex);
+        ctx->n_done++;
+        ctx->n_entries_read++;
+        g_mutex_unlock(&ctx->mutex);
+        walk_report(ctx, de->d_name);
+_next:
+        g_free(path);
+    }
+    closedir(dirp);
+    if(folder)
+        g_object_unref(folder);
+    g_mutex_lock(&ctx->mutex);
+    ctx->n_dirs_pending--;
+    ctx->n_dirs_read++;
+    g_mutex_unlock(&ctx->mutex);
+}
+
+static gint compare_deferred(gconstpointer a, gconstpointer b)
+{
+    const WalkDeferred *da = a, *db = b;
+
+    /* the deepest go first while their parents are still accessible */
+    return (da->depth > db->depth) ? -1 : (da->depth < db->depth);
+}
+
+static void walk_apply_deferred(WalkContext* ctx)
+{
+    GSList* l;
+
+    ctx->deferred = g_slist_sort(ctx->deferred, compare_deferred);
+    for(l = ctx->deferred; l; l = l->next)
+    {
+        WalkDeferred* item = l->data;
+        struct stat st;
+        int fd = -1;
+
+        /* the path is resolved again so it may be replaced with a symlink
+           meanwhile, don't follow it and change the same directory only */
+        while(!fm_job_is_cancelled(FM_JOB(ctx->job)) &&
+              (fd = open(item->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC)) < 0)
+            if(!walk_error(ctx, errno, item->path))
+                break;
+        if(fd >= 0)
+        {
+            if(fstat(fd, &st) == 0 && st.st_dev == item->dev && st.st_ino == item->ino)
+                while(fchmod(fd, item->mode) < 0)
+                    if(!walk_error(ctx, errno, item->path))
+                        break;
+            close(fd);
+        }
+        g_free(item->path);
+        g_slice_free(WalkDeferred, item);
+    }
+    g_slist_free(ctx->deferred);
+    ctx->deferred = NULL;
+}
+
+/* changes @path and everything inside it, waits for pool to finish */
+static void walk_source(WalkContext* ctx, FmPath* path)
+{
+    char* file = fm_path_to_str(path);
+    FmPath* parent = fm_path_get_parent(path);
+    FmFolder* folder = parent ? fm_folder_find_by_path(parent) : NULL;
+    struct stat st;
+    int fd;
+
+    while(lstat(file, &st) < 0)
+        if(!walk_error(ctx, errno, file))
+            goto _out;
+    walk_change(ctx, AT_FDCWD, file, file, &st, 0);
+    if(folder)
+    {
+        if(!_fm_folder_event_file_changed(folder, fm_path_ref(path)))
+            fm_path_unref(path);
+    }
+    g_mutex_lock(&ctx->mutex);
+    ctx->n_done++;
+    g_mutex_unlock(&ctx->mutex);
+    if(!S_ISDIR(st.st_mode) || fm_job_is_cancelled(FM_JOB(ctx->job)))
+        goto _out;
+    while((fd = open(file, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC)) < 0)
+        if(!walk_error(ctx, errno, file))
+            goto _out;
+    {
+        WalkDir top;
+
+        top.fd = fd;
+        top.path = file;
+        top.fm_path = path;
+        top.depth = 0;
+        g_mutex_lock(&ctx->mutex);
+        ctx->n_dirs_pending++;
+        g_mutex_unlock(&ctx->mutex);
+        /* this thread takes part in the walk too */
+        walk_dir(ctx, &top);
+    }
+    g_mutex_lock(&ctx->mutex);
+    while(ctx->n_tasks > 0)
+        g_cond_wait(&ctx->cond, &ctx->mutex);
+    g_mutex_unlock(&ctx->mutex);
+_out:
+    if(folder)
+        g_object_unref(folder);
+    g_free(file);
+}
+
+static gboolean _fm_file_ops_job_change_attr_native(FmFileOpsJob* job)
+{
+    WalkContext ctx;
+    GList* l;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.job = job;
+    ctx.n_sources = fm_path_list_get_length(job->srcs);
+    g_mutex_init(&ctx.mutex);
+    g_cond_init(&ctx.cond);
+    g_mutex_init(&ctx.report_mutex);
+    ctx.pool = g_thread_pool_new(walk_thread, &ctx, WALK_MAX_THREADS, FALSE, NULL);
+    for(l = fm_path_list_peek_head_link(job->srcs);
+        !fm_job_is_cancelled(FM_JOB(job)) && l; l = l->next)
+        walk_source(&ctx, FM_PATH(l->data));
+    /* all tasks are done already so this returns immediately */
+    g_thread_pool_free(ctx.pool, FALSE, TRUE);
+    walk_apply_deferred(&ctx);
+    job->finished = job->total = ctx.n_done;
+    fm_file_ops_job_emit_percent(job);
+    g_mutex_clear(&ctx.report_mutex);
+    g_cond_clear(&ctx.cond);
+    g_mutex_clear(&ctx.mutex);
+    return !fm_job_is_cancelled(FM_JOB(job));
+}
+
+/* native walk can set only owner and mode of local files */
+static gboolean _fm_file_ops_job_can_walk_native(FmFileOpsJob* job)
+{
+    GList* l;
+
+    if(!job->recursive || job->display_name || job->icon ||
+       job->set_hidden >= 0 || job->target)
+        return FALSE;
+    for(l = fm_path_list_peek_head_link(job->srcs); l; l = l->next)
+        if(!fm_path_is_native(FM_PATH(l->data)))
+            return FALSE;
+    return TRUE;
+}
+#endif /* NATIVE_WALK */
+
 gboolean _fm_file_ops_job_change_attr_run(FmFileOpsJob* job)
 {
     GList* l;
 
+#ifdef NATIVE_WALK
+    if(_fm_file_ops_job_can_walk_native(job))
+    {
+        /* the total is estimated while walking */
+        job->total = fm_path_list_get_length(job->srcs);
+        fm_file_ops_job_emit_prepared(job);
+        return _fm_file_ops_job_change_attr_native(job);
+    }
+#endif
+
     /* prepare the job, count total work needed with FmDeepCountJob */
     if(job->recursive)
     {
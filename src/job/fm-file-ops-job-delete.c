@@ -46,6 +46,7 @@ gboolean _fm_file_ops_job_delete_file(FmJob* job, GFile* gf, GFileInfo* inf,
     FmPath *path;
     FmJobErrorAction act;
 
+    _fm_file_ops_job_set_error_file(fjob, gf);
     while(!inf)
     {
         _inf = inf = g_file_query_info(gf, query,
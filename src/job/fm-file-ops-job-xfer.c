@@ -80,6 +80,51 @@ static gboolean _fm_file_ops_job_check_paths(FmFileOpsJob* job, GFile* src, GFil
     return (err == NULL);
 }
 
+/* Deferred conflicts: when fm_file_ops_job_set_defer_conflicts() was
+ * set, files which exist in destination are queued instead of asking the
+ * user and the job goes on. The queue is resolved at the end of the job. */
+typedef struct
+{
+    GFile* src;
+    GFile* dest;
+    gboolean is_move;
+} FmFileOpsConflict;
+
+static void _fm_file_ops_job_defer_conflict(FmFileOpsJob* job, GFile* src,
+                                            GFile* dest, gboolean is_move)
+{
+    FmFileOpsConflict* conflict = g_slice_new(FmFileOpsConflict);
+
+    conflict->src = g_object_ref(src);
+    conflict->dest = g_object_ref(dest);
+    conflict->is_move = is_move;
+    g_queue_push_tail(job->conflicts, conflict);
+}
+
+static void _fm_file_ops_conflict_free(gpointer data)
+{
+    FmFileOpsConflict* conflict = (FmFileOpsConflict*)data;
+
+    g_object_unref(conflict->src);
+    g_object_unref(conflict->dest);
+    g_slice_free(FmFileOpsConflict, conflict);
+}
+
+void _fm_file_ops_job_free_conflicts(FmFileOpsJob* job)
+{
+    if(job->conflicts)
+        g_queue_free_full(job->conflicts, _fm_file_ops_conflict_free);
+    job->conflicts = NULL;
+}
+
+/* existing directory is merged without asking if conflicts are deferred */
+static gboolean _fm_file_ops_job_can_merge(FmFileOpsJob* job, GFile* dest)
+{
+    return job->conflicts != NULL &&
+           g_file_query_file_type(dest, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                  fm_job_get_cancellable(FM_JOB(job))) == G_FILE_TYPE_DIRECTORY;
+}
+
 static gboolean _fm_file_ops_job_copy_file(FmFileOpsJob* job, GFile* src,
                                            GFileInfo* inf, GFile* dest,
                                            FmFolder *src_folder, /* if move */
@@ -101,6 +146,7 @@ static gboolean _fm_file_ops_job_copy_file(FmFileOpsJob* job, GFile* src,
     g_return_val_if_fail(dest != NULL, FALSE);
 
     job->supported_options = FM_FILE_OP_RENAME | FM_FILE_OP_SKIP | FM_FILE_OP_OVERWRITE;
+    _fm_file_ops_job_set_error_file(job, src);
     if( G_LIKELY(inf) )
         g_object_ref(inf);
     else
@@ -145,6 +191,7 @@ _retry_query_src_info:
         {
             GFileEnumerator* enu;
             gboolean dir_created = FALSE;
+            guint n_deferred = job->conflicts ? job->conflicts->length : 0;
 _retry_mkdir:
             if( !fm_job_is_cancelled(fmjob) && !job->skip_dir_content &&
                 !g_file_make_directory(dest, fm_job_get_cancellable(fmjob), &err) )
@@ -160,7 +207,11 @@ _retry_mkdir:
                     err = NULL;
 
                     new_dest = NULL;
-                    opt = _fm_file_ops_job_ask_new_name(job, src, dest, &new_dest, dest_exists);
+                    if(dest_exists && _fm_file_ops_job_can_merge(job, dest))
+                        /* merge directories, conflicts inside are deferred */
+                        opt = FM_FILE_OP_OVERWRITE;
+                    else
+                        opt = _fm_file_ops_job_ask_new_name(job, src, dest, &new_dest, dest_exists);
                     if(!new_dest) /* restoring status quo */
                         new_dest = dest_cp;
                     else if(dest_cp) /* we got new new_dest, forget old one */
@@ -352,6 +403,9 @@ _retry_enum_children:
             }
             if(job->skip_dir_content)
                 delete_src = FALSE;
+            /* files put aside are still in source dir, keep it */
+            if(job->conflicts && job->conflicts->length != n_deferred)
+                delete_src = FALSE;
             if(skip_dir_content)
                 job->skip_dir_content = FALSE;
         }
@@ -410,7 +464,15 @@ _retry_copy:
                 err = NULL;
 
                 new_dest = NULL;
-                opt = _fm_file_ops_job_ask_new_name(job, src, dest, &new_dest, dest_exists);
+                if(dest_exists && job->conflicts)
+                {
+                    /* put it aside and continue with other files */
+                    _fm_file_ops_job_defer_conflict(job, src, dest,
+                                                    job->type == FM_FILE_OP_MOVE);
+                    opt = FM_FILE_OP_SKIP;
+                }
+                else
+                    opt = _fm_file_ops_job_ask_new_name(job, src, dest, &new_dest, dest_exists);
                 if(!new_dest) /* restoring status quo */
                     new_dest = dest_cp;
                 else if(dest_cp) /* we got new new_dest, forget old one */
@@ -494,6 +556,7 @@ gboolean _fm_file_ops_job_move_file(FmFileOpsJob* job, GFile* src,
     GFile* new_dest = NULL;
 
     job->supported_options = FM_FILE_OP_RENAME | FM_FILE_OP_SKIP | FM_FILE_OP_OVERWRITE;
+    _fm_file_ops_job_set_error_file(job, src);
     if( G_LIKELY(inf) )
         g_object_ref(inf);
     else
@@ -538,7 +601,18 @@ _retry_move:
                 FmFileOpOption opt = 0;
 
                 new_dest = NULL;
-                opt = _fm_file_ops_job_ask_new_name(job, src, dest, &new_dest, TRUE);
+                if(job->conflicts && g_file_info_get_file_type(inf) != G_FILE_TYPE_DIRECTORY)
+                {
+                    /* put it aside and continue with other files */
+                    _fm_file_ops_job_defer_conflict(job, src, dest, TRUE);
+                    opt = FM_FILE_OP_SKIP;
+                }
+                else if(g_file_info_get_file_type(inf) == G_FILE_TYPE_DIRECTORY &&
+                        _fm_file_ops_job_can_merge(job, dest))
+                    /* merge directories, conflicts inside are deferred */
+                    opt = FM_FILE_OP_OVERWRITE;
+                else
+                    opt = _fm_file_ops_job_ask_new_name(job, src, dest, &new_dest, TRUE);
                 if(!new_dest) /* restoring status quo */
                     new_dest = dest_cp;
                 else if(dest_cp) /* we got new new_dest, forget old one */
@@ -611,7 +685,11 @@ _retry_move:
                         /* remove source dir after its content is merged with destination dir */
                         if(!g_file_delete(src, fm_job_get_cancellable(fmjob), &err))
                         {
-                            fm_job_emit_error(fmjob, err, FM_JOB_ERROR_MODERATE);
+                            /* files put aside are still there, it will be
+                               removed after they are moved */
+                            if(!job->conflicts || err->domain != G_IO_ERROR ||
+                               err->code != G_IO_ERROR_NOT_EMPTY)
+                                fm_job_emit_error(fmjob, err, FM_JOB_ERROR_MODERATE);
                             g_error_free(err);
                             err = NULL;
                             /* FIXME: should this be recoverable? */
@@ -670,6 +748,207 @@ _retry_move:
     return ret;
 }
 
+/* returns TRUE if @src was modified later than @dest */
+static gboolean _fm_file_ops_job_src_is_newer(FmFileOpsJob* job, GFile* src, GFile* dest)
+{
+    GCancellable* cancellable = fm_job_get_cancellable(FM_JOB(job));
+    GFileInfo *src_inf, *dest_inf;
+    gboolean ret = FALSE;
+
+    src_inf = g_file_query_info(src, G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                                G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, cancellable, NULL);
+    dest_inf = g_file_query_info(dest, G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                                 G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, cancellable, NULL);
+    if(src_inf && dest_inf)
+        ret = (g_file_info_get_attribute_uint64(src_inf, G_FILE_ATTRIBUTE_TIME_MODIFIED) >
+               g_file_info_get_attribute_uint64(dest_inf, G_FILE_ATTRIBUTE_TIME_MODIFIED));
+    if(src_inf)
+        g_object_unref(src_inf);
+    if(dest_inf)
+        g_object_unref(dest_inf);
+    return ret;
+}
+
+/* returns file like "name (2).ext" in the same directory which doesn't
+   exist yet, or NULL if none was found */
+static GFile* _fm_file_ops_job_get_free_name(FmFileOpsJob* job, GFile* dest)
+{
+    GCancellable* cancellable = fm_job_get_cancellable(FM_JOB(job));
+    GFile* parent = g_file_get_parent(dest);
+    char* basename = g_file_get_basename(dest);
+    const char* ext = strrchr(basename, '.');
+    GFile* ret = NULL;
+    guint i;
+
+    if(ext == basename) /* hidden file, not an extension */
+        ext = NULL;
+    for(i = 2; ret == NULL && i < 1000 && !g_cancellable_is_cancelled(cancellable); i++)
+    {
+        char* name;
+
+        if(ext)
+            name = g_strdup_printf("%.*s (%u)%s", (int)(ext - basename), basename, i, ext);
+        else
+            name = g_strdup_printf("%s (%u)", basename, i);
+        ret = g_file_get_child(parent, name);
+        g_free(name);
+        if(g_file_query_exists(ret, cancellable))
+        {
+            g_object_unref(ret);
+            ret = NULL;
+        }
+    }
+    g_free(basename);
+    g_object_unref(parent);
+    return ret;
+}
+
+/* removes directories left empty after moving deferred @src from them */
+static void _fm_file_ops_job_remove_empty_dirs(FmFileOpsJob* job, GFile* src)
+{
+    GFile* dir = g_file_get_parent(src);
+
+    while(dir)
+    {
+        FmPath* path = fm_path_new_for_gfile(dir);
+        gboolean is_moved = FALSE;
+        GFile* parent;
+        GList* l;
+
+        /* only directories which were moved, not their parents */
+        for(l = fm_path_list_peek_head_link(job->srcs); l && !is_moved; l = l->next)
+            is_moved = fm_path_has_prefix(path, FM_PATH(l->data));
+        fm_path_unref(path);
+        /* deletion fails if there are other skipped files */
+        if(!is_moved || !g_file_delete(dir, fm_job_get_cancellable(FM_JOB(job)), NULL))
+            break;
+        parent = g_file_get_parent(dir);
+        g_object_unref(dir);
+        dir = parent;
+    }
+    if(dir)
+        g_object_unref(dir);
+}
+
+static void _fm_file_ops_job_resolve_conflict(FmFileOpsJob* job, FmFileOpsConflict* conflict)
+{
+    FmJob* fmjob = FM_JOB(job);
+    GFile* dest = g_object_ref(conflict->dest);
+    GFile* new_dest;
+    GError* err = NULL;
+    GFileCopyFlags flags;
+    FmFileOpOption opt;
+    FmPath* path;
+    FmFolder* folder;
+    char *basename, *disp;
+    gboolean ok;
+
+_ask:
+    flags = G_FILE_COPY_ALL_METADATA|G_FILE_COPY_NOFOLLOW_SYMLINKS;
+    new_dest = NULL;
+    opt = _fm_file_ops_job_ask_new_name(job, conflict->src, dest, &new_dest, TRUE);
+    switch(opt)
+    {
+    case FM_FILE_OP_RENAME:
+        if(new_dest)
+        {
+            g_object_unref(dest);
+            dest = new_dest;
+        }
+        break;
+    case FM_FILE_OP_OVERWRITE:
+        flags |= G_FILE_COPY_OVERWRITE;
+        break;
+    case FM_FILE_OP_NEWER:
+        if(!_fm_file_ops_job_src_is_newer(job, conflict->src, dest))
+            goto _out;
+        flags |= G_FILE_COPY_OVERWRITE;
+        break;
+    case FM_FILE_OP_KEEP_BOTH:
+        new_dest = _fm_file_ops_job_get_free_name(job, dest);
+        if(!new_dest)
+            goto _out;
+        g_object_unref(dest);
+        dest = new_dest;
+        break;
+    case FM_FILE_OP_CANCEL:
+        fm_job_cancel(fmjob);
+        /* fall through */
+    default: /* FM_FILE_OP_SKIP */
+        goto _out;
+    }
+
+    /* showing currently processed file. */
+    basename = g_file_get_basename(dest);
+    disp = g_filename_display_name(basename);
+    fm_file_ops_job_emit_cur_file(job, disp);
+    g_free(disp);
+    g_free(basename);
+_retry:
+    if(conflict->is_move)
+        ok = g_file_move(conflict->src, dest, flags, fm_job_get_cancellable(fmjob),
+                         NULL, NULL, &err);
+    else
+        ok = g_file_copy(conflict->src, dest, flags, fm_job_get_cancellable(fmjob),
+                         NULL, NULL, &err);
+    if(!ok)
+    {
+        if(err->domain == G_IO_ERROR && err->code == G_IO_ERROR_EXISTS)
+        {
+            /* new name is taken too */
+            g_clear_error(&err);
+            goto _ask;
+        }
+        if(fm_job_emit_error(fmjob, err, FM_JOB_ERROR_MODERATE) == FM_JOB_RETRY)
+        {
+            g_clear_error(&err);
+            goto _retry;
+        }
+        g_clear_error(&err);
+        goto _out;
+    }
+
+    /* let folders know about the change */
+    path = fm_path_new_for_gfile(dest);
+    folder = fm_folder_find_by_path(fm_path_get_parent(path));
+    if(!folder || !_fm_folder_event_file_added(folder, path))
+        fm_path_unref(path);
+    if(folder)
+        g_object_unref(folder);
+    if(conflict->is_move)
+    {
+        path = fm_path_new_for_gfile(conflict->src);
+        folder = fm_folder_find_by_path(fm_path_get_parent(path));
+        if(folder)
+        {
+            _fm_folder_event_file_deleted(folder, path);
+            g_object_unref(folder);
+        }
+        fm_path_unref(path);
+        _fm_file_ops_job_remove_empty_dirs(job, conflict->src);
+    }
+
+_out:
+    g_object_unref(dest);
+}
+
+/* asks the user about each of deferred conflicts */
+static void _fm_file_ops_job_resolve_conflicts(FmFileOpsJob* job)
+{
+    FmFileOpsConflict* conflict;
+
+    if(job->conflicts == NULL || g_queue_is_empty(job->conflicts))
+        return;
+    job->supported_options = FM_FILE_OP_RENAME | FM_FILE_OP_SKIP | FM_FILE_OP_OVERWRITE |
+                             FM_FILE_OP_NEWER | FM_FILE_OP_KEEP_BOTH;
+    while((conflict = g_queue_pop_head(job->conflicts)) != NULL)
+    {
+        if(!fm_job_is_cancelled(FM_JOB(job)))
+            _fm_file_ops_job_resolve_conflict(job, conflict);
+        _fm_file_ops_conflict_free(conflict);
+    }
+}
+
 static void progress_cb(goffset cur, goffset total, gpointer data)
 {
     FmFileOpsJob* job = FM_FILE_OPS_JOB(data);
@@ -749,6 +1028,7 @@ gboolean _fm_file_ops_job_copy_run(FmFileOpsJob* job)
         g_object_unref(src);
         g_object_unref(dest);
     }
+    _fm_file_ops_job_resolve_conflicts(job);
 
     /* g_debug("finished: %llu, total: %llu", job->finished, job->total); */
     fm_file_ops_job_emit_percent(job);
@@ -876,6 +1156,7 @@ _retry_query_dest_info:
         if(!ret)
             break;
     }
+    _fm_file_ops_job_resolve_conflicts(job);
     /* restore updates for destination and source */
     if (df)
     {
@@ -36,6 +36,8 @@ gboolean _fm_file_ops_job_copy_run(FmFileOpsJob* job);
 gboolean _fm_file_ops_job_move_file(FmFileOpsJob* job, GFile* src, GFileInfo* inf, GFile* dest, FmPath *src_path, FmFolder *src_folder, FmFolder *dst_folder);
 gboolean _fm_file_ops_job_move_run(FmFileOpsJob* job);
 
+void _fm_file_ops_job_free_conflicts(FmFileOpsJob* job);
+
 G_END_DECLS
 
 #endif
@@ -37,6 +37,8 @@
 #endif
 
 #include <glib/gi18n-lib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
 
 #include "fm-file-ops-job.h"
 #include "fm-file-ops-job-xfer.h"
@@ -60,6 +62,9 @@ static guint signals[N_SIGNALS];
 static void fm_file_ops_job_finalize              (GObject *object);
 
 static gboolean fm_file_ops_job_run(FmJob* fm_job);
+static FmJobErrorAction fm_file_ops_job_emit_error(FmJob* fm_job, GError* err, FmJobErrorSeverity severity);
+static void _fm_file_ops_job_report_errors(FmFileOpsJob* job);
+static void _fm_file_ops_job_free_errors(FmFileOpsJob* job);
 /* static void fm_file_ops_job_cancel(FmJob* job); */
 
 /* funcs for io jobs */
@@ -116,6 +121,7 @@ static void fm_file_ops_job_class_init(FmFileOpsJobClass *klass)
 
     job_class = FM_JOB_CLASS(klass);
     job_class->run = fm_file_ops_job_run;
+    job_class->emit_error = fm_file_ops_job_emit_error;
 
     /**
      * FmFileOpsJob::prepared:
@@ -211,6 +217,9 @@ static void fm_file_ops_job_finalize(GObject *object)
     g_return_if_fail(object != NULL);
     g_return_if_fail(FM_IS_FILE_OPS_JOB(object));
 
+    _fm_file_ops_job_free_conflicts((FmFileOpsJob*)object);
+    _fm_file_ops_job_free_errors((FmFileOpsJob*)object);
+
     G_OBJECT_CLASS(fm_file_ops_job_parent_class)->finalize(object);
 }
 
@@ -249,31 +258,252 @@ static gboolean fm_file_ops_job_run(FmJob* fm_job)
 {
     FmFileOpsJob* job = FM_FILE_OPS_JOB(fm_job);
     GError *err;
+    gboolean ret;
     switch(job->type)
     {
     case FM_FILE_OP_COPY:
-        return _fm_file_ops_job_copy_run(job);
+        ret = _fm_file_ops_job_copy_run(job);
+        break;
     case FM_FILE_OP_MOVE:
-        return _fm_file_ops_job_move_run(job);
+        ret = _fm_file_ops_job_move_run(job);
+        break;
     case FM_FILE_OP_TRASH:
-        return _fm_file_ops_job_trash_run(job);
+        ret = _fm_file_ops_job_trash_run(job);
+        break;
     case FM_FILE_OP_UNTRASH:
-        return _fm_file_ops_job_untrash_run(job);
+        ret = _fm_file_ops_job_untrash_run(job);
+        break;
     case FM_FILE_OP_DELETE:
-        return _fm_file_ops_job_delete_run(job);
+        ret = _fm_file_ops_job_delete_run(job);
+        break;
     case FM_FILE_OP_LINK:
-        return _fm_file_ops_job_link_run(job);
+        ret = _fm_file_ops_job_link_run(job);
+        break;
     case FM_FILE_OP_CHANGE_ATTR:
-        return _fm_file_ops_job_change_attr_run(job);
-    case FM_FILE_OP_NONE: ;
+        ret = _fm_file_ops_job_change_attr_run(job);
+        break;
+    case FM_FILE_OP_NONE:
+    default:
+        err = g_error_new_literal(G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                                  _("Operation not supported"));
+        fm_job_emit_error(FM_JOB(job), err, FM_JOB_ERROR_CRITICAL);
+        g_error_free(err);
+        return FALSE;
+    }
+    _fm_file_ops_job_report_errors(job);
+    return ret;
+}
+
+/* Errors collector. A big operation may hit the same error on thousands
+ * of files, e.g. permission denied for every file in some directory, and
+ * each error is a round trip to the main thread which shows it to user.
+ * Therefore errors are grouped by domain, code and directory of the file
+ * being processed. Only first errors of each group reach the main thread,
+ * and not more often than each ERRORS_MIN_INTERVAL after the first one;
+ * the rest are just counted and get the same answer the user gave for
+ * their group. Summary of not shown errors is reported when the job is
+ * done, and the full list may be appended to a log file. Errors of a job
+ * are emitted by one thread at a time so no locking is needed here. */
+#define ERRORS_MAX_GROUPS       256
+#define ERRORS_MIN_INTERVAL     200000 /* microseconds */
+
+typedef struct
+{
+    char* dir; /* display name of the directory, may be NULL */
+    char* sample; /* message of the first error */
+    guint n_errors;
+    guint n_reported;
+    FmJobErrorAction last_act;
+} ErrorGroup;
+
+typedef struct
+{
+    guint limit; /* errors shown per group, 0 to show all */
+    GFile* cur_file; /* file currently processed */
+    GHashTable* groups; /* key string -> ErrorGroup */
+    GQueue order; /* ErrorGroup in order of appearance */
+    guint n_other; /* errors which did not fit into ERRORS_MAX_GROUPS */
+    gint64 last_report;
+    char* log_path;
+    FILE* log;
+} ErrorCollector;
+
+static void error_group_free(gpointer data)
+{
+    ErrorGroup* group = data;
+    g_free(group->dir);
+    g_free(group->sample);
+    g_slice_free(ErrorGroup, group);
+}
+
+static ErrorCollector* _fm_file_ops_job_get_errors(FmFileOpsJob* job)
+{
+    ErrorCollector* errors = job->errors;
+    if(errors == NULL)
+    {
+        errors = g_slice_new0(ErrorCollector);
+        errors->groups = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                               g_free, error_group_free);
+        g_queue_init(&errors->order);
+        job->errors = errors;
     }
-    err = g_error_new_literal(G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
-                              _("Operation not supported"));
-    fm_job_emit_error(FM_JOB(job), err, FM_JOB_ERROR_CRITICAL);
-    g_error_free(err);
-    return FALSE;
+    return errors;
 }
 
+static void _fm_file_ops_job_free_errors(FmFileOpsJob* job)
+{
+    ErrorCollector* errors = job->errors;
+    if(errors == NULL)
+        return;
+    if(errors->cur_file)
+        g_object_unref(errors->cur_file);
+    g_queue_clear(&errors->order);
+    g_hash_table_destroy(errors->groups);
+    if(errors->log)
+        fclose(errors->log);
+    g_free(errors->log_path);
+    g_slice_free(ErrorCollector, errors);
+    job->errors = NULL;
+}
+
+/**
+ * _fm_file_ops_job_set_error_file
+ * @job: the job
+ * @gf: file which is being processed
+ *
+ * Remembers @gf so errors which happen until next call are grouped by
+ * its directory. Does nothing if errors of @job are not collected.
+ *
+ * This API is private to #FmFileOpsJob and should not be used outside
+ * of libfm implementation.
+ */
+void _fm_file_ops_job_set_error_file(FmFileOpsJob* job, GFile* gf)
+{
+    ErrorCollector* errors = job->errors;
+    if(errors == NULL)
+        return;
+    if(errors->cur_file)
+        g_object_unref(errors->cur_file);
+    errors->cur_file = gf ? g_object_ref(gf) : NULL;
+}
+
+static void _fm_file_ops_job_log_error(ErrorCollector* errors, const char* dir,
+                                       GError* err)
+{
+    if(errors->log == NULL)
+    {
+        if(errors->log_path == NULL)
+            return;
+        errors->log = g_fopen(errors->log_path, "a");
+        if(errors->log == NULL)
+        {
+            g_debug("cannot open errors log %s", errors->log_path);
+            g_free(errors->log_path);
+            errors->log_path = NULL;
+            return;
+        }
+    }
+    fprintf(errors->log, "%s\t%s\n", dir ? dir : "", err->message);
+}
+
+static FmJobErrorAction fm_file_ops_job_emit_error(FmJob* fm_job, GError* err, FmJobErrorSeverity severity)
+{
+    FmJobClass* parent_class = FM_JOB_CLASS(fm_file_ops_job_parent_class);
+    ErrorCollector* errors = FM_FILE_OPS_JOB(fm_job)->errors;
+    GFile* parent;
+    ErrorGroup* group;
+    char *dir = NULL, *key;
+    gint64 now;
+
+    if(errors == NULL)
+        return parent_class->emit_error(fm_job, err, severity);
+    if(errors->cur_file && (parent = g_file_get_parent(errors->cur_file)) != NULL)
+    {
+        dir = g_file_get_parse_name(parent);
+        g_object_unref(parent);
+    }
+    _fm_file_ops_job_log_error(errors, dir, err);
+    /* severe errors and cancellation need attention every time */
+    if(errors->limit == 0 || severity >= FM_JOB_ERROR_SEVERE ||
+       (err->domain == G_IO_ERROR && err->code == G_IO_ERROR_CANCELLED))
+    {
+        g_free(dir);
+        return parent_class->emit_error(fm_job, err, severity);
+    }
+    key = g_strdup_printf("%u:%d:%s", (guint)err->domain, err->code, dir ? dir : "");
+    group = g_hash_table_lookup(errors->groups, key);
+    if(group == NULL)
+    {
+        if(g_hash_table_size(errors->groups) >= ERRORS_MAX_GROUPS)
+        {
+            g_free(key);
+            g_free(dir);
+            errors->n_other++;
+            return FM_JOB_CONTINUE;
+        }
+        group = g_slice_new0(ErrorGroup);
+        group->dir = dir;
+        group->sample = g_strdup(err->message);
+        group->last_act = FM_JOB_CONTINUE;
+        g_hash_table_insert(errors->groups, key, group);
+        g_queue_push_tail(&errors->order, group);
+    }
+    else
+    {
+        g_free(key);
+        g_free(dir);
+    }
+    group->n_errors++;
+    now = g_get_monotonic_time();
+    if(group->n_reported == 0 || (group->n_reported < errors->limit &&
+                                  now - errors->last_report >= ERRORS_MIN_INTERVAL))
+    {
+        group->n_reported++;
+        group->last_act = parent_class->emit_error(fm_job, err, severity);
+        errors->last_report = g_get_monotonic_time();
+        return group->last_act;
+    }
+    /* retrying every file of the group would never end */
+    return group->last_act == FM_JOB_RETRY ? FM_JOB_CONTINUE : group->last_act;
+}
+
+/* reports errors which were not shown to user */
+static void _fm_file_ops_job_report_errors(FmFileOpsJob* job)
+{
+    FmJobClass* parent_class = FM_JOB_CLASS(fm_file_ops_job_parent_class);
+    ErrorCollector* errors = job->errors;
+    GList* l;
+    GError* err;
+    guint n;
+
+    if(errors == NULL || fm_job_is_cancelled(FM_JOB(job)))
+        return;
+    if(errors->log)
+        fflush(errors->log);
+    for(l = errors->order.head; l; l = l->next)
+    {
+        ErrorGroup* group = l->data;
+        n = group->n_errors - group->n_reported;
+        if(n == 0)
+            continue;
+        err = g_error_new(G_IO_ERROR, G_IO_ERROR_FAILED,
+                          dngettext(GETTEXT_PACKAGE,
+                                    "%s\n(%u more similar error in %s was not shown)",
+                                    "%s\n(%u more similar errors in %s were not shown)", n),
+                          group->sample, n, group->dir ? group->dir : "");
+        parent_class->emit_error(FM_JOB(job), err, FM_JOB_ERROR_WARNING);
+        g_error_free(err);
+    }
+    if(errors->n_other > 0)
+    {
+        n = errors->n_other;
+        err = g_error_new(G_IO_ERROR, G_IO_ERROR_FAILED,
+                          dngettext(GETTEXT_PACKAGE, "%u more error was not shown",
+                                    "%u more errors were not shown", n), n);
+        parent_class->emit_error(FM_JOB(job), err, FM_JOB_ERROR_WARNING);
+        g_error_free(err);
+    }
+}
 
 /**
  * fm_file_ops_job_set_dest
@@ -919,6 +1149,79 @@ void fm_file_ops_job_set_target(FmFileOpsJob *job, const char *url)
     job->target = g_strdup(url);
 }
 
+/**
+ * fm_file_ops_job_set_defer_conflicts
+ * @job: a job to set
+ * @defer: %TRUE to put conflicts aside
+ *
+ * Sets if copy or move operation should not stop when a file already
+ * exists in destination. If @defer is %TRUE then existing directories are
+ * merged and conflicting files are put aside while all other files are
+ * transferred. When everything else is done, the #FmFileOpsJob::ask-rename
+ * signal is emitted for each of the put aside files. Besides usual options
+ * the handler may return %FM_FILE_OP_NEWER or %FM_FILE_OP_KEEP_BOTH then.
+ *
+ * This API may be used only before @job is started.
+ *
+ * Since: 1.3.0
+ */
+void fm_file_ops_job_set_defer_conflicts(FmFileOpsJob* job, gboolean defer)
+{
+    g_return_if_fail(FM_IS_FILE_OPS_JOB(job));
+    if(defer && job->conflicts == NULL)
+        job->conflicts = g_queue_new();
+    else if(!defer)
+        _fm_file_ops_job_free_conflicts(job);
+}
+
+/**
+ * fm_file_ops_job_set_error_limit
+ * @job: a job to set
+ * @limit: how many errors of each kind to report
+ *
+ * Sets how many similar errors @job reports to its #FmJob::error handler.
+ * Errors are considered similar if they have the same domain and code and
+ * happened in the same directory. Beside the first one, similar errors
+ * are reported not more often than few times a second. Errors that are
+ * not reported get the same answer as the last reported error of their
+ * kind, and a summary of them is reported when the operation is done.
+ * Errors of %FM_JOB_ERROR_SEVERE severity and higher are always reported.
+ * If @limit is 0 then every error is reported, that is the default.
+ *
+ * This API may be used only before @job is started.
+ *
+ * Since: 1.3.0
+ */
+void fm_file_ops_job_set_error_limit(FmFileOpsJob* job, guint limit)
+{
+    g_return_if_fail(FM_IS_FILE_OPS_JOB(job));
+    _fm_file_ops_job_get_errors(job)->limit = limit;
+}
+
+/**
+ * fm_file_ops_job_set_error_log
+ * @job: a job to set
+ * @path: (allow-none): path to log file
+ *
+ * Sets file where every error of @job will be appended to, one line for
+ * each error: directory name and error message separated by TAB. This
+ * includes errors which are not reported due to the limit set with
+ * fm_file_ops_job_set_error_limit().
+ *
+ * This API may be used only before @job is started.
+ *
+ * Since: 1.3.0
+ */
+void fm_file_ops_job_set_error_log(FmFileOpsJob* job, const char* path)
+{
+    ErrorCollector* errors;
+
+    g_return_if_fail(FM_IS_FILE_OPS_JOB(job));
+    errors = _fm_file_ops_job_get_errors(job);
+    g_free(errors->log_path);
+    errors->log_path = g_strdup(path);
+}
+
 /**
  * fm_file_ops_job_get_options
  * @job: a job to set
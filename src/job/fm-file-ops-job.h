@@ -75,6 +75,8 @@ typedef enum {
  * @FM_FILE_OP_RENAME: change name and continue
  * @FM_FILE_OP_SKIP: skip this file
  * @FM_FILE_OP_SKIP_ERROR: not supported
+ * @FM_FILE_OP_NEWER: (since 1.3.0) overwrite only if source is newer, skip otherwise
+ * @FM_FILE_OP_KEEP_BOTH: (since 1.3.0) copy under new free name, like "name (2).ext"
  *
  * Operation selection on error.
  */
@@ -83,7 +85,9 @@ typedef enum {
     FM_FILE_OP_OVERWRITE = 1<<0,
     FM_FILE_OP_RENAME = 1<<1,
     FM_FILE_OP_SKIP = 1<<2,
-    FM_FILE_OP_SKIP_ERROR = 1<<3
+    FM_FILE_OP_SKIP_ERROR = 1<<3,
+    FM_FILE_OP_NEWER = 1<<4,
+    FM_FILE_OP_KEEP_BOTH = 1<<5
 } FmFileOpOption;
 
 /* FIXME: maybe we should create derived classes for different kind
@@ -131,8 +135,8 @@ struct _FmFileOpsJob
     FmFileOpOption supported_options;
 
     /*< private >*/
-    gpointer _reserved1;
-    gpointer _reserved2;
+    GQueue* conflicts; /* deferred conflicts, NULL if not deferring */
+    gpointer errors; /* errors collector, NULL if not collecting */
 };
 
 /**
@@ -169,6 +173,13 @@ void fm_file_ops_job_set_icon(FmFileOpsJob *job, GIcon *icon);
 void fm_file_ops_job_set_hidden(FmFileOpsJob *job, gboolean hidden);
 void fm_file_ops_job_set_target(FmFileOpsJob *job, const char *url);
 
+/* This only work for copy and move jobs. */
+void fm_file_ops_job_set_defer_conflicts(FmFileOpsJob* job, gboolean defer);
+
+/* similar errors of big operations may be grouped instead of reported one by one */
+void fm_file_ops_job_set_error_limit(FmFileOpsJob* job, guint limit);
+void fm_file_ops_job_set_error_log(FmFileOpsJob* job, const char* path);
+
 void fm_file_ops_job_emit_prepared(FmFileOpsJob* job);
 void fm_file_ops_job_emit_cur_file(FmFileOpsJob* job, const char* cur_file);
 void fm_file_ops_job_emit_percent(FmFileOpsJob* job);
@@ -176,6 +187,7 @@ FmFileOpOption fm_file_ops_job_ask_rename(FmFileOpsJob* job, GFile* src, GFileIn
 FmFileOpOption _fm_file_ops_job_ask_new_name(FmFileOpsJob* job, GFile* src,
                                              GFile* dest, GFile** new_dest,
                                              gboolean dest_exists);
+void _fm_file_ops_job_set_error_file(FmFileOpsJob* job, GFile* gf);
 FmFileOpOption fm_file_ops_job_get_options(FmFileOpsJob* job);
 
 G_END_DECLS
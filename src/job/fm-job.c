@@ -31,6 +31,7 @@
 #include "fm-marshal.h"
 #include "glib-compat.h"
 #include "fm-utils.h"
+#include "fm-trace.h"
 
 /**
  * SECTION:fm-job
@@ -77,6 +78,7 @@ static void on_cancellable_cancelled(GCancellable* cancellable, FmJob* job);
 G_DEFINE_ABSTRACT_TYPE(FmJob, fm_job, G_TYPE_OBJECT);
 
 static gboolean fm_job_real_run_async(FmJob* job);
+static FmJobErrorAction fm_job_real_emit_error(FmJob* job, GError* err, FmJobErrorSeverity severity);
 static gboolean on_idle_cleanup(gpointer unused);
 static void job_thread(FmJob* job, gpointer unused);
 
@@ -132,6 +134,7 @@ static void fm_job_class_init(FmJobClass *klass)
     g_object_class->finalize = fm_job_finalize;
 
     klass->run_async = fm_job_real_run_async;
+    klass->emit_error = fm_job_real_emit_error;
 
     fm_job_parent_class = (GObjectClass*)g_type_class_peek(G_TYPE_OBJECT);
 
@@ -290,6 +293,7 @@ gboolean fm_job_run_async(FmJob* job)
     gboolean ret;
     job->running = TRUE;
     g_object_ref(job); /* acquire a ref, it will be unrefed by on_idle_cleanup() */
+    FM_TRACE2(job__queue, job, G_OBJECT_TYPE_NAME(job));
     ret = klass->run_async(job);
     if(G_UNLIKELY(!ret)) /* failed? */
     {
@@ -368,7 +372,9 @@ gboolean fm_job_run_sync_with_mainloop(FmJob* job)
 static void job_thread(FmJob* job, gpointer unused)
 {
     FmJobClass* klass = FM_JOB_CLASS(G_OBJECT_GET_CLASS(job));
+    FM_TRACE1(job__start, job);
     klass->run(job);
+    FM_TRACE2(job__done, job, job->cancel);
 
     /* let the main thread know that we're done, and free the job
      * in idle handler if neede. */
@@ -573,6 +579,7 @@ static gboolean on_idle_cleanup(gpointer unused)
     for(l = jobs; l; l=l->next)
     {
         FmJob* job = FM_JOB(l->data);
+        FM_TRACE2(job__finish, job, job->cancel);
         if(job->cancel)
             fm_job_emit_cancelled(job);
         fm_job_emit_finished(job);
@@ -680,6 +687,14 @@ static gpointer error_in_main_thread(FmJob* job, gpointer input_data)
     return GUINT_TO_POINTER(ret);
 }
 
+static FmJobErrorAction fm_job_real_emit_error(FmJob* job, GError* err, FmJobErrorSeverity severity)
+{
+    struct ErrData data;
+    data.err = err;
+    data.severity = severity;
+    return (FmJobErrorAction)GPOINTER_TO_UINT(fm_job_call_main_thread(job, error_in_main_thread, &data));
+}
+
 /**
  * fm_job_emit_error
  * @job: a job that emitted the signal
@@ -687,7 +702,8 @@ static gpointer error_in_main_thread(FmJob* job, gpointer input_data)
  * @severity: severity of the error
  *
  * Emits an #FmJob::error signal in the main thread to notify it when an
- * error occurs.
+ * error occurs. Since 1.3.0 this is done by @emit_error method of the job
+ * class so derived class may filter errors before they reach main thread.
  * The return value of this function is the return value returned by
  * the connected signal handlers.
  * If @severity is FM_JOB_ERROR_CRITICAL, the returned value is ignored and
@@ -710,11 +726,8 @@ static gpointer error_in_main_thread(FmJob* job, gpointer input_data)
 FmJobErrorAction fm_job_emit_error(FmJob* job, GError* err, FmJobErrorSeverity severity)
 {
     FmJobErrorAction ret;
-    struct ErrData data;
     g_return_val_if_fail(err, FM_JOB_ABORT);
-    data.err = err;
-    data.severity = severity;
-    ret = GPOINTER_TO_UINT(fm_job_call_main_thread(job, error_in_main_thread, &data));
+    ret = FM_JOB_CLASS(G_OBJECT_GET_CLASS(job))->emit_error(job, err, severity);
     if(severity == FM_JOB_ERROR_CRITICAL || ret == FM_JOB_ABORT)
     {
         ret = FM_JOB_ABORT;
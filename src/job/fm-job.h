@@ -121,6 +121,10 @@ struct _FmJob
  *      set by any class derived from #FmJob.
  * @cancel: the @cancel function is called when the job is cancelled.
  *      It can perform some class-specific operations then.
+ * @emit_error: the @emit_error function is called by fm_job_emit_error()
+ *      in working thread to deliver an error. Default implementation
+ *      emits the #FmJob::error signal in main thread. Derived class may
+ *      override it to filter or aggregate errors. Since: 1.3.0
  */
 struct _FmJobClass
 {
@@ -138,9 +142,7 @@ struct _FmJobClass
     gboolean (*run_async)(FmJob* job); /* for fm_job_run_async() */
     gboolean (*run)(FmJob* job); /* for any fm_job_run_*() */
     void (*cancel)(FmJob* job); /* for fm_job_cancel() */
-
-    /*< private >*/
-    gpointer _reserved1;
+    FmJobErrorAction (*emit_error)(FmJob* job, GError* err, FmJobErrorSeverity severity); /* for fm_job_emit_error() */
 };
 
 
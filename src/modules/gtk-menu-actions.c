@@ -122,6 +122,80 @@ static void add_custom_action_item(GString* xml, FmFileActionItem* item,
     }
 }
 
+/* Some conditions of actions are tested asynchronously and fail until
+   their result is known, so menu shown meanwhile gets the actions which
+   match once the results arrive. */
+typedef struct
+{
+    GtkUIManager* ui; /* weak, the data is freed with it */
+    GtkActionGroup* act_grp;
+    GList* files; /* of FmFileInfo */
+    const char* placeholder;
+    GCallback cb;
+    gpointer cb_data;
+    FmFileActionTestMonitor* monitor;
+    gulong handler;
+} PendingMenu;
+
+static void on_test_results_changed(FmFileActionTestMonitor* mon, PendingMenu* pm)
+{
+    GList* items = fm_get_actions_for_files(pm->files);
+    GString* xml = g_string_new(NULL);
+    GList* l;
+    gboolean added = FALSE;
+
+    g_string_printf(xml, "<popup><placeholder name='%s'>", pm->placeholder);
+    for(l = items; l; l = l->next)
+    {
+        FmFileActionItem* item = FM_FILE_ACTION_ITEM(l->data);
+        /* actions which are already in menu are left as they are */
+        if(gtk_action_group_get_action(pm->act_grp, fm_file_action_item_get_id(item)))
+            continue;
+        add_custom_action_item(xml, item, pm->act_grp, pm->cb, pm->cb_data);
+        added = TRUE;
+    }
+    g_string_append(xml, "</placeholder></popup>");
+    if(added)
+    {
+        gtk_ui_manager_add_ui_from_string(pm->ui, xml->str, xml->len, NULL);
+        gtk_ui_manager_ensure_update(pm->ui);
+    }
+    g_string_free(xml, TRUE);
+    g_list_foreach(items, (GFunc)fm_file_action_item_unref, NULL);
+    g_list_free(items);
+}
+
+static void on_pending_menu_ui_finalized(gpointer data, GObject* ui)
+{
+    PendingMenu* pm = data;
+
+    g_signal_handler_disconnect(pm->monitor, pm->handler);
+    g_object_unref(pm->monitor);
+    g_object_unref(pm->act_grp);
+    g_list_foreach(pm->files, (GFunc)fm_file_info_unref, NULL);
+    g_list_free(pm->files);
+    g_slice_free(PendingMenu, pm);
+}
+
+static void watch_test_results(GtkUIManager* ui, GtkActionGroup* act_grp,
+                               GList* files, const char* placeholder,
+                               GCallback cb, gpointer cb_data)
+{
+    PendingMenu* pm = g_slice_new(PendingMenu);
+
+    pm->ui = ui;
+    pm->act_grp = g_object_ref(act_grp);
+    pm->files = g_list_copy(files);
+    g_list_foreach(pm->files, (GFunc)fm_file_info_ref, NULL);
+    pm->placeholder = placeholder;
+    pm->cb = cb;
+    pm->cb_data = cb_data;
+    pm->monitor = g_object_ref(fm_file_actions_get_test_monitor());
+    pm->handler = g_signal_connect(pm->monitor, "changed",
+                                   G_CALLBACK(on_test_results_changed), pm);
+    g_object_weak_ref(G_OBJECT(ui), on_pending_menu_ui_finalized, pm);
+}
+
 static void
 _fm_actions_update_file_menu_for_scheme(GtkWindow* window, GtkUIManager* ui,
                                         GString* xml, GtkActionGroup* act_grp,
@@ -146,6 +220,8 @@ _fm_actions_update_file_menu_for_scheme(GtkWindow* window, GtkUIManager* ui,
     }
     g_list_foreach(items, (GFunc)fm_file_action_item_unref, NULL);
     g_list_free(items);
+    watch_test_results(ui, act_grp, files_list, "ph3",
+                       G_CALLBACK(on_custom_action_file), menu);
 }
 
 static void
@@ -177,6 +253,8 @@ _fm_actions_update_folder_menu_for_scheme(FmFolderView* fv, GtkWindow* window,
     }
     g_list_foreach(items, (GFunc)fm_file_action_item_unref, NULL);
     g_list_free(items);
+    watch_test_results(ui, act_grp, files_list, "CustomCommonOps",
+                       G_CALLBACK(on_custom_action_folder), fv);
     g_list_free(files_list);
 }
 
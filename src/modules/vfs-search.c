@@ -64,8 +64,10 @@ struct _FmVfsSearchEnumerator
     GFileEnumerator parent;
 
     FmSearchIntIter* iter;
-    char* attributes;
+    char* attributes; /* attributes requested by the caller */
     GFileQueryInfoFlags flags;
+    char* scan_attributes; /* minimal set required by active rules */
+    GFileQueryInfoFlags scan_flags;
     GSList* target_folders; /* GFile */
     char** name_patterns;
     GRegex* name_regex;
@@ -112,15 +114,16 @@ struct _FmSearchVFileClass
 
 
 /* beforehand declarations */
-static gboolean fm_search_job_match_file(FmVfsSearchEnumerator * priv,
-                                         GFileInfo * info, GFile * parent,
-                                         GCancellable *cancellable,
-                                         GError **error);
+static GFileInfo *fm_search_job_match_file(FmVfsSearchEnumerator * priv,
+                                           GFileInfo * info, GFile * parent,
+                                           GCancellable *cancellable,
+                                           GError **error);
 static void fm_search_job_match_folder(FmVfsSearchEnumerator * priv,
                                        GFile * folder_path,
                                        GCancellable *cancellable,
                                        GError **error);
 static void parse_search_uri(FmVfsSearchEnumerator* priv, const char* uri_str);
+static void setup_scan_attributes(FmVfsSearchEnumerator* priv);
 
 
 /* ---- Directory iterator ---- */
@@ -177,6 +180,12 @@ static void _fm_vfs_search_enumerator_dispose(GObject *object)
         priv->attributes = NULL;
     }
 
+    if(priv->scan_attributes)
+    {
+        g_free(priv->scan_attributes);
+        priv->scan_attributes = NULL;
+    }
+
     if(priv->target_folders)
     {
         g_slist_foreach(priv->target_folders, (GFunc)g_object_unref, NULL);
@@ -217,13 +226,33 @@ static void _fm_vfs_search_enumerator_dispose(GObject *object)
     G_OBJECT_CLASS(fm_vfs_search_enumerator_parent_class)->dispose(object);
 }
 
+/* checks if directory should be skipped when hidden files aren't shown:
+   dot files are checked by name, the rest requires a query for the
+   standard::is-hidden attribute (it may be listed in .hidden file) */
+static gboolean _search_dir_is_hidden(GFile *file, const char *name,
+                                      GCancellable *cancellable)
+{
+    GFileInfo *info;
+    gboolean ret;
+
+    if(name[0] == '.')
+        return TRUE;
+    info = g_file_query_info(file, G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN,
+                             G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, cancellable, NULL);
+    if(info == NULL)
+        return FALSE; /* error will be reported on enumeration */
+    ret = g_file_info_get_is_hidden(info);
+    g_object_unref(info);
+    return ret;
+}
+
 static GFileInfo *_fm_vfs_search_enumerator_next_file(GFileEnumerator *enumerator,
                                                       GCancellable *cancellable,
                                                       GError **error)
 {
     FmVfsSearchEnumerator *enu = FM_VFS_SEACRH_ENUMERATOR(enumerator);
     FmSearchIntIter *iter;
-    GFileInfo * file_info;
+    GFileInfo * file_info, * found;
     GError *err = NULL;
     FmSearchVFile *container;
 
@@ -235,7 +264,7 @@ static GFileInfo *_fm_vfs_search_enumerator_next_file(GFileEnumerator *enumerato
         {
             if(enu->target_folders == NULL)
                 break;
-            iter = _search_iter_new(NULL, enu->attributes, enu->flags,
+            iter = _search_iter_new(NULL, enu->scan_attributes, enu->scan_flags,
                                     enu->target_folders->data,
                                     cancellable, error);
             if(iter == NULL)
@@ -254,29 +283,32 @@ static GFileInfo *_fm_vfs_search_enumerator_next_file(GFileEnumerator *enumerato
         if(file_info && g_file_info_get_name(file_info))
         {
             /* check if directory itself matches criteria */
-            if(fm_search_job_match_file(enu, file_info, iter->folder_path,
-                                        cancellable, &err))
+            found = fm_search_job_match_file(enu, file_info, iter->folder_path,
+                                             cancellable, &err);
+            if(found)
             {
-                g_debug("found matched: %s", g_file_info_get_name(file_info));
-                return file_info;
+                g_debug("found matched: %s", g_file_info_get_name(found));
+                g_object_unref(file_info);
+                return found;
             }
 
             /* recurse upon each directory */
             if(err == NULL && enu->recursive &&
+               g_file_info_get_file_type(file_info) == G_FILE_TYPE_DIRECTORY &&
                /* SF bug #969: very possibly we get multiple instances of the
                   same file if we follow symlink to a directory
                   FIXME: make it optional? */
-               !g_file_info_get_is_symlink(file_info) &&
-               g_file_info_get_file_type(file_info) == G_FILE_TYPE_DIRECTORY)
+               /* NOTE: if scan doesn't follow symlinks then the type of
+                  symlink is never G_FILE_TYPE_DIRECTORY */
+               ((enu->scan_flags & G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS) ||
+                !g_file_info_get_is_symlink(file_info)))
             {
-                if(enu->show_hidden || !g_file_info_get_is_hidden(file_info))
-                {
-                    const char * name = g_file_info_get_name(file_info);
-                    GFile * file = g_file_get_child(iter->folder_path, name);
+                const char * name = g_file_info_get_name(file_info);
+                GFile * file = g_file_get_child(iter->folder_path, name);
+                if(enu->show_hidden || !_search_dir_is_hidden(file, name, cancellable))
                     /* go into directory and iterate it now */
                     fm_search_job_match_folder(enu, file, cancellable, &err);
-                    g_object_unref(file);
-                }
+                g_object_unref(file);
             }
 
             g_object_unref(file_info);
@@ -354,6 +386,7 @@ static GFileEnumerator *_fm_vfs_search_enumerator_new(GFile *file,
     enumerator->attributes = g_strdup(attributes);
     enumerator->flags = flags;
     parse_search_uri(enumerator, path_str);
+    setup_scan_attributes(enumerator);
     /* FIXME: don't ignore flags */
 
     return G_FILE_ENUMERATOR(enumerator);
@@ -534,13 +567,6 @@ static void parse_search_uri(FmVfsSearchEnumerator* priv, const char* uri_str)
                             }
                         }
 
-                        if (!g_strstr_len(priv->attributes, -1, G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE))
-                        {
-                            gchar * attributes = g_strconcat(priv->attributes, ",", G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE, NULL);
-                            g_free(priv->attributes);
-                            priv->attributes = attributes;
-                        }
-
                     }
                 }
                 else if(strcmp(name, "min_size") == 0)
@@ -595,6 +621,52 @@ static void parse_search_uri(FmVfsSearchEnumerator* priv, const char* uri_str)
     }
 }
 
+/*
+ * setup_scan_attributes
+ * @priv: the enumerator with parsed search URI
+ *
+ * Computes the minimal set of attributes which is required to test all
+ * the active rules. Directories are scanned with that set only, and full
+ * set of attributes requested by the caller is queried only for files
+ * which passed the checks. If only the name rules are active then scan
+ * requests just the name and type of each entry which for local folder
+ * means no stat() call for entries that don't match.
+ */
+static void setup_scan_attributes(FmVfsSearchEnumerator* priv)
+{
+    GString *attrs = g_string_new(G_FILE_ATTRIBUTE_STANDARD_NAME","
+                                  G_FILE_ATTRIBUTE_STANDARD_TYPE);
+    gboolean need_stat = FALSE;
+
+    if(priv->min_size > 0 || priv->max_size > 0 ||
+       priv->content_pattern || priv->content_regex)
+    {
+        g_string_append(attrs, ","G_FILE_ATTRIBUTE_STANDARD_SIZE);
+        need_stat = TRUE;
+    }
+    if(priv->min_mtime > 0 || priv->max_mtime > 0)
+    {
+        g_string_append(attrs, ","G_FILE_ATTRIBUTE_TIME_MODIFIED);
+        need_stat = TRUE;
+    }
+    /* content type detection is expensive so request it only if needed */
+    if(priv->mime_types)
+    {
+        g_string_append(attrs, ","G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE);
+        need_stat = TRUE;
+    }
+    if(need_stat)
+    {
+        /* rules should be applied to symlink target as before, so we
+           need to know if it's a symlink to not recurse into it */
+        g_string_append(attrs, ","G_FILE_ATTRIBUTE_STANDARD_IS_SYMLINK);
+        priv->scan_flags = priv->flags;
+    }
+    else /* type of symlink can be taken from directory entry itself */
+        priv->scan_flags = priv->flags | G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS;
+    priv->scan_attributes = g_string_free(attrs, FALSE);
+}
+
 static void fm_search_job_match_folder(FmVfsSearchEnumerator * priv,
                                        GFile * folder_path,
                                        GCancellable *cancellable,
@@ -604,7 +676,7 @@ static void fm_search_job_match_folder(FmVfsSearchEnumerator * priv,
     FmSearchVFile *container;
 
     /* FIXME: make error if NULL */
-    iter = _search_iter_new(priv->iter, priv->attributes, priv->flags, folder_path,
+    iter = _search_iter_new(priv->iter, priv->scan_attributes, priv->scan_flags, folder_path,
                             cancellable, error);
     if(iter == NULL) /* error */
         return;
@@ -616,20 +688,18 @@ static void fm_search_job_match_folder(FmVfsSearchEnumerator * priv,
     container->current = g_object_ref(folder_path);
 }
 
-static gboolean fm_search_job_match_filename(FmVfsSearchEnumerator* priv, GFileInfo* info)
+static gboolean fm_search_job_match_filename(FmVfsSearchEnumerator* priv, const char* name)
 {
     gboolean ret;
 
-    /* g_debug("fm_search_job_match_filename: %s", g_file_info_get_name(info)); */
+    /* g_debug("fm_search_job_match_filename: %s", name); */
     if(priv->name_regex)
     {
-        const char* name = g_file_info_get_name(info);
         ret = g_regex_match(priv->name_regex, name, 0, NULL);
     }
     else if(priv->name_patterns)
     {
         ret = FALSE;
-        const char* name = g_file_info_get_name(info);
         char** ppattern;
         for(ppattern = priv->name_patterns; *ppattern; ++ppattern)
         {
@@ -829,8 +899,11 @@ static gboolean fm_search_job_match_file_type(FmVfsSearchEnumerator* priv, GFile
 
 static gboolean fm_search_job_match_size(FmVfsSearchEnumerator* priv, GFileInfo* info)
 {
-    guint64 size = g_file_info_get_size(info);
+    guint64 size;
     gboolean ret = TRUE;
+    if(priv->min_size == 0 && priv->max_size == 0) /* size wasn't queried */
+        return TRUE;
+    size = g_file_info_get_size(info);
     if(priv->min_size > 0 && size < priv->min_size)
         ret = FALSE;
     else if(priv->max_size > 0 && size > priv->max_size)
@@ -855,32 +928,57 @@ static gboolean fm_search_job_match_mtime(FmVfsSearchEnumerator* priv, GFileInfo
     return ret;
 }
 
-static gboolean fm_search_job_match_file(FmVfsSearchEnumerator * priv,
-                                         GFileInfo * info, GFile * parent,
-                                         GCancellable *cancellable,
-                                         GError **error)
+/* @info contains only attributes from scan_attributes, returns info
+   with the full set of attributes if file matches all rules */
+static GFileInfo *fm_search_job_match_file(FmVfsSearchEnumerator * priv,
+                                           GFileInfo * info, GFile * parent,
+                                           GCancellable *cancellable,
+                                           GError **error)
 {
-    //g_print("matching file %s\n", g_file_info_get_name(info));
+    const char *name = g_file_info_get_name(info);
+    GFileInfo *full_info;
+    GFile *file;
+
+    //g_print("matching file %s\n", name);
 
-    if(!priv->show_hidden && g_file_info_get_is_hidden(info))
-        return FALSE;
+    /* rules that don't require any stat() call on the file */
+    if(!priv->show_hidden && name[0] == '.')
+        return NULL;
 
-    if(!fm_search_job_match_filename(priv, info))
-        return FALSE;
+    if(!fm_search_job_match_filename(priv, name))
+        return NULL;
 
+    /* rules that use attributes from scan */
     if(!fm_search_job_match_file_type(priv, info))
-        return FALSE;
+        return NULL;
 
     if(!fm_search_job_match_size(priv, info))
-        return FALSE;
+        return NULL;
 
     if(!fm_search_job_match_mtime(priv, info))
-        return FALSE;
+        return NULL;
+
+    /* query the rest of attributes now, it's still cheaper than reading
+       the file contents so do it before content search */
+    file = g_file_get_child(parent, name);
+    full_info = g_file_query_info(file, priv->attributes, priv->flags,
+                                  cancellable, NULL);
+    g_object_unref(file);
+    if(full_info == NULL) /* file is gone or inaccessible, just skip it */
+        return NULL;
+
+    /* file might be hidden not by name but by listing in .hidden file */
+    if(!priv->show_hidden && g_file_info_get_is_hidden(full_info))
+        goto _not_matched;
 
     if(!fm_search_job_match_content(priv, info, parent, cancellable, error))
-        return FALSE;
+        goto _not_matched;
 
-    return TRUE;
+    return full_info;
+
+_not_matched:
+    g_object_unref(full_info);
+    return NULL;
 }
 
 
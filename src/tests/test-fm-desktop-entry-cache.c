@@ -0,0 +1,258 @@
+/*
+ *      test-fm-desktop-entry-cache.c
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <fm.h>
+#include "fm-desktop-entry-cache.h"
+#include "fm-folder-snapshot.h"
+
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <utime.h>
+
+//ignore for test disabled asserts
+#ifdef G_DISABLE_ASSERT
+    #undef G_DISABLE_ASSERT
+#endif
+
+#define ENTRY_1 "[Desktop Entry]\nType=Link\nURL=http://a/\nIcon=one\nName=One\nHidden=true\n"
+/* the same size as ENTRY_1 */
+#define ENTRY_2 "[Desktop Entry]\nType=Link\nURL=http://b/\nIcon=two\nName=Two\nHidden=true\n"
+
+static char *cache_home = NULL;
+static char *cache_file = NULL;
+static char *entry_file = NULL;
+
+/* rewrites file keeping its inode so cache key stays the same */
+static void write_in_place(const char *path, const char *contents)
+{
+    FILE *f = fopen(path, "w");
+
+    g_assert(f != NULL);
+    g_assert_cmpuint(fwrite(contents, 1, strlen(contents), f), ==, strlen(contents));
+    g_assert_cmpint(fclose(f), ==, 0);
+}
+
+static void set_mtime(const char *path, const struct stat *st, long nsec)
+{
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+    struct timespec times[2];
+
+    times[0] = st->st_atim;
+    times[1].tv_sec = st->st_mtime;
+    times[1].tv_nsec = nsec;
+    g_assert_cmpint(utimensat(AT_FDCWD, path, times, 0), ==, 0);
+#else
+    struct utimbuf times;
+
+    times.actime = st->st_atime;
+    times.modtime = st->st_mtime;
+    g_assert_cmpint(utime(path, &times), ==, 0);
+#endif
+}
+
+static void restart_cache(void)
+{
+    _fm_desktop_entry_cache_finalize();
+    _fm_desktop_entry_cache_init();
+}
+
+/* drops all entries including saved ones */
+static void reset_cache(void)
+{
+    _fm_desktop_entry_cache_finalize();
+    g_remove(cache_file);
+    _fm_desktop_entry_cache_init();
+}
+
+static void get_entry(FmDesktopEntryData *data, struct stat *st)
+{
+    g_assert_cmpint(g_stat(entry_file, st), ==, 0);
+    memset(data, 0, sizeof(*data));
+    g_assert(_fm_desktop_entry_cache_get(entry_file, st, data));
+}
+
+static void free_data(FmDesktopEntryData *data)
+{
+    g_free(data->url);
+    g_free(data->icon);
+    g_free(data->name);
+}
+
+static void test_file_format(void)
+{
+    FmDesktopEntryData data;
+    struct stat st;
+    char *contents;
+    const char *p, *end, *str;
+    gsize len;
+    guint64 val;
+
+    reset_cache();
+    write_in_place(entry_file, ENTRY_1);
+    get_entry(&data, &st);
+    g_assert_cmpstr(data.url, ==, "http://a/");
+    g_assert_cmpstr(data.icon, ==, "one");
+    g_assert_cmpstr(data.name, ==, "One");
+    g_assert(data.hidden);
+    free_data(&data);
+    restart_cache(); /* saves it */
+
+    g_assert(g_file_get_contents(cache_file, &contents, &len, NULL));
+    p = contents;
+    end = contents + len;
+    g_assert_cmpuint(len, >, 8);
+    g_assert(memcmp(p, "FMDENT2\n", 8) == 0);
+    p += 8;
+    g_assert(_fm_snapshot_get_string(&p, end, &str));
+    g_assert_cmpstr(str, ==, "C");
+    g_assert(_fm_snapshot_get_uint(&p, end, &val));
+    g_assert_cmpuint(val, ==, 1);
+    g_assert(_fm_snapshot_get_uint(&p, end, &val));
+    g_assert_cmpuint(val, ==, (guint64)st.st_dev);
+    g_assert(_fm_snapshot_get_uint(&p, end, &val));
+    g_assert_cmpuint(val, ==, (guint64)st.st_ino);
+    g_assert(_fm_snapshot_get_uint(&p, end, &val));
+    g_assert_cmpuint(val, ==, (guint64)st.st_mtime);
+    g_assert(_fm_snapshot_get_uint(&p, end, &val));
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+    g_assert_cmpuint(val, ==, (guint64)st.st_mtim.tv_nsec);
+#else
+    g_assert_cmpuint(val, ==, 0);
+#endif
+    g_assert(_fm_snapshot_get_uint(&p, end, &val));
+    g_assert_cmpuint(val, ==, (guint64)st.st_size);
+    g_assert(_fm_snapshot_get_uint(&p, end, &val));
+    g_assert_cmpuint(val, ==, 2); /* hidden */
+    g_assert(_fm_snapshot_get_string(&p, end, &str));
+    g_assert_cmpstr(str, ==, "http://a/");
+    g_assert(_fm_snapshot_get_string(&p, end, &str));
+    g_assert_cmpstr(str, ==, "one");
+    g_assert(_fm_snapshot_get_string(&p, end, &str));
+    g_assert_cmpstr(str, ==, "One");
+    g_assert(p == end);
+    g_free(contents);
+}
+
+static void test_validation(void)
+{
+    FmDesktopEntryData data;
+    struct stat st, orig;
+
+    reset_cache();
+    write_in_place(entry_file, ENTRY_1);
+    g_assert_cmpint(g_stat(entry_file, &orig), ==, 0);
+    set_mtime(entry_file, &orig, 100000);
+    get_entry(&data, &orig);
+    free_data(&data);
+    restart_cache(); /* the entry is loaded back from the file */
+
+    /* unchanged mtime and size: cached data is used, even if stale */
+    write_in_place(entry_file, ENTRY_2);
+    set_mtime(entry_file, &orig, 100000);
+    get_entry(&data, &st);
+    g_assert_cmpuint(st.st_ino, ==, orig.st_ino);
+    g_assert_cmpstr(data.name, ==, "One");
+    free_data(&data);
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+    /* file changed within the same second */
+    set_mtime(entry_file, &orig, 200000);
+    get_entry(&data, &st);
+    g_assert_cmpint(st.st_mtime, ==, orig.st_mtime);
+    g_assert_cmpstr(data.name, ==, "Two");
+    free_data(&data);
+#endif
+
+    /* changed size */
+    write_in_place(entry_file, "[Desktop Entry]\nType=Application\nName=Three\n");
+    set_mtime(entry_file, &orig, 200000);
+    get_entry(&data, &st);
+    g_assert_cmpstr(data.name, ==, "Three");
+    g_assert(data.url == NULL);
+    g_assert(!data.hidden);
+    free_data(&data);
+
+    /* invalid entries are cached too */
+    write_in_place(entry_file, "[Desktop Entry]\nType=Link\nName=Four\n");
+    g_assert_cmpint(g_stat(entry_file, &st), ==, 0);
+    memset(&data, 0, sizeof(data));
+    g_assert(!_fm_desktop_entry_cache_get(entry_file, &st, &data));
+    restart_cache();
+    g_assert(!_fm_desktop_entry_cache_get(entry_file, &st, &data));
+}
+
+static void test_broken_file(void)
+{
+    reset_cache();
+    g_assert(g_file_set_contents(cache_file, "FMDENT2\n\x01" "C", -1, NULL));
+    restart_cache();
+    g_assert(!g_file_test(cache_file, G_FILE_TEST_EXISTS));
+
+    g_assert(g_file_set_contents(cache_file, "FMDENT1\n", -1, NULL));
+    restart_cache();
+    g_assert(!g_file_test(cache_file, G_FILE_TEST_EXISTS));
+}
+
+int main (int   argc, char *argv[])
+{
+    FmConfig *config;
+    char *dir;
+    int ret;
+
+#if !GLIB_CHECK_VERSION(2, 36, 0)
+    g_type_init();
+#endif
+    /* don't touch real user cache, it should be set before it is queried */
+    cache_home = g_dir_make_tmp("libfm-dent-XXXXXX", NULL);
+    g_assert(cache_home != NULL);
+    g_setenv("XDG_CACHE_HOME", cache_home, TRUE);
+    cache_file = g_build_filename(cache_home, "libfm", "desktop-entries", NULL);
+    entry_file = g_build_filename(cache_home, "test.desktop", NULL);
+    dir = g_path_get_dirname(cache_file);
+    g_mkdir_with_parents(dir, 0700);
+
+    config = fm_config_new();
+    config->desktop_entry_cache = TRUE;
+    fm_init(config);
+    g_object_unref(config);
+
+    g_test_init (&argc, &argv, NULL); // initialize test program
+    g_test_add_func("/FmDesktopEntryCache/file_format", test_file_format);
+    g_test_add_func("/FmDesktopEntryCache/validation", test_validation);
+    g_test_add_func("/FmDesktopEntryCache/broken_file", test_broken_file);
+
+    ret = g_test_run();
+    fm_finalize();
+
+    g_remove(cache_file);
+    g_remove(entry_file);
+    g_rmdir(dir);
+    g_rmdir(cache_home);
+    g_free(dir);
+    g_free(entry_file);
+    g_free(cache_file);
+    g_free(cache_home);
+    return ret;
+}
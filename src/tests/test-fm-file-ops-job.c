@@ -0,0 +1,227 @@
+/*
+ *      test-fm-file-ops-job.c
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+#include <fm.h>
+
+#include <glib/gstdio.h>
+#include <string.h>
+
+//ignore for test disabled asserts
+#ifdef G_DISABLE_ASSERT
+    #undef G_DISABLE_ASSERT
+#endif
+
+/* should be above ERRORS_MIN_INTERVAL of fm-file-ops-job.c */
+#define REPORT_INTERVAL 250000
+
+typedef struct
+{
+    FmJobErrorAction answer;
+    guint n_errors;
+    guint n_warnings;
+    char *last_message;
+} ErrorCounter;
+
+static FmJobErrorAction on_error(FmJob *job, GError *err, FmJobErrorSeverity severity,
+                                 ErrorCounter *counter)
+{
+    if (severity == FM_JOB_ERROR_WARNING)
+        counter->n_warnings++;
+    else
+        counter->n_errors++;
+    g_free(counter->last_message);
+    counter->last_message = g_strdup(err->message);
+    return counter->answer;
+}
+
+static FmFileOpsJob *new_job(guint limit, ErrorCounter *counter)
+{
+    FmPathList *files = fm_path_list_new();
+    FmFileOpsJob *job = fm_file_ops_job_new(FM_FILE_OP_DELETE, files);
+
+    fm_path_list_unref(files);
+    fm_file_ops_job_set_error_limit(job, limit);
+    memset(counter, 0, sizeof(*counter));
+    counter->answer = FM_JOB_CONTINUE;
+    g_signal_connect(job, "error", G_CALLBACK(on_error), counter);
+    return job;
+}
+
+static void free_job(FmFileOpsJob *job, ErrorCounter *counter)
+{
+    g_object_unref(job);
+    g_free(counter->last_message);
+}
+
+static FmJobErrorAction emit(FmFileOpsJob *job, gint code, FmJobErrorSeverity severity)
+{
+    GError *err = g_error_new(G_IO_ERROR, code, "error %d", code);
+    FmJobErrorAction act = fm_job_emit_error(FM_JOB(job), err, severity);
+
+    g_error_free(err);
+    return act;
+}
+
+static void test_limit(void)
+{
+    ErrorCounter counter;
+    FmFileOpsJob *job = new_job(2, &counter);
+    int i;
+
+    /* the first error is shown, quick repetitions are not */
+    for (i = 0; i < 5; i++)
+        g_assert_cmpint(emit(job, G_IO_ERROR_PERMISSION_DENIED, FM_JOB_ERROR_MODERATE),
+                        ==, FM_JOB_CONTINUE);
+    g_assert_cmpuint(counter.n_errors, ==, 1);
+
+    /* error of another kind is the first of its group */
+    emit(job, G_IO_ERROR_NOT_FOUND, FM_JOB_ERROR_MODERATE);
+    g_assert_cmpuint(counter.n_errors, ==, 2);
+
+    /* after a pause it is shown again until the limit is reached */
+    g_usleep(REPORT_INTERVAL);
+    emit(job, G_IO_ERROR_PERMISSION_DENIED, FM_JOB_ERROR_MODERATE);
+    g_assert_cmpuint(counter.n_errors, ==, 3);
+    g_usleep(REPORT_INTERVAL);
+    emit(job, G_IO_ERROR_PERMISSION_DENIED, FM_JOB_ERROR_MODERATE);
+    g_assert_cmpuint(counter.n_errors, ==, 3);
+    g_assert_cmpuint(counter.n_warnings, ==, 0);
+
+    free_job(job, &counter);
+}
+
+static void test_answer(void)
+{
+    ErrorCounter counter;
+    FmFileOpsJob *job = new_job(1, &counter);
+
+    /* the answer is given to suppressed errors of the same group */
+    counter.answer = FM_JOB_RETRY;
+    g_assert_cmpint(emit(job, G_IO_ERROR_PERMISSION_DENIED, FM_JOB_ERROR_MODERATE),
+                    ==, FM_JOB_RETRY);
+    /* but retry is not repeated forever */
+    g_assert_cmpint(emit(job, G_IO_ERROR_PERMISSION_DENIED, FM_JOB_ERROR_MODERATE),
+                    ==, FM_JOB_CONTINUE);
+    g_assert_cmpuint(counter.n_errors, ==, 1);
+
+    counter.answer = FM_JOB_ABORT;
+    g_assert_cmpint(emit(job, G_IO_ERROR_NOT_FOUND, FM_JOB_ERROR_MODERATE),
+                    ==, FM_JOB_ABORT);
+    g_assert(fm_job_is_cancelled(FM_JOB(job)));
+
+    free_job(job, &counter);
+}
+
+static void test_always_reported(void)
+{
+    ErrorCounter counter;
+    FmFileOpsJob *job = new_job(1, &counter);
+    int i;
+
+    for (i = 0; i < 3; i++)
+        emit(job, G_IO_ERROR_NO_SPACE, FM_JOB_ERROR_SEVERE);
+    g_assert_cmpuint(counter.n_errors, ==, 3);
+    for (i = 0; i < 3; i++)
+        emit(job, G_IO_ERROR_CANCELLED, FM_JOB_ERROR_MODERATE);
+    g_assert_cmpuint(counter.n_errors, ==, 6);
+    free_job(job, &counter);
+
+    /* no limit */
+    job = new_job(0, &counter);
+    for (i = 0; i < 3; i++)
+        emit(job, G_IO_ERROR_PERMISSION_DENIED, FM_JOB_ERROR_MODERATE);
+    g_assert_cmpuint(counter.n_errors, ==, 3);
+    free_job(job, &counter);
+}
+
+static void test_summary_and_log(void)
+{
+    ErrorCounter counter;
+    char *dir_name = g_dir_make_tmp("libfm-errors-XXXXXX", NULL);
+    char *log_name = g_build_filename(dir_name, "errors.log", NULL);
+    char *missing = g_build_filename(dir_name, "missing", NULL);
+    char *contents, *str;
+    char **lines;
+    FmPathList *files = fm_path_list_new();
+    FmPath *dir = fm_path_new_for_path(missing);
+    FmPath *path;
+    FmFileOpsJob *job;
+    int i;
+
+    for (i = 0; i < 5; i++)
+    {
+        str = g_strdup_printf("file%d", i);
+        path = fm_path_new_child(dir, str);
+        fm_path_list_push_tail(files, path);
+        fm_path_unref(path);
+        g_free(str);
+    }
+    job = fm_file_ops_job_new(FM_FILE_OP_DELETE, files);
+    fm_path_list_unref(files);
+    fm_file_ops_job_set_error_limit(job, 1);
+    fm_file_ops_job_set_error_log(job, log_name);
+    memset(&counter, 0, sizeof(counter));
+    counter.answer = FM_JOB_CONTINUE;
+    g_signal_connect(job, "error", G_CALLBACK(on_error), &counter);
+    fm_job_run_sync(FM_JOB(job));
+
+    /* first error is shown and the rest are summarized */
+    g_assert_cmpuint(counter.n_errors, ==, 1);
+    g_assert_cmpuint(counter.n_warnings, ==, 1);
+    g_assert(strstr(counter.last_message, "4 more similar errors") != NULL);
+    g_assert(strstr(counter.last_message, missing) != NULL);
+    free_job(job, &counter);
+
+    /* every error is logged */
+    g_assert(g_file_get_contents(log_name, &contents, NULL, NULL));
+    lines = g_strsplit(contents, "\n", -1);
+    g_assert_cmpuint(g_strv_length(lines), ==, 6); /* with empty one after the last */
+    for (i = 0; i < 5; i++)
+    {
+        str = g_strconcat(missing, "\t", NULL);
+        g_assert(g_str_has_prefix(lines[i], str));
+        g_free(str);
+    }
+    g_assert_cmpstr(lines[5], ==, "");
+    g_strfreev(lines);
+    g_free(contents);
+
+    fm_path_unref(dir);
+    g_remove(log_name);
+    g_rmdir(dir_name);
+    g_free(missing);
+    g_free(log_name);
+    g_free(dir_name);
+}
+
+int main (int   argc, char *argv[])
+{
+#if !GLIB_CHECK_VERSION(2, 36, 0)
+    g_type_init();
+#endif
+    fm_init(NULL);
+
+    g_test_init (&argc, &argv, NULL); // initialize test program
+    g_test_add_func("/FmFileOpsJob/error_limit", test_limit);
+    g_test_add_func("/FmFileOpsJob/error_answer", test_answer);
+    g_test_add_func("/FmFileOpsJob/errors_always_reported", test_always_reported);
+    g_test_add_func("/FmFileOpsJob/errors_summary_and_log", test_summary_and_log);
+
+    return g_test_run();
+}
@@ -0,0 +1,210 @@
+/*
+ *      test-fm-folder-config.c
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+#include <fm.h>
+
+#include <glib/gstdio.h>
+#include <string.h>
+
+//ignore for test disabled asserts
+#ifdef G_DISABLE_ASSERT
+    #undef G_DISABLE_ASSERT
+#endif
+
+static char *config_home = NULL;
+static char *cache_file = NULL;
+static char *journal_file = NULL;
+
+static FmPath *folder_path(int i)
+{
+    char *str = g_strdup_printf("%s/folder%d", config_home, i);
+    FmPath *path = fm_path_new_for_path(str);
+
+    g_free(str);
+    return path;
+}
+
+static void set_value(int i, const char *value)
+{
+    FmPath *path = folder_path(i);
+    FmFolderConfig *fc = fm_folder_config_open(path);
+
+    if (value)
+        fm_folder_config_set_string(fc, "test", value);
+    else
+        fm_folder_config_purge(fc);
+    g_assert(fm_folder_config_close(fc, NULL));
+    fm_path_unref(path);
+}
+
+static char *get_value(int i)
+{
+    FmPath *path = folder_path(i);
+    FmFolderConfig *fc = fm_folder_config_open(path);
+    char *value = fm_folder_config_get_string(fc, "test");
+
+    fm_folder_config_close(fc, NULL);
+    fm_path_unref(path);
+    return value;
+}
+
+static void assert_value(int i, const char *expected)
+{
+    char *value = get_value(i);
+
+    g_assert_cmpstr(value, ==, expected);
+    g_free(value);
+}
+
+/* saves everything and loads it back */
+static void restart(void)
+{
+    _fm_folder_config_finalize();
+    _fm_folder_config_init();
+}
+
+/* drops all settings including saved ones */
+static void reset(void)
+{
+    _fm_folder_config_finalize();
+    g_remove(cache_file);
+    g_remove(journal_file);
+    _fm_folder_config_init();
+}
+
+static void test_replay(void)
+{
+    char *contents;
+
+    reset();
+    set_value(1, "one");
+    set_value(2, "two");
+    fm_folder_config_save_cache();
+    /* changes go into journal, the cache file is not written */
+    g_assert(!g_file_test(cache_file, G_FILE_TEST_EXISTS));
+    g_assert(g_file_get_contents(journal_file, &contents, NULL, NULL));
+    g_assert(contents[0] == '#');
+    g_free(contents);
+
+    /* the later records override earlier ones */
+    set_value(1, "uno");
+    set_value(2, NULL);
+    fm_folder_config_save_cache();
+    restart();
+    assert_value(1, "uno");
+    assert_value(2, NULL);
+}
+
+static void test_truncated(void)
+{
+    char *contents;
+    gsize len;
+
+    reset();
+    set_value(1, "one");
+    fm_folder_config_save_cache();
+    set_value(2, "two");
+    fm_folder_config_save_cache();
+
+    /* write was interrupted inside of the last record */
+    g_assert(g_file_get_contents(journal_file, &contents, &len, NULL));
+    g_assert(g_file_set_contents(journal_file, contents, len - 1, NULL));
+    g_free(contents);
+    restart(); /* nothing is changed so nothing is saved */
+    assert_value(1, "one");
+    assert_value(2, NULL);
+
+    /* broken journal is merged into the cache file on next save */
+    restart();
+    g_assert(g_file_test(cache_file, G_FILE_TEST_EXISTS));
+    g_assert(!g_file_test(journal_file, G_FILE_TEST_EXISTS));
+    assert_value(1, "one");
+
+    /* garbage in place of record header */
+    g_assert(g_file_set_contents(journal_file, "#1000\n[x]\n", -1, NULL));
+    restart();
+    assert_value(1, "one");
+}
+
+static void test_compaction(void)
+{
+    char *value = g_strnfill(1000, 'x');
+    int i, n;
+
+    reset();
+    /* journal is merged when it grows over 64 KB */
+    for (n = 0; n < 100; n++)
+    {
+        set_value(n, value);
+        fm_folder_config_save_cache();
+        if (g_file_test(cache_file, G_FILE_TEST_EXISTS))
+            break;
+    }
+    g_assert_cmpint(n, >, 10);
+    g_assert_cmpint(n, <, 100);
+    g_assert(!g_file_test(journal_file, G_FILE_TEST_EXISTS));
+
+    /* and then is used again */
+    set_value(++n, "last");
+    fm_folder_config_save_cache();
+    g_assert(g_file_test(journal_file, G_FILE_TEST_EXISTS));
+
+    restart();
+    for (i = 0; i < n; i++)
+        assert_value(i, value);
+    assert_value(n, "last");
+    g_free(value);
+}
+
+int main (int   argc, char *argv[])
+{
+    char *dir;
+    int ret;
+
+#if !GLIB_CHECK_VERSION(2, 36, 0)
+    g_type_init();
+#endif
+    /* don't touch real user config, it should be set before it is queried */
+    config_home = g_dir_make_tmp("libfm-config-XXXXXX", NULL);
+    g_assert(config_home != NULL);
+    g_setenv("XDG_CONFIG_HOME", config_home, TRUE);
+    cache_file = g_build_filename(config_home, "libfm", "dir-settings.conf", NULL);
+    journal_file = g_build_filename(config_home, "libfm", "dir-settings.log", NULL);
+    dir = g_path_get_dirname(cache_file);
+    g_mkdir_with_parents(dir, 0700);
+    fm_init(NULL);
+
+    g_test_init (&argc, &argv, NULL); // initialize test program
+    g_test_add_func("/FmFolderConfig/journal_replay", test_replay);
+    g_test_add_func("/FmFolderConfig/journal_truncated", test_truncated);
+    g_test_add_func("/FmFolderConfig/journal_compaction", test_compaction);
+
+    ret = g_test_run();
+    fm_finalize();
+
+    g_remove(cache_file);
+    g_remove(journal_file);
+    g_rmdir(dir);
+    g_rmdir(config_home);
+    g_free(dir);
+    g_free(journal_file);
+    g_free(cache_file);
+    g_free(config_home);
+    return ret;
+}
@@ -0,0 +1,284 @@
+/*
+ *      test-fm-folder-snapshot.c
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+#include <fm.h>
+#include "fm-folder-snapshot.h"
+
+#include <glib/gstdio.h>
+#include <string.h>
+
+//ignore for test disabled asserts
+#ifdef G_DISABLE_ASSERT
+    #undef G_DISABLE_ASSERT
+#endif
+
+static void test_uint(void)
+{
+    static const guint64 values[] = { 0, 1, 127, 128, 300, 16383, 16384,
+                                      G_MAXUINT32, G_MAXUINT64 };
+    GString *buf = g_string_new(NULL);
+    const char *p, *end;
+    guint64 val;
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(values); i++)
+        _fm_snapshot_put_uint(buf, values[i]);
+    /* LEB128: 7 bits per byte */
+    g_assert_cmpuint(buf->len, ==, 1 + 1 + 1 + 2 + 2 + 2 + 3 + 5 + 10);
+
+    p = buf->str;
+    end = buf->str + buf->len;
+    for (i = 0; i < G_N_ELEMENTS(values); i++)
+    {
+        g_assert(_fm_snapshot_get_uint(&p, end, &val));
+        g_assert_cmpuint(val, ==, values[i]);
+    }
+    g_assert(p == end);
+    /* nothing left */
+    g_assert(!_fm_snapshot_get_uint(&p, end, &val));
+
+    /* truncated in the middle of a value */
+    g_string_truncate(buf, 0);
+    _fm_snapshot_put_uint(buf, 300);
+    p = buf->str;
+    g_assert(!_fm_snapshot_get_uint(&p, buf->str + 1, &val));
+
+    /* too many continuation bytes */
+    g_string_truncate(buf, 0);
+    for (i = 0; i < 11; i++)
+        g_string_append_c(buf, '\x80');
+    g_string_append_c(buf, '\0');
+    p = buf->str;
+    g_assert(!_fm_snapshot_get_uint(&p, buf->str + buf->len, &val));
+
+    g_string_free(buf, TRUE);
+}
+
+static void test_string(void)
+{
+    GString *buf = g_string_new(NULL);
+    const char *p, *end, *str;
+
+    _fm_snapshot_put_string(buf, "abc");
+    _fm_snapshot_put_string(buf, NULL);
+    _fm_snapshot_put_string(buf, "");
+    _fm_snapshot_put_string(buf, "\xd0\xb0\xd0\xb1");
+    g_assert_cmpuint(buf->len, ==, 5 + 2 + 2 + 6);
+
+    p = buf->str;
+    end = buf->str + buf->len;
+    g_assert(_fm_snapshot_get_string(&p, end, &str));
+    g_assert_cmpstr(str, ==, "abc");
+    /* empty strings are read back as NULL */
+    g_assert(_fm_snapshot_get_string(&p, end, &str));
+    g_assert(str == NULL);
+    g_assert(_fm_snapshot_get_string(&p, end, &str));
+    g_assert(str == NULL);
+    g_assert(_fm_snapshot_get_string(&p, end, &str));
+    g_assert_cmpstr(str, ==, "\xd0\xb0\xd0\xb1");
+    g_assert(p == end);
+
+    /* truncated before terminating NUL */
+    p = buf->str;
+    g_assert(!_fm_snapshot_get_string(&p, buf->str + 4, &str));
+
+    /* length doesn't match the terminator */
+    g_string_truncate(buf, 0);
+    _fm_snapshot_put_uint(buf, 2);
+    g_string_append(buf, "abc");
+    p = buf->str;
+    g_assert(!_fm_snapshot_get_string(&p, buf->str + buf->len, &str));
+
+    g_string_free(buf, TRUE);
+}
+
+typedef struct
+{
+    char *dir_name;
+    FmPath *dir;
+    FmFileInfo *dir_fi;
+    FmFileInfoList *files;
+} Listing;
+
+static FmFileInfo *info_for_native_file(FmPath *parent, const char *name)
+{
+    FmPath *path = name ? fm_path_new_child(parent, name) : fm_path_ref(parent);
+    char *path_str = fm_path_to_str(path);
+    GError *err = NULL;
+    FmFileInfo *fi = fm_file_info_new_from_native_file(path, path_str, &err);
+
+    g_assert_no_error(err);
+    g_assert(fi != NULL);
+    g_free(path_str);
+    fm_path_unref(path);
+    return fi;
+}
+
+static void listing_init(Listing *l)
+{
+    static const char *names[] = { "a.txt", "b c", ".hidden", "d\xc3\xa9j\xc3\xa0" };
+    char *path_str;
+    guint i;
+
+    l->dir_name = g_dir_make_tmp("libfm-snapshot-XXXXXX", NULL);
+    g_assert(l->dir_name != NULL);
+    for (i = 0; i < G_N_ELEMENTS(names); i++)
+    {
+        path_str = g_build_filename(l->dir_name, names[i], NULL);
+        g_assert(g_file_set_contents(path_str, names[i], -1, NULL));
+        g_free(path_str);
+    }
+    path_str = g_build_filename(l->dir_name, "subdir", NULL);
+    g_assert_cmpint(g_mkdir(path_str, 0700), ==, 0);
+    g_free(path_str);
+
+    l->dir = fm_path_new_for_path(l->dir_name);
+    l->dir_fi = info_for_native_file(l->dir, NULL);
+    l->files = fm_file_info_list_new();
+    for (i = 0; i < G_N_ELEMENTS(names); i++)
+        fm_file_info_list_push_tail_noref(l->files, info_for_native_file(l->dir, names[i]));
+    fm_file_info_list_push_tail_noref(l->files, info_for_native_file(l->dir, "subdir"));
+}
+
+static void listing_free(Listing *l)
+{
+    GDir *dir = g_dir_open(l->dir_name, 0, NULL);
+    const char *name;
+    char *path_str;
+
+    while ((name = g_dir_read_name(dir)) != NULL)
+    {
+        path_str = g_build_filename(l->dir_name, name, NULL);
+        g_remove(path_str);
+        g_free(path_str);
+    }
+    g_dir_close(dir);
+    g_rmdir(l->dir_name);
+    fm_file_info_list_unref(l->files);
+    fm_file_info_unref(l->dir_fi);
+    fm_path_unref(l->dir);
+    g_free(l->dir_name);
+}
+
+static void assert_same_info(FmFileInfo *fi, FmFileInfo *orig)
+{
+    g_assert(fm_path_equal(fm_file_info_get_path(fi), fm_file_info_get_path(orig)));
+    g_assert_cmpstr(fm_file_info_get_name(fi), ==, fm_file_info_get_name(orig));
+    g_assert_cmpstr(fm_file_info_get_disp_name(fi), ==, fm_file_info_get_disp_name(orig));
+    g_assert_cmpint(fm_file_info_get_size(fi), ==, fm_file_info_get_size(orig));
+    g_assert_cmpint(fm_file_info_get_mtime(fi), ==, fm_file_info_get_mtime(orig));
+    g_assert_cmpuint(fm_file_info_get_mode(fi), ==, fm_file_info_get_mode(orig));
+    g_assert(fm_file_info_get_mime_type(fi) == fm_file_info_get_mime_type(orig));
+    g_assert(fm_file_info_is_dir(fi) == fm_file_info_is_dir(orig));
+    g_assert(fm_file_info_is_hidden(fi) == fm_file_info_is_hidden(orig));
+}
+
+static void test_round_trip(void)
+{
+    Listing l;
+    GString *buf;
+    FmFileInfoList *files;
+    FmFileInfo *dir_fi = NULL;
+    char *etag = NULL;
+    GList *it, *orig;
+
+    listing_init(&l);
+    buf = _fm_folder_snapshot_serialize(l.dir, l.dir_fi, l.files, "etag:1");
+    g_assert(buf != NULL);
+    files = _fm_folder_snapshot_parse(l.dir, buf->str, buf->len, &dir_fi, &etag);
+    g_assert(files != NULL);
+    g_assert_cmpstr(etag, ==, "etag:1");
+    g_assert(dir_fi != NULL);
+    assert_same_info(dir_fi, l.dir_fi);
+    g_assert_cmpuint(fm_file_info_list_get_length(files), ==,
+                     fm_file_info_list_get_length(l.files));
+    for (it = fm_file_info_list_peek_head_link(files),
+         orig = fm_file_info_list_peek_head_link(l.files);
+         it; it = it->next, orig = orig->next)
+        assert_same_info(it->data, orig->data);
+    fm_file_info_list_unref(files);
+    fm_file_info_unref(dir_fi);
+    g_free(etag);
+    g_string_free(buf, TRUE);
+
+    /* snapshot without etag */
+    buf = _fm_folder_snapshot_serialize(l.dir, l.dir_fi, l.files, NULL);
+    files = _fm_folder_snapshot_parse(l.dir, buf->str, buf->len, &dir_fi, &etag);
+    g_assert(files != NULL);
+    g_assert(etag == NULL);
+    fm_file_info_list_unref(files);
+    fm_file_info_unref(dir_fi);
+    g_string_free(buf, TRUE);
+
+    /* nothing to save without folder info */
+    g_assert(_fm_folder_snapshot_serialize(l.dir, NULL, l.files, NULL) == NULL);
+    listing_free(&l);
+}
+
+static void test_broken(void)
+{
+    Listing l;
+    GString *buf;
+    FmFileInfoList *files;
+    FmFileInfo *dir_fi;
+    char *etag;
+    FmPath *other;
+    gsize len;
+
+    listing_init(&l);
+    buf = _fm_folder_snapshot_serialize(l.dir, l.dir_fi, l.files, "etag:1");
+
+    /* any truncated snapshot should be rejected */
+    for (len = 0; len < buf->len; len++)
+    {
+        dir_fi = NULL;
+        etag = NULL;
+        files = _fm_folder_snapshot_parse(l.dir, buf->str, len, &dir_fi, &etag);
+        g_assert(files == NULL);
+        g_assert(dir_fi == NULL);
+        g_assert(etag == NULL);
+    }
+
+    /* snapshot of another folder */
+    other = fm_path_get_parent(l.dir);
+    g_assert(_fm_folder_snapshot_parse(other, buf->str, buf->len, &dir_fi, &etag) == NULL);
+
+    /* wrong magic */
+    buf->str[0] = 'X';
+    g_assert(_fm_folder_snapshot_parse(l.dir, buf->str, buf->len, &dir_fi, &etag) == NULL);
+
+    g_string_free(buf, TRUE);
+    listing_free(&l);
+}
+
+int main (int   argc, char *argv[])
+{
+#if !GLIB_CHECK_VERSION(2, 36, 0)
+    g_type_init();
+#endif
+    fm_init(NULL);
+
+    g_test_init (&argc, &argv, NULL); // initialize test program
+    g_test_add_func("/FmFolderSnapshot/uint", test_uint);
+    g_test_add_func("/FmFolderSnapshot/string", test_string);
+    g_test_add_func("/FmFolderSnapshot/round_trip", test_round_trip);
+    g_test_add_func("/FmFolderSnapshot/broken", test_broken);
+
+    return g_test_run();
+}
@@ -0,0 +1,229 @@
+/*
+ *      test-fm-vfs-search.c
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License
+ *      along with this program; if not, write to the Free Software
+ *      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *      MA 02110-1301, USA.
+ */
+
+/* the module is compiled into the test so its internals can be inspected */
+#include "vfs-search.c"
+
+#include <fm.h>
+#include <glib/gstdio.h>
+
+//ignore for test disabled asserts
+#ifdef G_DISABLE_ASSERT
+    #undef G_DISABLE_ASSERT
+#endif
+
+static char *test_dir = NULL;
+
+static GFile *new_search_file(const char *params)
+{
+    char *uri = g_strconcat("search://", test_dir, "?", params, NULL);
+    GFile *file = _fm_vfs_search_new_for_uri(uri);
+
+    g_free(uri);
+    return file;
+}
+
+static FmVfsSearchEnumerator *new_enumerator(const char *params, GFileQueryInfoFlags flags)
+{
+    GFile *file = new_search_file(params);
+    GFileEnumerator *enu;
+
+    enu = _fm_vfs_search_enumerator_new(file, FM_SEARCH_VFILE(file)->path,
+                                        "standard::*", flags, NULL);
+    g_object_unref(file); /* enumerator keeps a reference */
+    return FM_VFS_SEACRH_ENUMERATOR(enu);
+}
+
+static gboolean has_attribute(FmVfsSearchEnumerator *enu, const char *attr)
+{
+    char **attrs = g_strsplit(enu->scan_attributes, ",", -1);
+    char **p;
+    gboolean found = FALSE;
+
+    for (p = attrs; *p; p++)
+        if (strcmp(*p, attr) == 0)
+            found = TRUE;
+    g_strfreev(attrs);
+    return found;
+}
+
+static void test_scan_attributes(void)
+{
+    FmVfsSearchEnumerator *enu;
+
+    /* name rules need only the directory entry */
+    enu = new_enumerator("recursive=1&name=*.txt", G_FILE_QUERY_INFO_NONE);
+    g_assert_cmpstr(enu->scan_attributes, ==, G_FILE_ATTRIBUTE_STANDARD_NAME","
+                                              G_FILE_ATTRIBUTE_STANDARD_TYPE);
+    g_assert(enu->scan_flags & G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+    g_assert_cmpstr(enu->attributes, ==, "standard::*");
+    g_object_unref(enu);
+
+    /* size rules need stat() of symlink target, as before */
+    enu = new_enumerator("min_size=10", G_FILE_QUERY_INFO_NONE);
+    g_assert(has_attribute(enu, G_FILE_ATTRIBUTE_STANDARD_SIZE));
+    g_assert(has_attribute(enu, G_FILE_ATTRIBUTE_STANDARD_IS_SYMLINK));
+    g_assert(!has_attribute(enu, G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE));
+    g_assert(!has_attribute(enu, G_FILE_ATTRIBUTE_TIME_MODIFIED));
+    g_assert_cmpint(enu->scan_flags, ==, G_FILE_QUERY_INFO_NONE);
+    g_object_unref(enu);
+
+    /* caller's flags are kept */
+    enu = new_enumerator("max_size=10", G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+    g_assert(has_attribute(enu, G_FILE_ATTRIBUTE_STANDARD_SIZE));
+    g_assert_cmpint(enu->scan_flags, ==, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+    g_object_unref(enu);
+
+    enu = new_enumerator("max_mtime=2030-01-01", G_FILE_QUERY_INFO_NONE);
+    g_assert(has_attribute(enu, G_FILE_ATTRIBUTE_TIME_MODIFIED));
+    g_assert(!has_attribute(enu, G_FILE_ATTRIBUTE_STANDARD_SIZE));
+    g_object_unref(enu);
+
+    /* content search is limited by size of files */
+    enu = new_enumerator("content=abc", G_FILE_QUERY_INFO_NONE);
+    g_assert(has_attribute(enu, G_FILE_ATTRIBUTE_STANDARD_SIZE));
+    g_assert(!has_attribute(enu, G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE));
+    g_object_unref(enu);
+
+    /* content type is requested only for mime_types= */
+    enu = new_enumerator("mime_types=text/plain", G_FILE_QUERY_INFO_NONE);
+    g_assert(has_attribute(enu, G_FILE_ATTRIBUTE_STANDARD_CONTENT_TYPE));
+    g_assert(has_attribute(enu, G_FILE_ATTRIBUTE_STANDARD_IS_SYMLINK));
+    g_object_unref(enu);
+}
+
+static gint compare_names(gconstpointer a, gconstpointer b)
+{
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/* returns sorted names of found files, checks they have @attr */
+static char *search(const char *params, const char *attr)
+{
+    GFile *file = new_search_file(params);
+    GFileEnumerator *enu;
+    GFileInfo *info;
+    GError *err = NULL;
+    GPtrArray *names = g_ptr_array_new_with_free_func(g_free);
+    char *res;
+
+    enu = g_file_enumerate_children(file, "standard::name,standard::size,standard::is-hidden",
+                                    G_FILE_QUERY_INFO_NONE, NULL, &err);
+    g_assert_no_error(err);
+    while ((info = g_file_enumerator_next_file(enu, NULL, &err)) != NULL)
+    {
+        /* found files have attributes requested by the caller */
+        g_assert(g_file_info_has_attribute(info, attr));
+        g_ptr_array_add(names, g_strdup(g_file_info_get_name(info)));
+        g_object_unref(info);
+    }
+    g_assert_no_error(err);
+    g_object_unref(enu);
+    g_object_unref(file);
+    g_ptr_array_sort(names, compare_names);
+    g_ptr_array_add(names, NULL);
+    res = g_strjoinv(" ", (char**)names->pdata);
+    g_ptr_array_free(names, TRUE);
+    return res;
+}
+
+static void test_results(void)
+{
+    char *res;
+
+    /* size is not queried in scan but should be there */
+    res = search("recursive=1&name=*.txt", G_FILE_ATTRIBUTE_STANDARD_SIZE);
+    g_assert_cmpstr(res, ==, "a.txt c.txt");
+    g_free(res);
+
+    res = search("recursive=0&show_hidden=1&min_size=1", G_FILE_ATTRIBUTE_STANDARD_SIZE);
+    g_assert_cmpstr(res, ==, ".h.txt a.txt b.dat");
+    g_free(res);
+
+    /* directories never match size rules */
+    res = search("recursive=1&min_size=50", G_FILE_ATTRIBUTE_STANDARD_SIZE);
+    g_assert_cmpstr(res, ==, "b.dat");
+    g_free(res);
+
+    res = search("recursive=0&max_size=5", G_FILE_ATTRIBUTE_STANDARD_SIZE);
+    g_assert_cmpstr(res, ==, "");
+    g_free(res);
+
+    res = search("recursive=1&name=*.txt&content=needle", G_FILE_ATTRIBUTE_STANDARD_SIZE);
+    g_assert_cmpstr(res, ==, "c.txt");
+    g_free(res);
+}
+
+static void make_file(const char *name, const char *contents)
+{
+    char *path = g_build_filename(test_dir, name, NULL);
+
+    g_assert(g_file_set_contents(path, contents, -1, NULL));
+    g_free(path);
+}
+
+static void remove_dir(const char *path)
+{
+    GDir *dir = g_dir_open(path, 0, NULL);
+    const char *name;
+    char *child;
+
+    while ((name = g_dir_read_name(dir)) != NULL)
+    {
+        child = g_build_filename(path, name, NULL);
+        if (g_file_test(child, G_FILE_TEST_IS_DIR))
+            remove_dir(child);
+        else
+            g_remove(child);
+        g_free(child);
+    }
+    g_dir_close(dir);
+    g_rmdir(path);
+}
+
+int main (int   argc, char *argv[])
+{
+    char *sub;
+    int ret;
+
+#if !GLIB_CHECK_VERSION(2, 36, 0)
+    g_type_init();
+#endif
+    fm_init(NULL);
+
+    test_dir = g_dir_make_tmp("libfm-search-XXXXXX", NULL);
+    g_assert(test_dir != NULL);
+    sub = g_build_filename(test_dir, "sub", NULL);
+    g_assert_cmpint(g_mkdir(sub, 0700), ==, 0);
+    g_free(sub);
+    make_file("a.txt", "0123456789");
+    make_file("b.dat", "0123456789012345678901234567890123456789"
+                       "0123456789012345678901234567890123456789");
+    make_file(".h.txt", "needle");
+    make_file("sub/c.txt", "haystack with needle");
+
+    g_test_init (&argc, &argv, NULL); // initialize test program
+    g_test_add_func("/FmVfsSearch/scan_attributes", test_scan_attributes);
+    g_test_add_func("/FmVfsSearch/results", test_results);
+
+    ret = g_test_run();
+    remove_dir(test_dir);
+    g_free(test_dir);
+    return ret;
+}